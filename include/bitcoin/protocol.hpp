@@ -15,21 +15,43 @@
  */
 
 #include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/admission_control.hpp>
+#include <bitcoin/protocol/bloom_filter.hpp>
+#include <bitcoin/protocol/capture.hpp>
 #include <bitcoin/protocol/converter.hpp>
 #include <bitcoin/protocol/define.hpp>
+#include <bitcoin/protocol/filter_engine.hpp>
+#include <bitcoin/protocol/header_cache.hpp>
+#include <bitcoin/protocol/history_batch.hpp>
+#include <bitcoin/protocol/history_stream.hpp>
+#include <bitcoin/protocol/ingest_client.hpp>
+#include <bitcoin/protocol/ingest_server.hpp>
 #include <bitcoin/protocol/interface.pb.h>
+#include <bitcoin/protocol/mempool_journal.hpp>
+#include <bitcoin/protocol/mempool_mirror.hpp>
+#include <bitcoin/protocol/merkle_tree.hpp>
 #include <bitcoin/protocol/packet.hpp>
 #include <bitcoin/protocol/primitives.hpp>
+#include <bitcoin/protocol/publish_queue.hpp>
+#include <bitcoin/protocol/read_snapshot.hpp>
+#include <bitcoin/protocol/replay_ring.hpp>
 #include <bitcoin/protocol/replier.hpp>
 #include <bitcoin/protocol/request_packet.hpp>
 #include <bitcoin/protocol/requester.hpp>
+#include <bitcoin/protocol/response_cache.hpp>
 #include <bitcoin/protocol/response_packet.hpp>
+#include <bitcoin/protocol/script_verifier.hpp>
+#include <bitcoin/protocol/stealth_scanner.hpp>
+#include <bitcoin/protocol/subscription_matcher.hpp>
+#include <bitcoin/protocol/utxo_batch.hpp>
 #include <bitcoin/protocol/version.hpp>
+#include <bitcoin/protocol/zmq/access_list.hpp>
 #include <bitcoin/protocol/zmq/authenticator.hpp>
 #include <bitcoin/protocol/zmq/certificate.hpp>
 #include <bitcoin/protocol/zmq/context.hpp>
 #include <bitcoin/protocol/zmq/frame.hpp>
 #include <bitcoin/protocol/zmq/identifiers.hpp>
+#include <bitcoin/protocol/zmq/key_store.hpp>
 #include <bitcoin/protocol/zmq/message.hpp>
 #include <bitcoin/protocol/zmq/poller.hpp>
 #include <bitcoin/protocol/zmq/socket.hpp>
@@ -0,0 +1,134 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_PROTOCOL_ADMISSION_CONTROL_HPP
+#define LIBBITCOIN_PROTOCOL_ADMISSION_CONTROL_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <google/protobuf/message_lite.h>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/define.hpp>
+#include <bitcoin/protocol/zmq/message.hpp>
+
+namespace libbitcoin {
+namespace protocol {
+
+/// Sheds requests by class when their sojourn time (from the client's send,
+/// if known, else receipt, to reply) stays above a target for an interval, as CoDel drops packets, so that
+/// latency remains bounded under overload. Shedding accelerates with the
+/// square root of the number shed until the sojourn time falls below the
+/// target.
+/// This class is thread safe.
+class BCP_API admission_control
+{
+public:
+    /// A shared admission control pointer.
+    typedef std::shared_ptr<admission_control> ptr;
+
+    typedef std::chrono::steady_clock clock;
+
+    struct statistics
+    {
+        size_t admitted;
+        size_t shed;
+        clock::duration sojourn;
+        bool shedding;
+    };
+
+    static constexpr int32_t default_target_milliseconds = 5;
+    static constexpr int32_t default_interval_milliseconds = 100;
+
+    /// The longest queue wait credited to a request by its sent time, which
+    /// bounds the effect of a client clock that lags.
+    static constexpr int32_t maximum_wait_milliseconds = 10000;
+
+    admission_control(
+        int32_t target_milliseconds=default_target_milliseconds,
+        int32_t interval_milliseconds=default_interval_milliseconds);
+
+    /// The class of a request, its request type for blockchain requests,
+    /// otherwise zero.
+    static int to_class(const google::protobuf::MessageLite& request);
+
+    /// Milliseconds since the unix epoch, as in the sent field of a
+    /// blockchain request.
+    static uint64_t to_sent(std::chrono::system_clock::time_point time);
+
+    /// The time the client sent the request, by the steady clock, so that
+    /// sojourn includes the wait in zmq buffers. This is now if the request
+    /// has no sent time, or if the client clock is ahead.
+    static clock::time_point sent_time(
+        const google::protobuf::MessageLite& request,
+        clock::time_point now=clock::now(),
+        std::chrono::system_clock::time_point wall_now=
+            std::chrono::system_clock::now());
+
+    /// The first part of a status reply, followed by a response. No other
+    /// reply starts with it: a serialized protobuf message never starts
+    /// with a zero byte and a process-local part is longer.
+    static const data_chunk& status_frame();
+
+    /// True if the reply starts with the status frame.
+    static bool is_status_reply(const zmq::message& reply);
+
+    /// True if a request of the class is to be served, false to shed it.
+    bool admit(int request_class, clock::time_point now=clock::now());
+
+    /// Record the sojourn time of a request of the class when replied.
+    void record(int request_class, clock::duration sojourn,
+        clock::time_point now=clock::now());
+
+    /// Counters and the last sojourn time of the class.
+    statistics stats(int request_class) const;
+
+private:
+    struct state
+    {
+        size_t admitted = 0;
+        size_t shed = 0;
+        clock::duration sojourn = clock::duration::zero();
+
+        // The time at which the sojourn time will have been above target
+        // for an interval, zero while below target.
+        clock::time_point first_above;
+
+        // Requests are shed from shed_next while shedding.
+        bool shedding = false;
+        size_t count = 0;
+        clock::time_point shed_next;
+    };
+
+    clock::time_point next_shed(clock::time_point now, size_t count) const;
+
+    const clock::duration target_;
+    const clock::duration interval_;
+
+    // These are protected by mutex.
+    std::map<int, state> classes_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace protocol
+} // namespace libbitcoin
+
+#endif
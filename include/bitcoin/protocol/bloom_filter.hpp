@@ -0,0 +1,71 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_PROTOCOL_BLOOM_FILTER_HPP
+#define LIBBITCOIN_PROTOCOL_BLOOM_FILTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/define.hpp>
+#include <bitcoin/protocol/interface.pb.h>
+
+namespace libbitcoin {
+namespace protocol {
+
+/// A BIP37 bloom filter, matched against transactions as by a BIP37 node
+/// (without updating the filter).
+class BCP_API bloom_filter
+{
+public:
+    static constexpr size_t max_size = 36000;
+    static constexpr uint32_t max_hash_functions = 50;
+
+    /// The MurmurHash3 (x86_32) of the data.
+    static uint32_t murmur3(uint32_t seed, data_slice data);
+
+    /// An empty filter, which matches nothing.
+    bloom_filter();
+
+    /// False if the filter exceeds BIP37 limits.
+    bool set(const std::string& data, uint32_t hash_functions,
+        uint32_t tweak);
+
+    /// True if the filter has no data.
+    bool empty() const;
+
+    /// True if the element may have been inserted.
+    bool contains(data_slice element) const;
+
+    /// True if the transaction hash, an outpoint spent, or a data push of
+    /// an input or output script is contained.
+    bool contains(const tx& transaction, const hash_digest& hash) const;
+
+private:
+    bool contains_pushes(const std::string& script) const;
+
+    data_chunk data_;
+    uint32_t hash_functions_;
+    uint32_t tweak_;
+};
+
+} // namespace protocol
+} // namespace libbitcoin
+
+#endif
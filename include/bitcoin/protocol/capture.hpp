@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_PROTOCOL_CAPTURE_HPP
+#define LIBBITCOIN_PROTOCOL_CAPTURE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <google/protobuf/message_lite.h>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/define.hpp>
+
+namespace libbitcoin {
+namespace protocol {
+
+/// Records timestamped multipart messages to a compact binary log.
+/// This class is thread safe.
+class BCP_API capture
+{
+public:
+    /// A shared capture pointer.
+    typedef std::shared_ptr<capture> ptr;
+
+    /// The role of a captured message.
+    enum class direction : uint8_t
+    {
+        request = 0,
+        reply = 1,
+        handler = 2
+    };
+
+    /// A captured message, timestamp is microseconds since capture start.
+    struct record
+    {
+        typedef std::vector<record> list;
+
+        uint64_t timestamp;
+        direction way;
+        std::vector<data_chunk> parts;
+    };
+
+    /// Open the log for writing, truncating any existing file.
+    capture(const std::string& path);
+
+    /// True if the log is open and no write has failed.
+    operator const bool() const;
+
+    /// Append a message of the given parts.
+    void write(direction way, const std::vector<data_chunk>& parts);
+
+    /// Append a single part protobuf message.
+    void write(direction way, const google::protobuf::MessageLite& message);
+
+    /// Append a handler message (handler id followed by protobuf message).
+    void write(direction way, const std::string& handler_id,
+        const google::protobuf::MessageLite& message);
+
+    /// Read all complete records of a log, false if the log is missing or
+    /// not a log. A truncated tail, as left by a crash, is skipped.
+    static bool load(const std::string& path, record::list& out);
+
+    /// As load, setting out_truncated if the log ends in an incomplete
+    /// record, which is not read.
+    static bool load(const std::string& path, record::list& out,
+        bool& out_truncated);
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    static bool read_record(std::istream& stream, uint64_t timestamp,
+        record& out);
+
+    const clock::time_point start_;
+    std::ofstream file_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace protocol
+} // namespace libbitcoin
+
+#endif
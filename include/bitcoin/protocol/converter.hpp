@@ -19,11 +19,15 @@
 #ifndef LIBBITCOIN_PROTOCOL_CONVERSION_HPP
 #define LIBBITCOIN_PROTOCOL_CONVERSION_HPP
 
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 #include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/blockchain.pb.h>
 #include <bitcoin/protocol/define.hpp>
 #include <bitcoin/protocol/interface.pb.h>
+#include <bitcoin/protocol/primitives.hpp>
 
 namespace libbitcoin {
 namespace protocol {
@@ -31,6 +35,10 @@ namespace protocol {
 class BCP_API converter
 {
 public:
+    typedef blockchain::fetch_compact_block_handler::compact_block
+        compact_block;
+    typedef blockchain::fetch_merkle_block_handler::merkle_block
+        merkle_block;
 
     virtual bool from_protocol(const std::string* hash,
         hash_digest& result);
@@ -127,6 +135,36 @@ public:
         protocol::block& result);
 
     virtual block* to_protocol(const chain::block& block);
+
+    /// Encode the block as a BIP152 compact block. The coinbase and the
+    /// transactions at the prefilled indexes are sent in full, the rest as
+    /// 6 byte short ids. Prefilled indexes are differentially encoded.
+    virtual bool to_protocol(const chain::block& block, uint64_t nonce,
+        const std::vector<size_t>& prefilled, compact_block& result);
+
+    /// Reconstruct the block of a compact block from the prefilled and the
+    /// mempool transactions. Positions not resolved by the mempool (or
+    /// resolved ambiguously) are returned as missing and left empty, to be
+    /// filled by a further call with those transactions added. False if the
+    /// compact block is invalid, contains duplicate short ids or if the
+    /// complete block does not match its merkle root (a short id collision);
+    /// the full block must then be fetched.
+    virtual bool from_protocol(const compact_block* compact,
+        const chain::transaction::list& mempool, chain::block& result,
+        std::vector<size_t>& missing);
+
+    /// Set the location (block hash, index and merkle branch) of each result
+    /// by its transaction hash, hashing the block's merkle tree once. False
+    /// if the block is invalid or a transaction is not in the block.
+    virtual bool to_protocol(const protocol::block& block,
+        transaction_hash_result_list& results);
+
+    /// Encode the BIP37 merkle block of the transactions matched by index.
+    virtual bool to_protocol(const protocol::block& block,
+        const std::vector<bool>& matches, merkle_block& result);
+
+private:
+    bool to_hashes(const protocol::block& block, hash_list& out);
 };
 
 }
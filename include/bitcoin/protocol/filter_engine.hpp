@@ -0,0 +1,111 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_PROTOCOL_FILTER_ENGINE_HPP
+#define LIBBITCOIN_PROTOCOL_FILTER_ENGINE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/define.hpp>
+#include <bitcoin/protocol/interface.pb.h>
+
+namespace libbitcoin {
+namespace protocol {
+
+/// Matches hashes against the bit prefix filters of a query (as in
+/// transactions_request), by filter type. Filters compile to a sorted table
+/// of disjoint ranges of the leading 64 bits, so that a hash is matched by
+/// one binary search whatever the number of filters. Prefixes are most
+/// significant bit first, as bc::binary.
+/// This class is not thread safe while adding, thread safe once compiled.
+class BCP_API filter_engine
+{
+public:
+    /// Add the filter, false if malformed (prefix shorter than its bits).
+    bool add(const filter& value);
+
+    /// Add the filter in binary form, false if malformed.
+    bool add(filters type, const protocol::binary& prefix);
+
+    /// Add the query filters, false if any is malformed.
+    bool add(const transactions_request& request);
+
+    /// Order and merge the filters, call after adding and before matching.
+    void compile();
+
+    /// True if there are no filters of the type.
+    bool empty(filters type) const;
+
+    /// True if the candidate matches any filter of the type.
+    bool match(filters type, data_slice candidate) const;
+
+    /// Match the candidates, by position.
+    void match(filters type, const hash_list& candidates,
+        std::vector<bool>& out) const;
+
+    /// Match the candidates, by position.
+    void match(filters type, const std::vector<short_hash>& candidates,
+        std::vector<bool>& out) const;
+
+private:
+    // A prefix as the range of its leading 64 bits.
+    struct range
+    {
+        uint64_t first;
+        uint64_t last;
+        uint32_t bits;
+    };
+
+    // A prefix longer than the leading 64 bits.
+    struct long_prefix
+    {
+        uint64_t head;
+        uint32_t bits;
+        data_chunk prefix;
+    };
+
+    struct table
+    {
+        std::vector<range> ranges;
+        std::vector<long_prefix> longs;
+
+        // The first of each range, searched apart for locality.
+        std::vector<uint64_t> firsts;
+    };
+
+    static uint64_t to_key(data_slice value);
+    static bool add(table& table, uint32_t bits, data_slice prefix);
+    static void compile(table& table);
+    static bool in_ranges(const table& table, uint64_t key,
+        size_t candidate_bits);
+    static bool match(const table& table, uint64_t key,
+        data_slice candidate);
+
+    table* find(filters type);
+    const table* find(filters type) const;
+
+    std::array<table, filters_ARRAYSIZE> tables_;
+};
+
+} // namespace protocol
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,120 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_PROTOCOL_HEADER_CACHE_HPP
+#define LIBBITCOIN_PROTOCOL_HEADER_CACHE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/define.hpp>
+#include <bitcoin/protocol/interface.pb.h>
+
+namespace libbitcoin {
+namespace protocol {
+
+/// Block headers, hashes and heights of the chain, indexed by height.
+/// Headers are kept in wire form (80 bytes) in pages allocated on demand.
+/// Only blocks with min_depth confirmations below the top are stored, and
+/// entries above a reorganization fork point are discarded.
+/// This class is thread safe.
+class BCP_API header_cache
+{
+public:
+    /// A shared header cache pointer.
+    typedef std::shared_ptr<header_cache> ptr;
+
+    /// The size of a header in wire form.
+    static constexpr size_t header_size = 80;
+
+    /// Construct an empty cache of blocks with min_depth confirmations.
+    header_cache(size_t min_depth);
+
+    /// Set the height of the top block, which determines block depth.
+    void set_top(size_t height);
+
+    /// Store the header (and its hash) at the height, false if invalid or
+    /// if the block is not deep enough.
+    bool store(size_t height, const block_header& header);
+
+    /// Store the block hash at the height, false if not deep enough.
+    bool store(size_t height, const hash_digest& hash);
+
+    /// Get the header at the height, false if not cached.
+    bool header(size_t height, block_header& out) const;
+
+    /// Get the block hash at the height, false if not cached.
+    bool hash(size_t height, hash_digest& out) const;
+
+    /// Get the height of the block hash, false if not cached.
+    bool height(const hash_digest& hash, size_t& out) const;
+
+    /// Discard all entries above the fork point, which becomes the top.
+    void reorganize(size_t fork_point);
+
+    /// Discard all entries.
+    void clear();
+
+    /// The number of cached heights.
+    size_t size() const;
+
+private:
+    typedef std::array<uint8_t, header_size> wire_header;
+
+    enum class state : uint8_t
+    {
+        empty = 0,
+        hash = 1,
+        header = 2
+    };
+
+    struct page
+    {
+        page();
+
+        std::vector<wire_header> headers;
+        hash_list hashes;
+        std::vector<state> states;
+    };
+
+    typedef std::unique_ptr<page> page_ptr;
+
+    bool deep(size_t height) const;
+    void set_hash(size_t height, const hash_digest& hash);
+    void erase(size_t height);
+    page* find(size_t height) const;
+    page& get(size_t height);
+
+    const size_t min_depth_;
+
+    // These are protected by mutex.
+    size_t top_;
+    std::vector<page_ptr> pages_;
+    std::unordered_map<hash_digest, size_t> heights_;
+    size_t size_;
+    mutable shared_mutex mutex_;
+};
+
+} // namespace protocol
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_PROTOCOL_HISTORY_BATCH_HPP
+#define LIBBITCOIN_PROTOCOL_HISTORY_BATCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/blockchain.pb.h>
+#include <bitcoin/protocol/define.hpp>
+#include <bitcoin/protocol/history_stream.hpp>
+
+namespace libbitcoin {
+namespace protocol {
+
+/// Serves a fetch_history_batch request: each distinct address is fetched
+/// on its own, in hash order (N ordered fetches, not a shared scan), then
+/// streamed back in chunks of bounded rows grouped by address, in request
+/// order, an address without history counting as one row. A repeated
+/// address is answered once, at its first position.
+/// This class is not thread safe.
+class BCP_API history_batch
+{
+public:
+    typedef history_stream::row row;
+    typedef history_stream::row_list row_list;
+
+    /// Fetch the history of the address from the height, false on failure.
+    typedef std::function<bool(const short_hash& address_hash,
+        uint64_t from_height, row_list& out)> fetch_function;
+
+    /// Parse the addresses of the request.
+    history_batch(const blockchain::fetch_history_batch_request& request);
+
+    /// The distinct addresses, false if the address hashes are malformed.
+    bool addresses(std::vector<short_hash>& out) const;
+
+    /// Call fetch once per distinct address in hash order, false (stream
+    /// fails) if any fetch fails.
+    bool scan(fetch_function fetch);
+
+    /// Fill the next chunk, false once the last chunk has been filled.
+    bool next(blockchain::fetch_history_batch_handler& chunk);
+
+private:
+    struct address
+    {
+        short_hash hash;
+        uint32_t index;
+        row_list history;
+    };
+
+    const uint64_t from_height_;
+    const uint32_t chunk_rows_;
+    bool valid_;
+
+    // Distinct addresses in request order, with the scan order.
+    std::vector<address> addresses_;
+    std::vector<size_t> scan_order_;
+
+    // The position of the next row to send.
+    size_t address_;
+    int row_;
+    uint32_t sequence_;
+};
+
+} // namespace protocol
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,79 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_PROTOCOL_HISTORY_STREAM_HPP
+#define LIBBITCOIN_PROTOCOL_HISTORY_STREAM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/blockchain.pb.h>
+#include <bitcoin/protocol/define.hpp>
+
+namespace libbitcoin {
+namespace protocol {
+
+/// Splits an address history into the chunks of a fetch_history_stream,
+/// ordered by height, point and kind, starting after the request cursor.
+/// A cursor identifies the last row delivered, so a later stream from it
+/// returns only rows added to the history since.
+/// This class is not thread safe.
+class BCP_API history_stream
+{
+public:
+    typedef blockchain::fetch_history_handler::history_compact row;
+    typedef google::protobuf::RepeatedPtrField<row> row_list;
+
+    /// Rows per chunk if the request does not specify.
+    static constexpr uint32_t default_chunk_rows = 1000;
+
+    /// The size of a cursor (height, point hash, point index, kind).
+    static constexpr size_t cursor_size = 8 + hash_size + 4 + 4;
+
+    /// The cursor that resumes after the row.
+    static std::string to_cursor(const row& row);
+
+    /// Prepare the history of the request's address, as fetched from the
+    /// request's from_height.
+    history_stream(const blockchain::fetch_history_stream_request& request,
+        row_list history);
+
+    /// Fill the next chunk, false once the last chunk has been filled.
+    /// A malformed cursor yields a single bad_stream chunk.
+    bool next(blockchain::fetch_history_stream_handler& chunk);
+
+private:
+    static bool from_cursor(const std::string& cursor, row& out);
+    static bool before(const row& left, const row& right);
+
+    // Indexes into history_, not pointers, so that the stream can be copied.
+    const row_list history_;
+    std::vector<int> order_;
+    size_t position_;
+    uint32_t chunk_rows_;
+    uint32_t sequence_;
+    std::string cursor_;
+    bool valid_;
+};
+
+} // namespace protocol
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_PROTOCOL_INGEST_CLIENT_HPP
+#define LIBBITCOIN_PROTOCOL_INGEST_CLIENT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/database.pb.h>
+#include <bitcoin/protocol/define.hpp>
+#include <bitcoin/protocol/zmq/context.hpp>
+#include <bitcoin/protocol/zmq/poller.hpp>
+#include <bitcoin/protocol/zmq/socket.hpp>
+
+namespace libbitcoin {
+namespace protocol {
+
+/// Streams blocks to an ingest_server over a dealer socket, packing several
+/// blocks per insert_blocks_request frame and keeping up to a window of
+/// bytes in flight, so that bulk insertion is bound by the store rather
+/// than by round trips. Acknowledgements are cumulative. There is no
+/// retransmission: after a failure resume with a new client from the block
+/// following acknowledged().
+/// This class is not thread safe, call on the socket thread.
+class BCP_API ingest_client
+{
+public:
+    static constexpr size_t default_window_bytes = 64 * 1024 * 1024;
+    static constexpr size_t default_frame_bytes = 1024 * 1024;
+    static constexpr int32_t default_timeout_milliseconds = 30000;
+
+    /// The timeout bounds the wait for each acknowledgement.
+    ingest_client(zmq::context& context,
+        size_t window_bytes=default_window_bytes,
+        size_t frame_bytes=default_frame_bytes,
+        int32_t timeout_milliseconds=default_timeout_milliseconds);
+
+    ingest_client(const ingest_client&) = delete;
+    void operator=(const ingest_client&) = delete;
+
+    code connect(const config::endpoint& address);
+
+    /// Queue the block, sending the frame once full. Blocks while the
+    /// window is full, channel_timeout if no acknowledgement arrives.
+    /// Returns bad_stream, without queuing, if the block does not convert.
+    code insert(const chain::block& block, uint64_t height);
+
+    /// Send any partial frame and wait for all blocks to be acknowledged.
+    code flush();
+
+    /// The sequence of the last queued block, numbered from one.
+    uint64_t sequence() const;
+
+    /// The sequence of the last block stored by the server.
+    uint64_t acknowledged() const;
+
+    /// The number of bytes sent and not yet acknowledged.
+    size_t in_flight() const;
+
+private:
+    // The last sequence and size of a frame awaiting acknowledgement.
+    typedef std::pair<uint64_t, size_t> frame;
+
+    code send_frame();
+    code drain();
+    code await();
+    code receive();
+    void acknowledge(uint64_t sequence);
+
+    const size_t window_bytes_;
+    const size_t frame_bytes_;
+    const int32_t timeout_;
+
+    zmq::socket socket_;
+    zmq::poller poller_;
+    database::insert_blocks_request frame_;
+    size_t frame_size_;
+    uint64_t sequence_;
+    uint64_t acknowledged_;
+    size_t in_flight_bytes_;
+    std::deque<frame> in_flight_;
+    code failure_;
+};
+
+} // namespace protocol
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,99 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_PROTOCOL_INGEST_SERVER_HPP
+#define LIBBITCOIN_PROTOCOL_INGEST_SERVER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/database.pb.h>
+#include <bitcoin/protocol/define.hpp>
+#include <bitcoin/protocol/zmq/context.hpp>
+#include <bitcoin/protocol/zmq/poller.hpp>
+#include <bitcoin/protocol/zmq/socket.hpp>
+
+namespace libbitcoin {
+namespace protocol {
+
+/// Receives insert_blocks_request frames from ingest_clients over a router
+/// socket, inserting each block in sequence through the handler and
+/// acknowledging cumulatively per client. A sequence gap or a failed
+/// insertion is reported in the reply and no further blocks of that client
+/// are stored. A client is forgotten once failed, or once idle for the
+/// idle timeout, after which its frames are refused as gaps.
+/// This class is not thread safe, call on the socket thread.
+class BCP_API ingest_server
+{
+public:
+    /// Store the block (e.g. as insert_block_request), returning its result.
+    typedef std::function<code(const database::insert_block_request&)>
+        insert_handler;
+
+    typedef std::chrono::steady_clock clock;
+
+    static constexpr int32_t default_idle_timeout_seconds = 600;
+
+    ingest_server(zmq::context& context, insert_handler handler,
+        int32_t idle_timeout_seconds=default_idle_timeout_seconds);
+
+    ingest_server(const ingest_server&) = delete;
+    void operator=(const ingest_server&) = delete;
+
+    code bind(const config::endpoint& address);
+
+    /// Process one frame received within the timeout, channel_timeout if
+    /// none arrived.
+    code process(int32_t timeout_milliseconds);
+
+    /// Stop the socket.
+    bool stop();
+
+private:
+    struct client
+    {
+        uint64_t acknowledged = 0;
+        clock::time_point active;
+    };
+
+    void insert(uint64_t& acknowledged,
+        const database::insert_blocks_request& request,
+        database::insert_blocks_reply& reply);
+
+    void prune(clock::time_point now);
+
+    const insert_handler handler_;
+    const clock::duration idle_timeout_;
+
+    zmq::socket socket_;
+    zmq::poller poller_;
+
+    // The last acknowledged sequence by client identity, pruned of idle
+    // clients when their number doubles since the last pruning.
+    std::unordered_map<std::string, client> clients_;
+    size_t prune_size_;
+};
+
+} // namespace protocol
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_PROTOCOL_MEMPOOL_JOURNAL_HPP
+#define LIBBITCOIN_PROTOCOL_MEMPOOL_JOURNAL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/blockchain.pb.h>
+#include <bitcoin/protocol/define.hpp>
+#include <bitcoin/protocol/interface.pb.h>
+
+namespace libbitcoin {
+namespace protocol {
+
+/// Server side record of mempool changes, each numbered by a sequence, for
+/// answering fetch_mempool_delta requests. The most recent changes are
+/// retained, older sequences are answered with a full snapshot.
+/// This class is thread safe.
+class BCP_API mempool_journal
+{
+public:
+    typedef std::shared_ptr<const tx_mempool> transaction_ptr;
+
+    /// Retain up to the given number of changes.
+    mempool_journal(size_t history);
+
+    /// Record the addition of a transaction to the mempool.
+    void add(const hash_digest& hash, transaction_ptr transaction);
+
+    /// Record the removal of a transaction from the mempool.
+    void remove(const hash_digest& hash);
+
+    /// The sequence of the latest change.
+    uint64_t sequence() const;
+
+    /// The number of transactions in the mempool.
+    size_t size() const;
+
+    /// Answer the request with the net changes since its sequence.
+    void delta(const blockchain::fetch_mempool_delta_request& request,
+        blockchain::fetch_mempool_delta_reply& reply) const;
+
+private:
+    struct change
+    {
+        uint64_t sequence;
+        hash_digest hash;
+
+        // The added transaction, nullptr for a removal.
+        transaction_ptr transaction;
+    };
+
+    void record(const hash_digest& hash, transaction_ptr transaction);
+    void snapshot(blockchain::fetch_mempool_delta_reply& reply) const;
+
+    const size_t history_;
+
+    // These are protected by mutex.
+    uint64_t sequence_;
+    std::deque<change> changes_;
+    std::unordered_map<hash_digest, transaction_ptr> pool_;
+    mutable shared_mutex mutex_;
+};
+
+} // namespace protocol
+} // namespace libbitcoin
+
+#endif
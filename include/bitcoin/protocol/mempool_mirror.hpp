@@ -0,0 +1,72 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_PROTOCOL_MEMPOOL_MIRROR_HPP
+#define LIBBITCOIN_PROTOCOL_MEMPOOL_MIRROR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/blockchain.pb.h>
+#include <bitcoin/protocol/define.hpp>
+#include <bitcoin/protocol/interface.pb.h>
+
+namespace libbitcoin {
+namespace protocol {
+
+/// Client side replica of a server mempool, kept in sync by applying the
+/// replies of fetch_mempool_delta requests made from its sequence.
+/// This class is thread safe.
+class BCP_API mempool_mirror
+{
+public:
+    /// Construct an empty mirror, which requests a snapshot first.
+    mempool_mirror();
+
+    /// The sequence to request the next delta from.
+    uint64_t sequence() const;
+
+    /// Apply a delta or snapshot. False (and unchanged) if a delta does not
+    /// follow the mirror's sequence or the reply is malformed, in which case
+    /// a snapshot is to be requested (sequence zero).
+    bool apply(const blockchain::fetch_mempool_delta_reply& reply);
+
+    /// Get the transaction of the hash, false if not in the mempool.
+    bool find(const hash_digest& hash, tx_mempool& out) const;
+
+    /// True if the transaction is in the mempool.
+    bool contains(const hash_digest& hash) const;
+
+    /// The number of transactions in the mempool.
+    size_t size() const;
+
+    /// Discard all transactions and reset the sequence.
+    void clear();
+
+private:
+    // These are protected by mutex.
+    uint64_t sequence_;
+    std::unordered_map<hash_digest, tx_mempool> pool_;
+    mutable shared_mutex mutex_;
+};
+
+} // namespace protocol
+} // namespace libbitcoin
+
+#endif
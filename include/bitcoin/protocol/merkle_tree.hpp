@@ -0,0 +1,71 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_PROTOCOL_MERKLE_TREE_HPP
+#define LIBBITCOIN_PROTOCOL_MERKLE_TREE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/define.hpp>
+
+namespace libbitcoin {
+namespace protocol {
+
+/// The merkle tree of a block's transaction hashes, with all levels kept
+/// so that any number of branches are read without rehashing. Each level is
+/// hashed as a batch of 64 byte pairs, several pairs at a time.
+/// This class is not thread safe.
+class BCP_API merkle_tree
+{
+public:
+    /// Double SHA-256 of count 64 byte inputs, written as count hashes.
+    static void hash_pairs(const uint8_t* pairs, uint8_t* out, size_t count);
+
+    /// Build the tree of the transaction hashes, in block order.
+    merkle_tree(const hash_list& leaves);
+
+    /// The merkle root, null_hash if there are no leaves.
+    hash_digest root() const;
+
+    /// The number of leaves.
+    size_t size() const;
+
+    /// The sibling hashes of the leaf from the bottom up, false if the
+    /// index is out of range.
+    bool branch(size_t index, hash_list& out) const;
+
+    /// The BIP37 partial merkle tree (hashes and flag bits, packed least
+    /// significant bit first) of the leaves matched by index.
+    void partial(const std::vector<bool>& matches, hash_list& hashes,
+        data_chunk& flags) const;
+
+private:
+    size_t width(size_t height) const;
+    void traverse(size_t height, size_t position,
+        const std::vector<bool>& matches, hash_list& hashes,
+        std::vector<bool>& bits) const;
+
+    std::vector<hash_list> levels_;
+};
+
+} // namespace protocol
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_PROTOCOL_PUBLISH_QUEUE_HPP
+#define LIBBITCOIN_PROTOCOL_PUBLISH_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <google/protobuf/message_lite.h>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/define.hpp>
+#include <bitcoin/protocol/zmq/message.hpp>
+
+namespace libbitcoin {
+namespace protocol {
+
+/// The bounded queue of handler replies to one subscriber, sent without
+/// blocking so that a slow subscriber does not stall the others.
+/// This class is not thread safe, except for statistics.
+class BCP_API publish_queue
+{
+public:
+    /// The treatment of a subscriber whose queue is full.
+    enum class policy
+    {
+        /// Drop the oldest queued reply.
+        drop_oldest,
+
+        /// Replace a queued conflatable reply to the same handler with a
+        /// conflatable reply, else drop the oldest.
+        conflate,
+
+        /// Drop all replies and stop sending to the subscriber.
+        disconnect
+    };
+
+    struct statistics
+    {
+        size_t depth;
+        size_t sent;
+        size_t dropped;
+        bool disconnected;
+    };
+
+    /// Send the message without blocking, channel_timeout if it would block.
+    typedef std::function<code(zmq::message&)> send_function;
+
+    static constexpr size_t default_capacity = 1000;
+
+    publish_queue(send_function send, policy policy=policy::drop_oldest,
+        size_t capacity=default_capacity);
+
+    publish_queue(const publish_queue&) = delete;
+    void operator=(const publish_queue&) = delete;
+
+    /// Deletes the replies owned by unsent messages.
+    ~publish_queue();
+
+    /// Queue the reply to the handler id. Owned is the reply object passed
+    /// by the message over inproc, deleted if the message is dropped. Only
+    /// a conflatable reply (a subscription event, superseded by the next)
+    /// may be replaced under policy::conflate, never one-shot replies or
+    /// the chunks of a stream.
+    void push(const std::string& id, const zmq::message& message,
+        google::protobuf::MessageLite* owned=nullptr,
+        bool conflatable=false);
+
+    /// Send queued replies until the subscriber would block, true if none
+    /// remain.
+    bool flush();
+
+    /// True if the subscriber has been disconnected for being too slow.
+    bool disconnected() const;
+
+    /// Counters, which may be read from any thread.
+    statistics stats() const;
+
+private:
+    struct entry
+    {
+        std::string id;
+        zmq::message message;
+        google::protobuf::MessageLite* owned;
+    };
+
+    void pop_front();
+    void drop_front();
+    void drop_all();
+
+    const send_function send_;
+    const policy policy_;
+    const size_t capacity_;
+
+    // The queue position of an entry is its sequence less that of the front.
+    // Sequences are those of the last queued reply to each handler id, if
+    // conflatable.
+    std::deque<entry> entries_;
+    uint64_t front_sequence_;
+    std::unordered_map<std::string, uint64_t> sequences_;
+
+    std::atomic<size_t> depth_;
+    std::atomic<size_t> sent_;
+    std::atomic<size_t> dropped_;
+    std::atomic<bool> disconnected_;
+};
+
+} // namespace protocol
+} // namespace libbitcoin
+
+#endif
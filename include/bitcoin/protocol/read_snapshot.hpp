@@ -0,0 +1,111 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_PROTOCOL_READ_SNAPSHOT_HPP
+#define LIBBITCOIN_PROTOCOL_READ_SNAPSHOT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/database.pb.h>
+#include <bitcoin/protocol/define.hpp>
+#include <bitcoin/protocol/requester.hpp>
+
+namespace libbitcoin {
+namespace protocol {
+
+/// A consistent view of a remote store across database queries. The handle
+/// of begin_read tags each query and the server reports inline whether a
+/// write intervened, so no is_read_valid round trips are required.
+/// This class is not thread safe.
+class BCP_API read_snapshot
+{
+public:
+    /// Reads performed within the snapshot.
+    typedef std::function<code(read_snapshot& snapshot)> reads;
+
+    /// Server side, with the signature of store::is_read_valid.
+    typedef std::function<bool(uint64_t handle)> validate_function;
+
+    static constexpr size_t default_attempts = 8;
+    static constexpr int32_t default_retry_milliseconds = 1;
+
+    /// Perform the reads in a snapshot, starting them over in a new snapshot
+    /// while a write invalidates it, up to the number of attempts. The pause
+    /// before each new attempt doubles from the retry delay, so that a write
+    /// in progress can complete. Returns the code of the reads, or
+    /// operation_failed if never consistent.
+    static code read(requester& requester, reads body,
+        size_t attempts=default_attempts,
+        int32_t retry_milliseconds=default_retry_milliseconds);
+
+    /// Server side, call after performing the query: set the reply valid
+    /// unless the request snapshot was invalidated by a write.
+    template <typename Reply>
+    static void validate(const database::request& request,
+        validate_function is_read_valid, Reply& reply)
+    {
+        reply.set_read_valid(!request.has_snapshot() ||
+            is_read_valid(request.snapshot().handle()));
+    }
+
+    /// Begin a read on the store, one round trip.
+    read_snapshot(requester& requester);
+
+    read_snapshot(const read_snapshot&) = delete;
+    void operator=(const read_snapshot&) = delete;
+
+    /// False if the read failed to begin or was invalidated by a write.
+    operator const bool() const;
+
+    /// The handle of the store read.
+    uint64_t handle() const;
+
+    /// Send the request tagged with the snapshot. Returns operation_failed
+    /// and invalidates the snapshot if the store was written.
+    template <typename Reply>
+    code send(database::request& request, Reply& reply)
+    {
+        if (begin_)
+            return begin_;
+
+        if (!valid_)
+            return error::operation_failed;
+
+        request.mutable_snapshot()->set_handle(handle_);
+        const auto ec = requester_.send(request, reply);
+
+        if (ec)
+            return ec;
+
+        valid_ = reply.read_valid();
+        return valid_ ? error::success : error::operation_failed;
+    }
+
+private:
+    requester& requester_;
+    uint64_t handle_;
+    code begin_;
+    bool valid_;
+};
+
+} // namespace protocol
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,85 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_PROTOCOL_REPLAY_RING_HPP
+#define LIBBITCOIN_PROTOCOL_REPLAY_RING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <google/protobuf/message_lite.h>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/define.hpp>
+
+namespace libbitcoin {
+namespace protocol {
+
+/// The latest replies of a subscription, numbered by a sequence that
+/// starts at one, so that a subscriber reconnecting before they are
+/// overwritten resumes without missing any.
+/// This class is thread safe.
+class BCP_API replay_ring
+{
+public:
+    /// A shared replay ring pointer.
+    typedef std::shared_ptr<replay_ring> ptr;
+
+    /// A shared reply.
+    typedef std::shared_ptr<const google::protobuf::MessageLite> reply;
+
+    /// Send the reply to the handler id, called in sequence order.
+    typedef std::function<void(const std::string& handler_id,
+        uint64_t sequence, const reply& value)> send_handler;
+
+    replay_ring(const std::string& handler_id, size_t capacity);
+
+    /// The handler id that replies are sent to.
+    std::string handler_id() const;
+
+    /// The sequence of the latest reply, zero if none.
+    uint64_t sequence() const;
+
+    /// Number the reply with the next sequence, retain it and send it.
+    uint64_t push(reply value, send_handler send);
+
+    /// Send replies to the new handler id from now on, first sending the
+    /// retained replies after the last sequence received. False if replies
+    /// after the last sequence have been overwritten, or if the last
+    /// sequence is beyond any numbered here (a gap), in which case all
+    /// retained replies are sent.
+    bool resume(const std::string& handler_id, uint64_t last_sequence,
+        send_handler send);
+
+private:
+    const size_t capacity_;
+
+    // These are protected by mutex.
+    std::string handler_id_;
+    uint64_t sequence_;
+    std::vector<reply> replies_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace protocol
+} // namespace libbitcoin
+
+#endif
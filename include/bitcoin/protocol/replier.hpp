@@ -2,7 +2,10 @@
 #ifndef LIBBITCOIN_PROTOCOL_REPLIER_HPP
 #define LIBBITCOIN_PROTOCOL_REPLIER_HPP
 
+#include <atomic>
+#include <chrono>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <boost/optional.hpp>
@@ -10,6 +13,12 @@
 #include <bitcoin/bitcoin/config/endpoint.hpp>
 #include <bitcoin/bitcoin/utility/asio.hpp>
 #include <bitcoin/bitcoin/utility/thread.hpp>
+#include <bitcoin/protocol/admission_control.hpp>
+#include <bitcoin/protocol/capture.hpp>
+#include <bitcoin/protocol/publish_queue.hpp>
+#include <bitcoin/protocol/replay_ring.hpp>
+#include <bitcoin/protocol/response_cache.hpp>
+#include <bitcoin/protocol/subscription_matcher.hpp>
 #include <bitcoin/protocol/zmq/context.hpp>
 #include <bitcoin/protocol/zmq/message.hpp>
 #include <bitcoin/protocol/zmq/socket.hpp>
@@ -19,30 +28,195 @@ namespace protocol {
 
 class BCP_API replier
 {
+    typedef std::chrono::steady_clock clock;
+
+    // Held by the handlers of a subscriber endpoint, whose publisher may be
+    // pruned once no lease remains and its queue is empty.
+    typedef std::shared_ptr<const void> publisher_lease;
+
+    // The deadline and cancellation of a request answered by a handler.
+    struct request_state
+    {
+        typedef std::shared_ptr<request_state> ptr;
+
+        request_state(clock::time_point deadline, int request_class,
+            clock::time_point received)
+          : deadline(deadline),
+            request_class(request_class),
+            received(received),
+            cancelled(false)
+        {}
+
+        bool expired() const
+        {
+            return cancelled || clock::now() >= deadline;
+        }
+
+        const clock::time_point deadline;
+        const int request_class;
+        const clock::time_point received;
+        std::atomic<bool> cancelled;
+    };
+
     template <typename Message, typename Handler>
     class handler_wrapper
     {
     public:
         handler_wrapper(replier* replier_ptr,
-            std::string const& handler_id, Handler const& handler)
+            std::string const& handler_id, Handler const& handler,
+            publisher_lease lease, replay_ring::ptr ring=nullptr,
+            request_state::ptr state=nullptr)
+          : _replier_ptr(replier_ptr),
+            _handler_id(handler_id),
+            _handler(handler),
+            _local(replier_ptr->is_local(handler_id)),
+            _lease(lease),
+            _ring(ring),
+            _state(state)
+        {}
+
+        template <typename ...Args>
+        bool operator()(Args&&... args)
+        {
+            // The client no longer waits for the reply.
+            if (_state && _state->expired())
+                return true;
+
+            if (_state)
+                _replier_ptr->record_sojourn(*_state);
+
+            if (_ring)
+            {
+                // The ring retains the reply, sent to its current handler.
+                auto reply = std::make_shared<Message>();
+                _handler(std::forward<Args>(args)..., *reply);
+                _replier_ptr->send_sequenced_reply(_ring, reply);
+                return true;
+            }
+
+            // Only subscription events, made without request state, are
+            // superseded by the next and so may be conflated.
+            const auto conflatable = !_state;
+
+            if (_local)
+            {
+                // The reply object itself is handed to an inproc requester.
+                std::unique_ptr<Message> reply(new Message);
+                _handler(std::forward<Args>(args)..., *reply);
+                _replier_ptr->send_handler_reply(_handler_id, std::move(reply),
+                    conflatable);
+                return true;
+            }
+
+            Message reply;
+            _handler(std::forward<Args>(args)..., reply);
+            _replier_ptr->send_handler_reply(_handler_id, reply, conflatable);
+            return true;
+        }
+
+    private:
+        replier* _replier_ptr;
+        std::string _handler_id;
+        Handler _handler;
+        bool _local;
+        publisher_lease _lease;
+        replay_ring::ptr _ring;
+        request_state::ptr _state;
+    };
+
+    template <typename Message, typename Handler>
+    class cached_handler_wrapper
+    {
+    public:
+        cached_handler_wrapper(replier* replier_ptr,
+            std::string const& handler_id, std::string const& key,
+            Handler const& handler, publisher_lease lease,
+            request_state::ptr state)
           : _replier_ptr(replier_ptr),
             _handler_id(handler_id),
-            _handler(handler)
+            _key(key),
+            _handler(handler),
+            _lease(lease),
+            _state(state)
         {}
 
         template <typename ...Args>
         bool operator()(Args&&... args)
         {
+            if (_state->expired())
+                return true;
+
+            _replier_ptr->record_sojourn(*_state);
+
             Message reply;
             _handler(std::forward<Args>(args)..., reply);
-            _replier_ptr->send_handler_reply(_handler_id, reply);
+
+            size_t height;
+            if (response_cache::cacheable(reply, height))
+                _replier_ptr->send_cacheable_reply(_handler_id, _key, height,
+                    reply);
+            else
+                _replier_ptr->send_handler_reply(_handler_id, reply);
+
             return true;
         }
 
     private:
         replier* _replier_ptr;
         std::string _handler_id;
+        std::string _key;
         Handler _handler;
+        publisher_lease _lease;
+        request_state::ptr _state;
+    };
+
+    template <typename Message, typename Handler>
+    class filtered_handler_wrapper
+    {
+    public:
+        filtered_handler_wrapper(replier* replier_ptr,
+            std::string const& handler_id,
+            subscription_matcher const& matcher, Handler const& handler,
+            publisher_lease lease, replay_ring::ptr ring=nullptr)
+          : _replier_ptr(replier_ptr),
+            _handler_id(handler_id),
+            _matcher(matcher),
+            _handler(handler),
+            _local(replier_ptr->is_local(handler_id)),
+            _lease(lease),
+            _ring(ring)
+        {}
+
+        template <typename ...Args>
+        bool operator()(Args&&... args)
+        {
+            std::unique_ptr<Message> reply(new Message);
+            _handler(std::forward<Args>(args)..., *reply);
+
+            // Unmatched events are neither serialized nor sent.
+            if (!_matcher.apply(*reply))
+                return true;
+
+            if (_ring)
+                _replier_ptr->send_sequenced_reply(_ring,
+                    replay_ring::reply(std::move(reply)));
+            else if (_local)
+                _replier_ptr->send_handler_reply(_handler_id, std::move(reply),
+                    true);
+            else
+                _replier_ptr->send_handler_reply(_handler_id, *reply, true);
+
+            return true;
+        }
+
+    private:
+        replier* _replier_ptr;
+        std::string _handler_id;
+        subscription_matcher _matcher;
+        Handler _handler;
+        bool _local;
+        publisher_lease _lease;
+        replay_ring::ptr _ring;
     };
 
 public:
@@ -59,41 +233,255 @@ public:
 
     code bind(const config::endpoint& address);
 
+    /// Record requests, replies and handler replies (call before bind).
+    void set_capture(capture::ptr capture);
+
+    /// Serve replies about deep blocks from the cache (call before bind).
+    void set_response_cache(response_cache::ptr cache);
+
+    /// Shed requests of classes whose replies are delayed beyond the target
+    /// (call before bind). A shed request is answered with a status reply
+    /// of peer_throttling (see requester::set_backoff).
+    void set_admission_control(admission_control::ptr admission);
+
+    /// Bound the handler replies queued to each subscriber, and set the
+    /// treatment of a subscriber that falls behind (call before bind).
+    void set_publish_policy(publish_queue::policy policy, size_t capacity);
+
+    /// Retain the latest replies of each subscription, numbered in a
+    /// sequence part after the reply, for resume (call before bind).
+    /// Zero, the default, disables sequencing.
+    void set_replay_capacity(size_t capacity);
+
+    /// Send the replies of a subscription to the new handler id of its
+    /// reconnected subscriber, starting with those retained after the last
+    /// sequence it received. A gap in the sequence means replies were lost.
+    /// Returns not_found if the subscription is unknown, ended or not
+    /// sequenced, and operation_failed if resumed with a gap, in which case
+    /// the subscriber must resynchronize.
+    code resume(std::string const& handler_id,
+        std::string const& new_handler_id, uint64_t last_sequence);
+
+    /// True if the client cancelled the request answered by the handler or
+    /// the deadline of the request has passed, so that work may be skipped.
+    bool expired(std::string const& handler_id) const;
+
+    /// Skip the reply to the handler (see blockchain::cancel_request).
+    void cancel(std::string const& handler_id);
+
+    /// Queue depth and counters by subscriber endpoint.
+    std::map<std::string, publish_queue::statistics> publish_statistics()
+        const;
+
+    /// Send the cached reply of the request key (see response_cache::to_key)
+    /// to the handler without serialization, false if not cached.
+    bool send_cached(std::string const& handler_id, std::string const& key);
+
+    /// Returns peer_throttling if the request was shed, in which case its
+    /// reply has been sent.
     code receive(google::protobuf::MessageLite& request);
 
     code send(zmq::message& reply);
 
+    /// Send the reply, passing ownership of the object when bound to inproc.
+    code send(std::unique_ptr<google::protobuf::MessageLite> reply);
+
+    /// The handler expires at the deadline of the request last received,
+    /// so make it before receiving the next.
     template <typename Message, typename Handler>
     handler_wrapper<Message, Handler> make_handler(
         std::string const& handler_id, Handler const& handler)
     {
-        publish_connect(handler_id);
+        publisher_lease lease;
+        publish_connect(handler_id, lease);
 
-        return { this, handler_id, handler };
+        return { this, handler_id, handler, lease, nullptr,
+            make_request(handler_id) };
+    }
+
+    /// As make_handler, but the serialized reply is also cached under the
+    /// request key once deep enough. Over inproc the reply is serialized.
+    template <typename Message, typename Handler>
+    cached_handler_wrapper<Message, Handler> make_cached_handler(
+        std::string const& handler_id, std::string const& key,
+        Handler const& handler)
+    {
+        publisher_lease lease;
+        publish_connect(handler_id, lease);
+
+        return { this, handler_id, key, handler, lease,
+            make_request(handler_id) };
+    }
+
+    /// Send chunks to the handler as produced by next(Message&), which
+    /// returns false once it has filled the last chunk.
+    template <typename Message, typename Next>
+    void send_stream(std::string const& handler_id, Next next)
+    {
+        publisher_lease lease;
+        publish_connect(handler_id, lease);
+        const auto local = is_local(handler_id);
+        auto more = true;
+
+        while (more)
+        {
+            std::unique_ptr<Message> chunk(new Message);
+            more = next(*chunk);
+
+            if (local)
+                send_handler_reply(handler_id, std::move(chunk));
+            else
+                send_handler_reply(handler_id, *chunk);
+        }
     }
 
     template <typename Message, typename Handler>
     handler_wrapper<Message, Handler> make_subscription(
         std::string const& handler_id, Handler const& handler)
     {
-        return make_handler<Message>(handler_id, handler);
+        publisher_lease lease;
+        publish_connect(handler_id, lease);
+
+        return { this, handler_id, handler, lease, make_replay(handler_id) };
     }
 
+    /// As make_subscription, with the events filtered for the subscriber
+    /// (compiled from the filter of the subscribe request) before sending.
+    template <typename Message, typename Handler>
+    filtered_handler_wrapper<Message, Handler> make_filtered_subscription(
+        std::string const& handler_id, subscription_matcher const& matcher,
+        Handler const& handler)
+    {
+        publisher_lease lease;
+        publish_connect(handler_id, lease);
+
+        return { this, handler_id, matcher, handler, lease,
+            make_replay(handler_id) };
+    }
+
+    /// False if the handler id of a request is malformed, in which case the
+    /// request is to be rejected. Replies to such a handler are dropped.
+    /// The endpoint must be a tcp "host:port", or an inproc address if the
+    /// replier is bound to inproc, as no other transport is connected.
+    static bool is_valid_handler(std::string const& handler_id,
+        bool inproc=false);
+
 private:
-    code publish_connect(std::string const& handler_id);
+    // True if replies to the handler pass ownership of the object, which
+    // requires that the replier itself is bound to inproc.
+    bool is_local(std::string const& handler_id) const;
+
+    code publish_connect(std::string const& handler_id,
+        publisher_lease& out_lease);
+
+    // Conflatable replies may be replaced in the queue of a slow subscriber
+    // under publish_queue::policy::conflate.
+    void send_handler_reply(std::string const& handler_id,
+        const google::protobuf::MessageLite& reply, bool conflatable=false);
 
     void send_handler_reply(std::string const& handler_id,
+        std::unique_ptr<google::protobuf::MessageLite> reply,
+        bool conflatable=false);
+
+    void send_cacheable_reply(std::string const& handler_id,
+        std::string const& key, size_t height,
         const google::protobuf::MessageLite& reply);
 
+    void send_handler_payload(std::string const& handler_id,
+        response_cache::payload payload);
+
+    replay_ring::ptr make_replay(std::string const& handler_id);
+
+    request_state::ptr make_request(std::string const& handler_id);
+
+    void record_sojourn(request_state const& state);
+
+    code send_overloaded(const google::protobuf::MessageLite& request);
+
+    void send_sequenced_reply(replay_ring::ptr const& ring,
+        replay_ring::reply reply);
+
+    void send_sequenced_reply(std::string const& handler_id,
+        uint64_t sequence, const google::protobuf::MessageLite& reply);
+
+    // The socket and queue of a subscriber endpoint.
+    struct publisher
+    {
+        publisher(zmq::context& context, publish_queue::policy policy,
+            size_t capacity);
+
+        zmq::socket socket;
+        publish_queue queue;
+        std::weak_ptr<const void> lease;
+
+        // When the queue last became blocked, zero while it is not.
+        clock::time_point blocked_since;
+    };
+
+    typedef std::map<std::string, publisher> publishers;
+
+    void publish(std::string const& endpoint, std::string const& id,
+        zmq::message const& message,
+        google::protobuf::MessageLite* owned=nullptr,
+        bool conflatable=false);
+
+    static publisher_lease lease(publisher& target);
+    void prune_publishers();
+    void flush_publishers();
+    void schedule_flush();
+
 private:
     zmq::context& _context;
     boost::optional<zmq::socket> _socket;
 
+    // Requests and replies are passed by pointer over inproc.
+    bool _inproc = false;
+
+    // Optional traffic log, set before bind.
+    capture::ptr _capture;
+
+    // Optional cache of serialized replies, set before bind.
+    response_cache::ptr _response_cache;
+
+    // Queues of blocked subscribers are retried on the handlers thread.
+    publish_queue::policy _publish_policy = publish_queue::policy::drop_oldest;
+    size_t _publish_capacity = publish_queue::default_capacity;
+    bool _flush_pending = false;
+
+    // Optional load shedding, set before bind.
+    admission_control::ptr _admission;
+
+    // The request last received, set by receive, and the time it was sent.
+    // Its sojourn is recorded on reply, unless answered by a handler.
+    clock::time_point _request_deadline = clock::time_point::max();
+    clock::time_point _request_received;
+    int _request_class = 0;
+    bool _request_handled = false;
+
+    // Requests awaiting handler replies, pruned once released.
+    std::map<std::string, std::weak_ptr<request_state>> _requests;
+    size_t _requests_prune_size = 0;
+
+    // Subscription replies retained for resume, by current handler id,
+    // with the lease of the endpoint resumed to. The subscription's handler
+    // owns the ring, which is pruned once the subscription ends.
+    struct replay
+    {
+        std::weak_ptr<replay_ring> ring;
+        publisher_lease lease;
+    };
+
+    size_t _replay_capacity = 0;
+    std::map<std::string, replay> _replays;
+    size_t _replays_prune_size = 0;
+
     mutable std::mutex _handlers_mutex;
     asio::service _handlers_service;
     asio::thread _handlers_thread;
     asio::service::work _handlers_work;
-    std::map<std::string, zmq::socket> _publish_sockets;
+    asio::steady_timer _flush_timer;
+    publishers _publishers;
+    size_t _publishers_prune_size = 0;
 };
 
 } // namespace protocol
@@ -7,8 +7,13 @@
 #ifndef LIBBITCOIN_PROTOCOL_REQUESTER_HPP
 #define LIBBITCOIN_PROTOCOL_REQUESTER_HPP
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <boost/optional.hpp>
@@ -16,6 +21,8 @@
 #include <bitcoin/bitcoin/config/endpoint.hpp>
 #include <bitcoin/bitcoin/utility/asio.hpp>
 #include <bitcoin/bitcoin/utility/thread.hpp>
+#include <bitcoin/protocol/capture.hpp>
+#include <bitcoin/protocol/header_cache.hpp>
 #include <bitcoin/protocol/zmq/context.hpp>
 #include <bitcoin/protocol/zmq/socket.hpp>
 
@@ -25,6 +32,8 @@ namespace protocol {
 class BCP_API requester
 {
 public:
+    static constexpr int32_t default_backoff_milliseconds = 10;
+    static constexpr int32_t default_maximum_backoff_milliseconds = 1000;
 
     requester(zmq::context& context);
 
@@ -41,9 +50,47 @@ public:
 
     code disconnect();
 
+    /// Record requests, replies and handler replies (call before connect).
+    void set_capture(capture::ptr capture);
+
+    /// Answer header, block hash and height requests from the cache where
+    /// possible, populated from replies and pruned on reorganization
+    /// notifications (call before connect). The top, which bounds the
+    /// blocks cached, follows last height replies and reorganizations.
+    void set_header_cache(header_cache::ptr cache);
+
+    /// Bound the wait for replies, zero (the default) to wait forever (call
+    /// before connect). Blockchain requests carry the timeout, so that the
+    /// server may skip late work. On timeout send returns channel_timeout
+    /// and reconnects, and a handler is released, first invoked with error
+    /// channel_timeout if its reply has an error field.
+    void set_timeout(int32_t timeout_milliseconds);
+
+    /// When the server sheds a request (see replier::set_admission_control)
+    /// further requests of its class fail with peer_throttling, without
+    /// being sent, for the backoff. The backoff doubles while requests are
+    /// shed, up to the maximum, and is cleared by a reply. Zero disables
+    /// (call before connect).
+    void set_backoff(int32_t initial_milliseconds,
+        int32_t maximum_milliseconds);
+
     code send(const google::protobuf::MessageLite& request,
               google::protobuf::MessageLite& reply);
 
+    /// Release the handler and ask the server to skip its reply.
+    code cancel(std::string const& handler_id);
+
+    /// The handler id of a subscription under the current subscriber
+    /// endpoint, which changes on reconnection, and the sequence of the last
+    /// reply received (zero if none or not sequenced), with which to ask the
+    /// server to resume it. False if not subscribed.
+    bool resume_point(std::string const& handler_id,
+        std::string& out_handler_id, uint64_t& out_sequence) const;
+
+    /// The number of handler replies dropped for arriving after their
+    /// handler expired, was cancelled or was removed.
+    size_t dropped_replies() const;
+
     template <typename Message, typename Arg, typename Handler>
     std::string make_handler(Arg const& arg, Handler const& handler)
     {
@@ -61,6 +108,8 @@ public:
                 handler(arg, message);
                 return error::success;
             };
+        h.local = make_local<Message>(arg, handler);
+        h.expire = make_expire<Message>(arg, handler);
 
         return add_handler(Message{}.GetTypeName(), std::move(h));
     }
@@ -82,11 +131,58 @@ public:
                 handler(arg, message);
                 return error::success;
             };
+        h.local = make_local<Message>(arg, handler);
 
         return add_handler(Message{}.GetTypeName(), std::move(h));
 
     }
 
+    /// As make_subscription, for a stream of chunks (Message has a last
+    /// field), the handler is released after the last chunk.
+    template <typename Message, typename Arg, typename Handler>
+    std::string make_stream(Arg const& arg, Handler const& handler)
+    {
+        auto const id = std::make_shared<std::string>();
+        auto const name = Message{}.GetTypeName();
+
+        handler_type h;
+        h.single = false;
+        h.function =
+            [=] (const data_chunk& payload) -> code
+            {
+                Message message;
+                const void* data = payload.data();
+                const int size = static_cast<int>(payload.size());
+                if (!message.ParseFromArray(data, size))
+                    return error::bad_stream;
+
+                handler(arg, message);
+
+                if (message.last())
+                    remove_handler(*id);
+
+                return error::success;
+            };
+        h.local =
+            [=] (const google::protobuf::MessageLite& message) -> code
+            {
+                if (message.GetTypeName() != name)
+                    return error::bad_stream;
+
+                auto const& chunk = static_cast<const Message&>(message);
+                handler(arg, chunk);
+
+                if (chunk.last())
+                    remove_handler(*id);
+
+                return error::success;
+            };
+
+        // No chunk arrives before the request is sent, after this returns.
+        *id = add_handler(name, std::move(h));
+        return *id;
+    }
+
 
     code simple_req_connect(const config::endpoint& address);
 
@@ -94,24 +190,98 @@ public:
                          google::protobuf::MessageLite& reply);
 
 private:
+    typedef std::chrono::steady_clock clock;
+
     struct handler_type
     {
         bool single = true;
         std::function<code(const data_chunk&)> function;
+
+        // A single handler is released at expiry, calling expire if set.
+        clock::time_point expiry = clock::time_point::max();
+        std::function<void()> expire;
+
+        // The sequence of the last reply to a sequenced subscription.
+        uint64_t sequence = 0;
+
+        // Invoked instead of function for process-local (inproc) replies.
+        std::function<code(const google::protobuf::MessageLite&)> local;
     };
 
+    template <typename Message, typename Arg, typename Handler>
+    static std::function<code(const google::protobuf::MessageLite&)>
+        make_local(Arg const& arg, Handler const& handler)
+    {
+        const std::string name = Message{}.GetTypeName();
+        return
+            [=] (const google::protobuf::MessageLite& message) -> code
+            {
+                if (message.GetTypeName() != name)
+                    return error::bad_stream;
+
+                handler(arg, static_cast<const Message&>(message));
+                return error::success;
+            };
+    }
+
+    template <typename Message>
+    static auto set_timeout_error(Message& message, int)
+        -> decltype(message.set_error(0), bool())
+    {
+        message.set_error(error::channel_timeout);
+        return true;
+    }
+
+    template <typename Message>
+    static bool set_timeout_error(Message&, long)
+    {
+        return false;
+    }
+
+    template <typename Message, typename Arg, typename Handler>
+    static std::function<void()> make_expire(Arg const& arg,
+        Handler const& handler)
+    {
+        return
+            [=] ()
+            {
+                Message message;
+                if (set_timeout_error(message, 0))
+                    handler(arg, message);
+            };
+    }
+
     code do_connect(const config::endpoint& address);
 
+    code do_reconnect();
+
+    bool backing_off(int request_class) const;
+    void back_off(int request_class);
+
     code do_send(const google::protobuf::MessageLite& request,
                  google::protobuf::MessageLite& reply);
 
     std::string add_handler(const std::string& message_name,
                             handler_type handler);
 
+    void remove_handler(const std::string& handler_id);
+
+    void expire_handlers();
+
     void call_handler(const std::string& id,
-        const data_chunk& payload);
+        const data_chunk& payload, uint64_t sequence=0);
+
+    bool answer_from_cache(const google::protobuf::MessageLite& request,
+        google::protobuf::MessageLite& reply);
+
+    void populate_cache(const google::protobuf::MessageLite& request,
+        const google::protobuf::MessageLite& reply);
+
+    void populate_cache(const std::string& id, const data_chunk& payload,
+        const google::protobuf::MessageLite* local);
 
     zmq::context& _context;
+    config::endpoint _address;
     asio::service _io_service;
     asio::service::work _io_work;
     boost::optional<zmq::socket> _socket;
@@ -128,6 +298,35 @@ private:
     bc::threadpool _handlers_threadpool;
     boost::optional<zmq::socket> _subscriber_socket;
     std::string _subscriber_endpoint;
+
+    // Requests and handler replies are passed by pointer over inproc.
+    bool _inproc = false;
+
+    // Optional traffic log, set before connect.
+    capture::ptr _capture;
+
+    // Optional header cache, set before connect.
+    header_cache::ptr _header_cache;
+
+    // Milliseconds to wait for replies, set before connect, zero if forever.
+    int32_t _timeout = 0;
+
+    // Handler replies without a handler, counted on the io thread.
+    std::atomic<size_t> _dropped_replies{ 0 };
+
+    // The backoff of request classes shed by the server, used on the io
+    // thread only.
+    struct backoff
+    {
+        clock::duration delay;
+        clock::time_point until;
+    };
+
+    clock::duration _initial_backoff =
+        std::chrono::milliseconds(default_backoff_milliseconds);
+    clock::duration _maximum_backoff =
+        std::chrono::milliseconds(default_maximum_backoff_milliseconds);
+    std::map<int, backoff> _backoffs;
 };
 
 } // namespace protocol
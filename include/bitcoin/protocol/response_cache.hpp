@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_PROTOCOL_RESPONSE_CACHE_HPP
+#define LIBBITCOIN_PROTOCOL_RESPONSE_CACHE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/blockchain.pb.h>
+#include <bitcoin/protocol/define.hpp>
+
+namespace libbitcoin {
+namespace protocol {
+
+/// Serialized replies of queries about blocks buried deep enough to be
+/// treated as immutable, within a memory budget and with CLOCK eviction.
+/// This class is thread safe.
+class BCP_API response_cache
+{
+public:
+    /// A shared response cache pointer.
+    typedef std::shared_ptr<response_cache> ptr;
+
+    /// A shared serialized reply.
+    typedef std::shared_ptr<const data_chunk> payload;
+
+    /// Replies are retained once their block has min_depth confirmations.
+    response_cache(size_t budget_bytes, size_t min_depth);
+
+    /// The key of a cacheable request (request type and normalized
+    /// parameters), false if the request type is not cacheable. Transaction
+    /// fetches are cacheable only if they require a confirmed transaction.
+    static bool to_key(const blockchain::request& request, std::string& out);
+
+    /// The block height of a successful reply, false if failed.
+    static bool cacheable(const blockchain::fetch_block_handler& reply,
+        size_t& out_height);
+    static bool cacheable(const blockchain::fetch_block_header_handler& reply,
+        size_t& out_height);
+    static bool cacheable(const blockchain::fetch_merkle_block_handler& reply,
+        size_t& out_height);
+    static bool cacheable(const blockchain::fetch_transaction_handler& reply,
+        size_t& out_height);
+
+    /// Set the height of the top block, which determines reply depth.
+    void set_top(size_t height);
+
+    /// Discard replies for blocks above the fork point.
+    void reorganize(size_t fork_point);
+
+    /// The cached reply for the key, nullptr if not cached.
+    payload find(const std::string& key);
+
+    /// Cache the reply if its block is deep enough, false if not cached.
+    bool store(const std::string& key, size_t height, payload value);
+
+    /// Discard all replies.
+    void clear();
+
+    /// The number of cached replies.
+    size_t size() const;
+
+    /// The number of bytes accounted to cached replies and keys.
+    size_t bytes() const;
+
+private:
+    struct slot
+    {
+        std::string key;
+        payload value;
+        size_t height;
+        bool referenced;
+    };
+
+    static size_t cost(const slot& entry);
+    void evict(size_t index);
+    bool make_room(size_t needed);
+
+    const size_t budget_;
+    const size_t min_depth_;
+
+    // These are protected by mutex.
+    size_t top_;
+    size_t bytes_;
+    size_t hand_;
+    std::vector<slot> slots_;
+    std::vector<size_t> free_;
+    std::unordered_map<std::string, size_t> index_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace protocol
+} // namespace libbitcoin
+
+#endif
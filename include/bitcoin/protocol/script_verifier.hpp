@@ -0,0 +1,83 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_PROTOCOL_SCRIPT_VERIFIER_HPP
+#define LIBBITCOIN_PROTOCOL_SCRIPT_VERIFIER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/consensus.pb.h>
+#include <bitcoin/protocol/define.hpp>
+
+namespace libbitcoin {
+namespace protocol {
+
+/// Serves consensus verify_scripts requests by fanning the inputs out in
+/// chunks across a threadpool. Script evaluation is supplied by the server,
+/// with the signature of consensus::verify_script.
+/// This class is thread safe.
+class BCP_API script_verifier
+{
+public:
+    typedef std::shared_ptr<const consensus::verify_scripts_request>
+        request_ptr;
+    typedef std::function<void(const code&,
+        const consensus::verify_scripts_reply&)> result_handler;
+    typedef std::function<uint32_t(const uint8_t* transaction,
+        size_t transaction_size, const uint8_t* prevout_script,
+        size_t prevout_script_size, uint64_t prevout_amount,
+        uint32_t tx_input_index, uint32_t flags)> verify_function;
+
+    /// Chunks per pool thread, so that uneven inputs balance out.
+    static constexpr size_t chunks_per_thread = 4;
+
+    /// The pool must outlive all requests.
+    script_verifier(threadpool& pool, verify_function verify);
+
+    /// Verify all inputs of the request, invoking the handler on a pool
+    /// thread once all are done, never on the calling thread. The result
+    /// is bad_stream if an input refers to a missing transaction.
+    void verify(request_ptr request, result_handler handler);
+
+private:
+    struct batch
+    {
+        request_ptr request;
+        result_handler handler;
+        verify_function verify;
+        std::vector<uint32_t> results;
+        std::atomic<size_t> remaining;
+    };
+
+    typedef std::shared_ptr<batch> batch_ptr;
+
+    static void verify_range(batch_ptr work, size_t begin, size_t end);
+
+    threadpool& pool_;
+    const verify_function verify_;
+};
+
+} // namespace protocol
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,132 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_PROTOCOL_STEALTH_SCANNER_HPP
+#define LIBBITCOIN_PROTOCOL_STEALTH_SCANNER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/define.hpp>
+#include <bitcoin/protocol/interface.pb.h>
+
+namespace libbitcoin {
+namespace protocol {
+
+/// Serves stealth_database_scan and fetch_stealth requests. Rows are held
+/// in columns, so that the prefix filter is a masked compare over a
+/// contiguous array, and heights are scanned in ranges across a
+/// threadpool, with results merged in height order.
+/// This class is thread safe.
+class BCP_API stealth_scanner
+{
+public:
+    static constexpr size_t ephemeral_public_key_hash_size = hash_size;
+    static constexpr size_t public_key_hash_size = short_hash_size;
+    static constexpr size_t transaction_hash_size = hash_size;
+
+    /// Stealth rows as columns, the hashes at fixed width.
+    struct rows
+    {
+        std::vector<uint32_t> prefixes;
+        std::vector<uint64_t> heights;
+        data_chunk ephemeral_public_key_hashes;
+        data_chunk public_key_hashes;
+        data_chunk transaction_hashes;
+
+        size_t size() const;
+        void clear();
+
+        /// Append the row of the other rows at the position.
+        void append(const rows& other, size_t position);
+    };
+
+    /// A stealth prefix filter (as bc::binary of up to 32 bits).
+    struct filter
+    {
+        uint32_t mask;
+        uint32_t value;
+    };
+
+    /// Get the rows of heights in [from_height, to_height), in height order.
+    /// This is called concurrently.
+    typedef std::function<bool(uint64_t from_height, uint64_t to_height,
+        rows& out)> fetch_function;
+
+    typedef std::function<void(const code&, const rows&)> result_handler;
+
+    static constexpr uint64_t default_heights_per_range = 10000;
+
+    /// Parse the filter of bits in blocks, false if malformed. Filters
+    /// longer than a prefix are valid but match nothing.
+    static bool to_filter(uint64_t bits, const std::string& blocks,
+        filter& out);
+
+    /// Append the positions of the prefixes matching the filter.
+    static void match(const filter& filter,
+        const std::vector<uint32_t>& prefixes, std::vector<size_t>& out);
+
+    /// Encode the rows as fixed width columns.
+    static void to_columns(const rows& rows, stealth_compact_columns& out);
+
+    /// Decode the columns (without prefixes and heights), false if
+    /// malformed.
+    static bool from_columns(const stealth_compact_columns& columns,
+        rows& out);
+
+    /// The pool must outlive all scans.
+    stealth_scanner(threadpool& pool, fetch_function fetch,
+        uint64_t heights_per_range=default_heights_per_range);
+
+    /// Scan heights in [from_height, to_height) for the filter, invoking
+    /// the handler on a pool thread once all ranges are done, never on the
+    /// calling thread, even if there are none. The result is
+    /// operation_failed if a fetch fails.
+    void scan(const filter& filter, uint64_t from_height, uint64_t to_height,
+        result_handler handler);
+
+private:
+    struct batch
+    {
+        filter prefix;
+        result_handler handler;
+        fetch_function fetch;
+        std::vector<rows> results;
+        std::atomic<bool> failed;
+        std::atomic<size_t> remaining;
+    };
+
+    typedef std::shared_ptr<batch> batch_ptr;
+
+    static void scan_range(batch_ptr work, size_t range, uint64_t from_height,
+        uint64_t to_height);
+
+    threadpool& pool_;
+    const fetch_function fetch_;
+    const uint64_t heights_per_range_;
+};
+
+} // namespace protocol
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,69 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_PROTOCOL_SUBSCRIPTION_MATCHER_HPP
+#define LIBBITCOIN_PROTOCOL_SUBSCRIPTION_MATCHER_HPP
+
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/blockchain.pb.h>
+#include <bitcoin/protocol/bloom_filter.hpp>
+#include <bitcoin/protocol/define.hpp>
+#include <bitcoin/protocol/filter_engine.hpp>
+#include <bitcoin/protocol/interface.pb.h>
+
+namespace libbitcoin {
+namespace protocol {
+
+/// The compiled subscription_filter of a subscriber, applied to each event
+/// before it is serialized (see replier::make_filtered_subscription).
+/// This class is thread safe once compiled.
+class BCP_API subscription_matcher
+{
+public:
+    /// Matches all transactions.
+    subscription_matcher();
+
+    /// Compile the filter, false if malformed.
+    bool compile(const blockchain::subscription_filter& filter,
+        bool headers_only=false);
+
+    /// True if the transaction matches.
+    bool match(const tx& transaction) const;
+
+    /// False if the event is not to be sent (failures are always sent).
+    bool apply(blockchain::subscribe_transaction_handler& event) const;
+
+    /// Remove unmatched transactions from the blocks, or all if headers
+    /// only. Reorganizations are always sent.
+    bool apply(blockchain::subscribe_reorganize_handler& event) const;
+
+private:
+    void apply(blockchain::subscribe_reorganize_handler::block_message&
+        message) const;
+
+    bool all_;
+    bool headers_only_;
+    bool hash_filters_;
+    filter_engine prefixes_;
+    bloom_filter bloom_;
+};
+
+} // namespace protocol
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,82 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_PROTOCOL_UTXO_BATCH_HPP
+#define LIBBITCOIN_PROTOCOL_UTXO_BATCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/database.pb.h>
+#include <bitcoin/protocol/define.hpp>
+
+namespace libbitcoin {
+namespace protocol {
+
+/// Encoding and serving of get_transaction_outputs, which looks up the
+/// outputs of many points in one round trip.
+class BCP_API utxo_batch
+{
+public:
+    /// The size of a packed point, its hash then its little endian index.
+    static constexpr size_t point_size = hash_size + sizeof(uint32_t);
+
+    struct utxo
+    {
+        bool found;
+        chain::output output;
+        size_t height;
+        bool coinbase;
+    };
+
+    typedef std::vector<utxo> list;
+
+    /// Get the output of the point, with the signature of
+    /// transaction_database::get_output.
+    typedef std::function<bool(chain::output& out_output, size_t& out_height,
+        bool& out_coinbase, const chain::output_point& point,
+        size_t fork_height, bool require_confirmed)> fetch_function;
+
+    /// Encode the request for the points.
+    static void to_request(const chain::output_point::list& points,
+        size_t fork_height, bool require_confirmed,
+        database::get_transaction_outputs_request& out);
+
+    /// Decode the points of the request, false if malformed.
+    static bool to_points(
+        const database::get_transaction_outputs_request& request,
+        chain::output_point::list& out);
+
+    /// Look up each distinct point once, in point order, and encode the
+    /// reply in request order. The reply result is false if the request is
+    /// malformed.
+    static void lookup(const database::get_transaction_outputs_request& request,
+        fetch_function fetch, database::get_transaction_outputs_reply& out);
+
+    /// Decode the reply to a request of count points, by point position,
+    /// false if the reply failed or is malformed.
+    static bool from_reply(const database::get_transaction_outputs_reply& reply,
+        size_t count, list& out);
+};
+
+} // namespace protocol
+} // namespace libbitcoin
+
+#endif
@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_PROTOCOL_ZMQ_ACCESS_LIST_HPP
+#define LIBBITCOIN_PROTOCOL_ZMQ_ACCESS_LIST_HPP
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/define.hpp>
+
+namespace libbitcoin {
+namespace protocol {
+namespace zmq {
+
+/// Allow and deny rules over ipv4 and ipv6 address ranges (CIDR).
+/// Ipv4 addresses are matched as ipv4 mapped ipv6 addresses.
+/// The longest matching prefix determines the rule, deny wins a tie.
+/// Readers match against an immutable snapshot and do not lock.
+/// This class is thread safe.
+class BCP_API access_list
+{
+public:
+    /// A 16 byte (ipv6 or ipv4 mapped) address.
+    typedef std::array<uint8_t, 16> address;
+
+    /// The rule that applies to an address.
+    enum class rule : uint8_t
+    {
+        none = 0,
+        allow = 1,
+        deny = 2
+    };
+
+    /// A rule over an address range, prefix bits relative to the family.
+    struct range
+    {
+        typedef std::vector<range> list;
+
+        asio::ipv6 ip;
+        size_t prefix_bits;
+        rule value;
+    };
+
+    /// Parse an ipv4 or ipv6 address, ipv4 prefixes are offset by 96 bits.
+    static bool parse(const std::string& text, address& out,
+        size_t& prefix_offset);
+
+    /// Construct an empty list, all addresses allowed.
+    access_list();
+
+    /// Allow the range, prefix bits relative to the address family.
+    bool allow(const asio::ipv6& ip, size_t prefix_bits);
+
+    /// Deny the range, prefix bits relative to the address family.
+    bool deny(const asio::ipv6& ip, size_t prefix_bits);
+
+    /// Add the rules in one update, so a large list is not copied per rule.
+    /// False, adding none, if any prefix is out of range.
+    bool add(const range::list& ranges);
+
+    /// Remove all rules.
+    void clear();
+
+    /// The rule of the longest matching prefix, none if unmatched.
+    rule match(const address& value) const;
+
+    /// Unmatched addresses are allowed unless there is an allow rule.
+    bool allowed(const address& value) const;
+
+    /// As allowed, an unparseable address is treated as unmatched.
+    bool allowed(const std::string& text) const;
+
+private:
+    // Children are node indexes, zero (the root) denotes no child.
+    struct node
+    {
+        uint32_t children[2];
+        rule value;
+    };
+
+    struct table
+    {
+        std::vector<node> nodes;
+        bool whitelist;
+    };
+
+    typedef std::shared_ptr<const table> snapshot;
+
+    static bool to_prefix(const asio::ipv6& ip, size_t prefix_bits,
+        address& out, size_t& out_bits);
+    static void insert(table& rules, const address& bytes, size_t bits,
+        rule value);
+    static rule match(const table& rules, const address& value);
+
+    // Writers copy the table and publish the copy atomically.
+    snapshot table_;
+    std::mutex write_mutex_;
+};
+
+} // namespace zmq
+} // namespace protocol
+} // namespace libbitcoin
+
+#endif
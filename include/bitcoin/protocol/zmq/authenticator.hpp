@@ -27,7 +27,10 @@
 #include <unordered_set>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/protocol/define.hpp>
+#include <bitcoin/protocol/zmq/access_list.hpp>
 #include <bitcoin/protocol/zmq/context.hpp>
+#include <bitcoin/protocol/zmq/key_store.hpp>
+#include <bitcoin/protocol/zmq/message.hpp>
 #include <bitcoin/protocol/zmq/socket.hpp>
 #include <bitcoin/protocol/zmq/worker.hpp>
 
@@ -46,8 +49,12 @@ public:
     /// The fixed inprocess authentication endpoint.
     static const config::endpoint endpoint;
 
+    /// The default number of ZAP worker threads.
+    static const size_t default_workers;
+
     /// There may be only one authenticator per process.
-    authenticator(threadpool& threadpool);
+    authenticator(threadpool& threadpool,
+        size_t workers=default_workers);
 
     /// Stop the router.
     virtual ~authenticator();
@@ -73,30 +80,78 @@ public:
     /// Allow clients with the following public keys (whitelist).
     virtual void allow(const hash_digest& public_key);
 
+    /// Revoke a previously allowed client public key.
+    /// Revoking the last key denies all keys, it does not allow all.
+    virtual void revoke(const hash_digest& public_key);
+
+    /// Replace the allowed client public keys with those of a key file of
+    /// sorted 32 byte keys (see key_store), false if the file is invalid.
+    /// An empty or invalid file denies all keys not previously allowed.
+    virtual bool load_keys(const std::string& path);
+
     /// Allow clients with the following ip addresses (whitelist).
     virtual void allow(const config::authority& address);
 
     /// Allow clients with the following ip addresses (blacklist).
     virtual void deny(const config::authority& address);
 
+    /// Allow clients within the address range (whitelist), prefix bits are
+    /// relative to the address family, false if the prefix is out of range.
+    virtual bool allow(const config::authority& address, size_t prefix_bits);
+
+    /// Deny clients within the address range (blacklist), prefix bits are
+    /// relative to the address family, false if the prefix is out of range.
+    virtual bool deny(const config::authority& address, size_t prefix_bits);
+
+    /// Add address range rules in one update (see access_list::add), false
+    /// if any prefix is out of range, in which case none are added.
+    virtual bool add(const access_list::range::list& ranges);
+
 protected:
     void work() override;
 
 private:
+    struct decision
+    {
+        std::string status_code;
+        std::string status_text;
+        std::string userid;
+    };
+
+    void serve();
+    void respond(message& request, message& response);
+    decision evaluate(const std::string& domain, const std::string& address,
+        const std::string& mechanism, const data_stack& credentials) const;
+
+    bool find_decision(const std::string& key, decision& out,
+        uint64_t& generation) const;
+    void store_decision(const std::string& key, const decision& value,
+        uint64_t generation);
+    void invalidate();
+
     bool allowed_address(const std::string& address) const;
     bool allowed_key(const hash_digest& public_key) const;
     bool allowed_weak(const std::string& domain) const;
 
+    const size_t workers_;
+
     // This is thread safe.
     context context_;
 
     // These are protected by mutex.
     bool require_address_;
     config::sodium private_key_;
-    std::unordered_set<hash_digest> keys_;
     std::unordered_set<std::string> weak_domains_;
-    std::unordered_map<std::string, bool> adresses_;
     mutable shared_mutex mutex_;
+
+    // These are thread safe and read without locking.
+    access_list addresses_;
+    key_store keys_;
+
+    // These are protected by cache_mutex_.
+    uint64_t generation_;
+    std::unordered_map<std::string, decision> decisions_;
+    mutable shared_mutex cache_mutex_;
 };
 
 } // namespace zmq
@@ -19,6 +19,7 @@
 #ifndef LIBBITCOIN_PROTOCOL_ZMQ_FRAME_HPP
 #define LIBBITCOIN_PROTOCOL_ZMQ_FRAME_HPP
 
+#include <cstddef>
 #include <memory>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/protocol/define.hpp>
@@ -43,6 +44,17 @@ public:
     /// Construct a frame with the specified payload (for sending).
     frame(const data_chunk& data);
 
+    /// Construct a frame that takes ownership of the payload (for sending).
+    /// Large payloads are handed to zeromq without copying.
+    frame(data_chunk&& data);
+
+    /// Called by zeromq once it no longer references the buffer.
+    typedef void(*release_function)(void* buffer, void* hint);
+
+    /// Construct a frame of the buffer without copying it (for sending).
+    /// The buffer is released by zeromq, or on destruction if not sent.
+    frame(void* buffer, size_t size, release_function release, void* hint);
+
     /// Free the frame's allocated memory.
     virtual ~frame();
 
@@ -55,13 +67,17 @@ public:
     /// The initialized or received payload of the frame.
     data_chunk payload();
 
+    /// The address of the payload buffer.
+    const void* address();
+
     /// Must be called on the socket thread.
     /// Receive a frame on the socket.
     code receive(socket& socket);
 
     /// Must be called on the socket thread.
-    /// Send a frame on the socket.
-    code send(socket& socket, bool more);
+    /// Send a frame on the socket, without blocking unless wait is set
+    /// (channel_timeout if the send would block).
+    code send(socket& socket, bool more, bool wait=true);
 
 private:
     // zmq_msg_t alias, keeps zmq.h out of our headers.
@@ -72,6 +88,9 @@ private:
     } zmq_msg;
 
     static bool initialize(zmq_msg& message, const data_chunk& data);
+    static bool initialize(zmq_msg& message, data_chunk&& data);
+    static bool initialize(zmq_msg& message, void* buffer, size_t size,
+        release_function release, void* hint);
 
     bool set_more(socket& socket);
     bool destroy();
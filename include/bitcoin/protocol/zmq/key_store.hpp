@@ -0,0 +1,105 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_PROTOCOL_ZMQ_KEY_STORE_HPP
+#define LIBBITCOIN_PROTOCOL_ZMQ_KEY_STORE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/define.hpp>
+
+namespace libbitcoin {
+namespace protocol {
+namespace zmq {
+
+/// A set of authorized CURVE public keys, bulk loaded from a memory mapped
+/// file of sorted 32 byte keys and updated by add and revoke deltas.
+/// Readers search an immutable snapshot and do not lock.
+/// This class is thread safe.
+class BCP_API key_store
+{
+public:
+    /// Construct an empty store.
+    key_store();
+
+    /// Replace all keys with those of a key file, false if invalid, in which
+    /// case the keys are unchanged. Either way the store is configured.
+    /// The file is mapped while loaded, replace it by rename, not in place.
+    bool load(const std::string& path);
+
+    /// Write the keys as a key file (sorted, duplicates removed).
+    static bool save(const std::string& path, hash_list keys);
+
+    /// Authorize the key.
+    void add(const hash_digest& key);
+
+    /// Remove authorization of the key.
+    void revoke(const hash_digest& key);
+
+    /// Remove all keys, the store is no longer configured.
+    void clear();
+
+    /// True if the key is authorized.
+    bool contains(const hash_digest& key) const;
+
+    /// The number of authorized keys.
+    size_t size() const;
+
+    /// True if there are no authorized keys.
+    bool empty() const;
+
+    /// True once keys have been added or loaded, even if all are since
+    /// revoked. A configured store authorizes only the keys it contains.
+    bool configured() const;
+
+private:
+    struct table
+    {
+        // Sorted keys, either mapped from file or owned, kept alive by owner.
+        const hash_digest* base;
+        size_t base_size;
+        std::shared_ptr<const void> owner;
+
+        // Sorted deltas against base, compacted into base when large.
+        hash_list added;
+        hash_list revoked;
+        size_t size;
+        bool configured;
+    };
+
+    typedef std::shared_ptr<const table> snapshot;
+
+    static bool contains(const table& keys, const hash_digest& key);
+    static void compact(table& keys);
+    void configure();
+    void publish(std::shared_ptr<table> keys);
+
+    // Writers copy the table and publish the copy atomically.
+    snapshot table_;
+    std::mutex write_mutex_;
+};
+
+} // namespace zmq
+} // namespace protocol
+} // namespace libbitcoin
+
+#endif
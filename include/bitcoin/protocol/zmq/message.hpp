@@ -19,6 +19,7 @@
 #ifndef LIBBITCOIN_PROTOCOL_ZMQ_MESSAGE_HPP
 #define LIBBITCOIN_PROTOCOL_ZMQ_MESSAGE_HPP
 
+#include <memory>
 #include <string>
 #include <google/protobuf/message_lite.h>
 #include <bitcoin/bitcoin.hpp>
@@ -45,6 +46,17 @@ public:
     /// Add a protobuf message part to the outgoing message.
     bool enqueue_protobuf_message(const google::protobuf::MessageLite& value);
 
+    /// Add a process-local protobuf message part, valid only over inproc.
+    /// The message must remain valid until the receiver has dequeued it.
+    void enqueue_protobuf_reference(
+        const google::protobuf::MessageLite& value);
+
+    /// Add a process-local protobuf message part, valid only over inproc.
+    /// Ownership passes to the receiver, which deletes the message. Once
+    /// sent, zeromq deletes the message if the part is never delivered.
+    void enqueue_protobuf_ownership(
+        std::unique_ptr<google::protobuf::MessageLite> value);
+
     /// Add a message part to the outgoing message.
     template <typename Unsigned>
     void enqueue_little_endian(Unsigned value)
@@ -64,6 +76,20 @@ public:
     bool dequeue(hash_digest& value);
     bool dequeue(google::protobuf::MessageLite& value);
 
+    /// Must only be used for messages received over inproc.
+    /// As dequeue, but also accepts a process-local protobuf message part.
+    /// An owned message is swapped into the value, a reference is copied.
+    bool dequeue_local(google::protobuf::MessageLite& value);
+
+    /// Must only be used for message parts received over inproc.
+    /// The message conveyed by a process-local part, or nullptr if the part is
+    /// serialized. The pointer owns the message if ownership was conveyed.
+    static std::shared_ptr<const google::protobuf::MessageLite>
+        to_protobuf_reference(const data_chunk& part);
+
+    /// The message part at the top of the queue, empty if empty queue.
+    const data_chunk& peek() const;
+
     /// Clear the queue of message parts.
     void clear();
 
@@ -77,6 +103,11 @@ public:
     /// Send the message in parts. If a send fails the unsent parts remain.
     code send(socket& socket);
 
+    /// Must be called on the socket thread.
+    /// Send the message in parts without blocking, channel_timeout if the
+    /// peer queue is full, in which case the message remains unsent.
+    code try_send(socket& socket);
+
     /// Must be called on the socket thread.
     /// Receve a message (clears the queue first).
     code receive(socket& socket);
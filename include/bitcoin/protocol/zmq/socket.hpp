@@ -94,6 +94,11 @@ public:
     /// Connect the socket to the specified remote address.
     code connect(const config::endpoint& address);
 
+    /// This must be called on the socket thread.
+    /// Connect the socket to the specified zeromq address string, including
+    /// inproc addresses that config::endpoint does not parse.
+    code connect_address(const std::string& address);
+
     /// This must be called on the socket thread.
     /// Retrieve the last endpoint set.
     bool get_last_endpoint(std::string& endpoint) const;
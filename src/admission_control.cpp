@@ -0,0 +1,177 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/protocol/admission_control.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <bitcoin/protocol/blockchain.pb.h>
+
+namespace libbitcoin {
+namespace protocol {
+
+constexpr int32_t admission_control::default_target_milliseconds;
+constexpr int32_t admission_control::default_interval_milliseconds;
+constexpr int32_t admission_control::maximum_wait_milliseconds;
+
+admission_control::admission_control(int32_t target_milliseconds,
+    int32_t interval_milliseconds)
+  : target_(std::chrono::milliseconds(target_milliseconds)),
+    interval_(std::chrono::milliseconds(interval_milliseconds))
+{
+}
+
+// static
+int admission_control::to_class(const google::protobuf::MessageLite& request)
+{
+    if (request.GetTypeName() !=
+        blockchain::request::default_instance().GetTypeName())
+        return 0;
+
+    return static_cast<const blockchain::request&>(request)
+        .request_type_case();
+}
+
+// static
+uint64_t admission_control::to_sent(std::chrono::system_clock::time_point time)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        time.time_since_epoch()).count();
+}
+
+// static
+admission_control::clock::time_point admission_control::sent_time(
+    const google::protobuf::MessageLite& request, clock::time_point now,
+    std::chrono::system_clock::time_point wall_now)
+{
+    if (request.GetTypeName() !=
+        blockchain::request::default_instance().GetTypeName())
+        return now;
+
+    const auto sent = static_cast<const blockchain::request&>(request).sent();
+    const auto received = to_sent(wall_now);
+    if (sent == 0 || sent >= received)
+        return now;
+
+    const auto waited = std::min(received - sent,
+        static_cast<uint64_t>(maximum_wait_milliseconds));
+
+    return now - std::chrono::milliseconds(waited);
+}
+
+// static
+const data_chunk& admission_control::status_frame()
+{
+    static const data_chunk frame{ 0x00, 's' };
+    return frame;
+}
+
+// static
+bool admission_control::is_status_reply(const zmq::message& reply)
+{
+    return reply.size() == 2 && reply.peek() == status_frame();
+}
+
+bool admission_control::admit(int request_class, clock::time_point now)
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto& entry = classes_[request_class];
+
+    if (entry.shedding && now >= entry.shed_next)
+    {
+        ++entry.shed;
+        entry.shed_next = next_shed(entry.shed_next, entry.count++);
+        return false;
+    }
+
+    ++entry.admitted;
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void admission_control::record(int request_class, clock::duration sojourn,
+    clock::time_point now)
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto& entry = classes_[request_class];
+    entry.sojourn = sojourn;
+
+    if (sojourn < target_)
+    {
+        entry.first_above = clock::time_point();
+        entry.shedding = false;
+        return;
+    }
+
+    if (entry.first_above == clock::time_point())
+    {
+        entry.first_above = now + interval_;
+        return;
+    }
+
+    if (entry.shedding || now < entry.first_above)
+        return;
+
+    // Shedding resumes near the previous rate if it stopped recently.
+    const auto recent = entry.count > 2 &&
+        now - entry.shed_next < 16 * interval_;
+
+    entry.shedding = true;
+    entry.count = recent ? entry.count - 2 : 1;
+    entry.shed_next = now;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+admission_control::statistics admission_control::stats(
+    int request_class) const
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const auto entry = classes_.find(request_class);
+    if (entry == classes_.end())
+        return { 0, 0, clock::duration::zero(), false };
+
+    const auto& value = entry->second;
+    return { value.admitted, value.shed, value.sojourn, value.shedding };
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// Call while holding the mutex.
+admission_control::clock::time_point admission_control::next_shed(
+    clock::time_point now, size_t count) const
+{
+    const auto spacing = std::chrono::duration_cast<clock::duration>(
+        interval_ / std::sqrt(static_cast<double>(count)));
+
+    return now + spacing;
+}
+
+} // namespace protocol
+} // namespace libbitcoin
@@ -0,0 +1,213 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/protocol/bloom_filter.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/interface.pb.h>
+
+namespace libbitcoin {
+namespace protocol {
+
+static constexpr uint32_t seed_multiplier = 0xfba4c795;
+
+static uint32_t rotate_left(uint32_t value, uint32_t bits)
+{
+    return (value << bits) | (value >> (32 - bits));
+}
+
+static data_slice to_slice(const std::string& value)
+{
+    const auto data = reinterpret_cast<const uint8_t*>(value.data());
+    return { data, data + value.size() };
+}
+
+uint32_t bloom_filter::murmur3(uint32_t seed, data_slice data)
+{
+    static constexpr uint32_t c1 = 0xcc9e2d51;
+    static constexpr uint32_t c2 = 0x1b873593;
+
+    const auto bytes = data.data();
+    const auto size = data.size();
+    const auto blocks = size / 4;
+    auto hash = seed;
+
+    for (size_t block = 0; block < blocks; ++block)
+    {
+        const auto chunk = bytes + block * 4;
+        auto k1 = uint32_t(chunk[0]) | (uint32_t(chunk[1]) << 8) |
+            (uint32_t(chunk[2]) << 16) | (uint32_t(chunk[3]) << 24);
+
+        k1 *= c1;
+        k1 = rotate_left(k1, 15);
+        k1 *= c2;
+
+        hash ^= k1;
+        hash = rotate_left(hash, 13);
+        hash = hash * 5 + 0xe6546b64;
+    }
+
+    const auto tail = bytes + blocks * 4;
+    uint32_t k1 = 0;
+
+    switch (size & 3)
+    {
+        case 3:
+            k1 ^= uint32_t(tail[2]) << 16;
+            // fall through
+        case 2:
+            k1 ^= uint32_t(tail[1]) << 8;
+            // fall through
+        case 1:
+            k1 ^= tail[0];
+            k1 *= c1;
+            k1 = rotate_left(k1, 15);
+            k1 *= c2;
+            hash ^= k1;
+    }
+
+    hash ^= static_cast<uint32_t>(size);
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+bloom_filter::bloom_filter()
+  : hash_functions_(0),
+    tweak_(0)
+{
+}
+
+bool bloom_filter::set(const std::string& data, uint32_t hash_functions,
+    uint32_t tweak)
+{
+    if (data.size() > max_size || hash_functions > max_hash_functions)
+        return false;
+
+    data_.assign(data.begin(), data.end());
+    hash_functions_ = hash_functions;
+    tweak_ = tweak;
+    return true;
+}
+
+bool bloom_filter::empty() const
+{
+    return data_.empty();
+}
+
+bool bloom_filter::contains(data_slice element) const
+{
+    if (data_.empty())
+        return false;
+
+    const auto bits = data_.size() * 8;
+
+    for (uint32_t function = 0; function < hash_functions_; ++function)
+    {
+        const auto seed = function * seed_multiplier + tweak_;
+        const auto bit = murmur3(seed, element) % bits;
+
+        if ((data_[bit / 8] & (1 << (bit % 8))) == 0)
+            return false;
+    }
+
+    return true;
+}
+
+bool bloom_filter::contains(const tx& transaction,
+    const hash_digest& hash) const
+{
+    if (data_.empty())
+        return false;
+
+    if (contains(hash))
+        return true;
+
+    for (const auto& output: transaction.outputs())
+        if (contains_pushes(output.script()))
+            return true;
+
+    for (const auto& input: transaction.inputs())
+    {
+        // The outpoint is matched as serialized, the hash then the index.
+        const auto& point = input.previous_output();
+        const auto index = point.index();
+        data_chunk outpoint(point.hash().begin(), point.hash().end());
+        outpoint.push_back(static_cast<uint8_t>(index));
+        outpoint.push_back(static_cast<uint8_t>(index >> 8));
+        outpoint.push_back(static_cast<uint8_t>(index >> 16));
+        outpoint.push_back(static_cast<uint8_t>(index >> 24));
+
+        if (contains(outpoint) || contains_pushes(input.script()))
+            return true;
+    }
+
+    return false;
+}
+
+// Parsing stops at a truncated push, as script evaluation would.
+bool bloom_filter::contains_pushes(const std::string& script) const
+{
+    const auto bytes = to_slice(script);
+    const auto end = bytes.data() + bytes.size();
+    auto it = bytes.data();
+
+    while (it != end)
+    {
+        const auto opcode = *it++;
+        size_t size = 0;
+
+        if (opcode > 78)
+            continue;
+
+        if (opcode < 76)
+        {
+            size = opcode;
+        }
+        else
+        {
+            const size_t width = opcode == 76 ? 1 : opcode == 77 ? 2 : 4;
+            if (static_cast<size_t>(end - it) < width)
+                return false;
+
+            for (size_t byte = 0; byte < width; ++byte)
+                size |= size_t(it[byte]) << (8 * byte);
+
+            it += width;
+        }
+
+        if (static_cast<size_t>(end - it) < size)
+            return false;
+
+        if (size != 0 && contains({ it, it + size }))
+            return true;
+
+        it += size;
+    }
+
+    return false;
+}
+
+} // namespace protocol
+} // namespace libbitcoin
@@ -0,0 +1,196 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/protocol/capture.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <google/protobuf/message_lite.h>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace protocol {
+
+using namespace std::chrono;
+
+// Log layout, all integers little endian:
+// file:   magic[6]
+// record: timestamp[8] direction[1] part_count[4] (part_size[4] part)*
+static const std::string magic("bpcap\x01", 6);
+
+static void put(std::ostream& stream, uint64_t value, size_t bytes)
+{
+    for (size_t byte = 0; byte < bytes; ++byte)
+        stream.put(static_cast<char>((value >> (8 * byte)) & 0xff));
+}
+
+static bool get(std::istream& stream, uint64_t& value, size_t bytes)
+{
+    value = 0;
+    for (size_t byte = 0; byte < bytes; ++byte)
+    {
+        const auto character = stream.get();
+        if (character == std::char_traits<char>::eof())
+            return false;
+
+        value |= static_cast<uint64_t>(character & 0xff) << (8 * byte);
+    }
+
+    return true;
+}
+
+static data_chunk serialize(const google::protobuf::MessageLite& message)
+{
+    data_chunk chunk(message.ByteSize());
+    message.SerializeToArray(chunk.data(), chunk.size());
+    return chunk;
+}
+
+capture::capture(const std::string& path)
+  : start_(clock::now()),
+    file_(path, std::ios::binary | std::ios::trunc)
+{
+    file_.write(magic.data(), magic.size());
+}
+
+capture::operator const bool() const
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return file_.good();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void capture::write(direction way, const std::vector<data_chunk>& parts)
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Timed under the lock, so that records are in time order.
+    const auto elapsed = duration_cast<microseconds>(clock::now() - start_);
+
+    put(file_, static_cast<uint64_t>(elapsed.count()), 8);
+    put(file_, static_cast<uint8_t>(way), 1);
+    put(file_, parts.size(), 4);
+
+    for (const auto& part: parts)
+    {
+        put(file_, part.size(), 4);
+        file_.write(reinterpret_cast<const char*>(part.data()), part.size());
+    }
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void capture::write(direction way,
+    const google::protobuf::MessageLite& message)
+{
+    write(way, std::vector<data_chunk>{ serialize(message) });
+}
+
+void capture::write(direction way, const std::string& handler_id,
+    const google::protobuf::MessageLite& message)
+{
+    write(way, std::vector<data_chunk>
+    {
+        data_chunk(handler_id.begin(), handler_id.end()),
+        serialize(message)
+    });
+}
+
+// static
+bool capture::load(const std::string& path, record::list& out)
+{
+    bool truncated;
+    return load(path, out, truncated);
+}
+
+// static
+bool capture::load(const std::string& path, record::list& out,
+    bool& out_truncated)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::string header(magic.size(), '\0');
+
+    if (!file.read(&header[0], header.size()) || header != magic)
+        return false;
+
+    out.clear();
+    out_truncated = false;
+    uint64_t timestamp;
+
+    while (get(file, timestamp, 8))
+    {
+        record entry;
+        if (!read_record(file, timestamp, entry))
+        {
+            out_truncated = true;
+            return true;
+        }
+
+        out.push_back(std::move(entry));
+    }
+
+    return true;
+}
+
+// static
+bool capture::read_record(std::istream& stream, uint64_t timestamp,
+    record& out)
+{
+    uint64_t way;
+    uint64_t count;
+    if (!get(stream, way, 1) || !get(stream, count, 4))
+        return false;
+
+    out = record{ timestamp, static_cast<direction>(way), {} };
+
+    for (uint64_t part = 0; part < count; ++part)
+    {
+        uint64_t size;
+        if (!get(stream, size, 4))
+            return false;
+
+        // A corrupt size must not allocate more than the stream holds.
+        data_chunk chunk;
+        while (chunk.size() < size)
+        {
+            const auto before = chunk.size();
+            const auto step = std::min<uint64_t>(size - before, 1024 * 1024);
+            chunk.resize(before + step);
+
+            if (!stream.read(reinterpret_cast<char*>(chunk.data() + before),
+                step))
+                return false;
+        }
+
+        out.parts.push_back(std::move(chunk));
+    }
+
+    return true;
+}
+
+} // namespace protocol
+} // namespace libbitcoin
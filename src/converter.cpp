@@ -18,8 +18,14 @@
  */
 #include <bitcoin/protocol/converter.hpp>
 
+#include <algorithm>
+#include <cstdint>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/blockchain.pb.h>
+#include <bitcoin/protocol/merkle_tree.hpp>
 
 namespace libbitcoin {
 namespace protocol {
@@ -42,6 +48,89 @@ static std::string pack_hash(hash_digest in)
     return std::string(in.begin(), in.end());
 }
 
+// BIP152 short transaction ids are the low 6 bytes of a SipHash-2-4.
+static constexpr size_t short_id_size = 6;
+static constexpr uint64_t short_id_mask = 0xffffffffffffull;
+
+static uint64_t rotate_left(uint64_t value, size_t bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static void sip_round(uint64_t& v0, uint64_t& v1, uint64_t& v2, uint64_t& v3)
+{
+    v0 += v1; v1 = rotate_left(v1, 13); v1 ^= v0; v0 = rotate_left(v0, 32);
+    v2 += v3; v3 = rotate_left(v3, 16); v3 ^= v2;
+    v0 += v3; v3 = rotate_left(v3, 21); v3 ^= v0;
+    v2 += v1; v1 = rotate_left(v1, 17); v1 ^= v2; v2 = rotate_left(v2, 32);
+}
+
+// SipHash-2-4 of a transaction hash.
+static uint64_t sip_hash(uint64_t k0, uint64_t k1, const hash_digest& hash)
+{
+    uint64_t v0 = 0x736f6d6570736575ull ^ k0;
+    uint64_t v1 = 0x646f72616e646f6dull ^ k1;
+    uint64_t v2 = 0x6c7967656e657261ull ^ k0;
+    uint64_t v3 = 0x7465646279746573ull ^ k1;
+
+    for (auto word = hash.begin(); word != hash.end(); word += 8)
+    {
+        const auto value = from_little_endian_unsafe<uint64_t>(word);
+        v3 ^= value;
+        sip_round(v0, v1, v2, v3);
+        sip_round(v0, v1, v2, v3);
+        v0 ^= value;
+    }
+
+    // The final block holds only the message length.
+    const auto last = static_cast<uint64_t>(hash_size) << 56;
+    v3 ^= last;
+    sip_round(v0, v1, v2, v3);
+    sip_round(v0, v1, v2, v3);
+    v0 ^= last;
+
+    v2 ^= 0xff;
+    for (size_t round = 0; round < 4; ++round)
+        sip_round(v0, v1, v2, v3);
+
+    return (v0 ^ v1 ^ v2 ^ v3) & short_id_mask;
+}
+
+// The SipHash keys are taken from sha256(header || nonce).
+static void short_id_keys(const chain::header& header, uint64_t nonce,
+    uint64_t& k0, uint64_t& k1)
+{
+    auto data = header.to_data();
+    const auto bytes = to_little_endian<uint64_t>(nonce);
+    data.insert(data.end(), bytes.begin(), bytes.end());
+
+    const auto digest = sha256_hash(data);
+    k0 = from_little_endian_unsafe<uint64_t>(digest.begin());
+    k1 = from_little_endian_unsafe<uint64_t>(digest.begin() + 8);
+}
+
+static std::string pack_short_id(uint64_t id)
+{
+    std::string out(short_id_size, 0);
+    for (size_t byte = 0; byte < short_id_size; ++byte)
+        out[byte] = static_cast<char>(id >> (8 * byte));
+
+    return out;
+}
+
+static bool unpack_short_id(uint64_t& out, const std::string& in)
+{
+    if (in.size() != short_id_size)
+        return false;
+
+    out = 0;
+    for (size_t byte = 0; byte < short_id_size; ++byte)
+        out |= static_cast<uint64_t>(static_cast<uint8_t>(in[byte])) <<
+            (8 * byte);
+
+    return true;
+}
+
 bool converter::from_protocol(const std::string* hash,
     hash_digest& result)
 {
@@ -473,8 +562,238 @@ protocol::block* converter::to_protocol(const chain::block& block)
     return result.release();
 }
 
+bool converter::to_protocol(const chain::block& block, uint64_t nonce,
+    const std::vector<size_t>& prefilled, compact_block& result)
+{
+    result.Clear();
+
+    if (!to_protocol(block.header(), *result.mutable_header()))
+        return false;
+
+    result.set_nonce(static_cast<int64_t>(nonce));
 
+    uint64_t k0;
+    uint64_t k1;
+    short_id_keys(block.header(), nonce, k0, k1);
+
+    auto sorted = prefilled;
+    std::sort(sorted.begin(), sorted.end());
+
+    const auto& transactions = block.transactions();
+    auto next = sorted.begin();
+    size_t expected = 0;
+
+    for (size_t index = 0; index < transactions.size(); ++index)
+    {
+        const auto prefill = index == 0 ||
+            (next != sorted.end() && *next == index);
+
+        while (next != sorted.end() && *next <= index)
+            ++next;
+
+        const auto& transaction = transactions[index];
+
+        if (!prefill)
+        {
+            result.add_short_ids(pack_short_id(sip_hash(k0, k1,
+                transaction.hash())));
+            continue;
+        }
+
+        auto& entry = *result.add_transactions();
+        entry.set_index(static_cast<int64_t>(index - expected));
+        expected = index + 1;
+
+        if (!to_protocol(transaction, *entry.mutable_tx()))
+        {
+            result.Clear();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool converter::from_protocol(const compact_block* compact,
+    const chain::transaction::list& mempool, chain::block& result,
+    std::vector<size_t>& missing)
+{
+    enum slot : uint8_t { empty, prefilled, resolved, ambiguous };
+
+    if (compact == nullptr || !compact->has_header())
+        return false;
+
+    chain::header header;
+    if (!from_protocol(&compact->header(), header))
+        return false;
+
+    const auto count = static_cast<size_t>(compact->short_ids_size()) +
+        compact->transactions_size();
+
+    if (count == 0)
+        return false;
+
+    chain::transaction::list transactions(count);
+    std::vector<slot> slots(count, empty);
+    size_t expected = 0;
+
+    for (const auto& entry: compact->transactions())
+    {
+        if (entry.index() < 0 ||
+            static_cast<uint64_t>(entry.index()) >= count - expected)
+            return false;
+
+        const auto index = expected + static_cast<size_t>(entry.index());
+
+        if (!from_protocol(&entry.tx(), transactions[index]))
+            return false;
 
+        slots[index] = prefilled;
+        expected = index + 1;
+    }
+
+    // Short ids fill the positions not prefilled, in order.
+    std::unordered_map<uint64_t, size_t> positions;
+    positions.reserve(compact->short_ids_size());
+    size_t position = 0;
+
+    for (const auto& packed: compact->short_ids())
+    {
+        while (slots[position] == prefilled)
+            ++position;
+
+        uint64_t id;
+        if (!unpack_short_id(id, packed))
+            return false;
+
+        if (!positions.emplace(id, position++).second)
+            return false;
+    }
+
+    const auto nonce = static_cast<uint64_t>(compact->nonce());
+    uint64_t k0;
+    uint64_t k1;
+    short_id_keys(header, nonce, k0, k1);
+
+    for (const auto& transaction: mempool)
+    {
+        const auto it = positions.find(sip_hash(k0, k1, transaction.hash()));
+        if (it == positions.end())
+            continue;
+
+        auto& state = slots[it->second];
+
+        if (state == empty)
+        {
+            transactions[it->second] = transaction;
+            state = resolved;
+        }
+        else if (state == resolved &&
+            !(transactions[it->second] == transaction))
+        {
+            state = ambiguous;
+        }
+    }
+
+    missing.clear();
+    for (size_t index = 0; index < count; ++index)
+    {
+        if (slots[index] == empty || slots[index] == ambiguous)
+        {
+            transactions[index] = chain::transaction{};
+            missing.push_back(index);
+        }
+    }
+
+    result.header() = header;
+    result.transactions() = std::move(transactions);
+
+    return !missing.empty() ||
+        result.generate_merkle_root() == result.header().merkle();
+}
+
+bool converter::to_hashes(const protocol::block& block, hash_list& out)
+{
+    out.clear();
+    out.reserve(block.transactions_size());
+
+    for (const auto& transaction: block.transactions())
+    {
+        chain::transaction bitcoin_tx;
+
+        if (!from_protocol(&transaction, bitcoin_tx))
+            return false;
+
+        out.push_back(bitcoin_tx.hash());
+    }
+
+    return true;
+}
+
+bool converter::to_protocol(const protocol::block& block,
+    transaction_hash_result_list& results)
+{
+    chain::header header;
+    hash_list hashes;
+
+    if (!from_protocol(&block.header(), header) || !to_hashes(block, hashes))
+        return false;
+
+    std::unordered_map<hash_digest, size_t> indexes;
+    indexes.reserve(hashes.size());
+
+    for (size_t index = 0; index < hashes.size(); ++index)
+        indexes.emplace(hashes[index], index);
+
+    const merkle_tree tree(hashes);
+    const auto block_hash = pack_hash(header.hash());
+    hash_list branch;
+
+    for (auto& result: results)
+    {
+        hash_digest hash;
+        if (!unpack_hash(hash, result.hash()))
+            return false;
+
+        const auto it = indexes.find(hash);
+        if (it == indexes.end() || !tree.branch(it->second, branch))
+            return false;
+
+        auto& location = *result.mutable_location();
+        location.mutable_identity()->set_hash(block_hash);
+        location.set_index(it->second);
+        location.clear_branch();
+
+        for (const auto& sibling: branch)
+            location.add_branch(pack_hash(sibling));
+    }
+
+    return true;
+}
+
+bool converter::to_protocol(const protocol::block& block,
+    const std::vector<bool>& matches, merkle_block& result)
+{
+    result.Clear();
+    hash_list hashes;
+
+    if (!block.has_header() || !to_hashes(block, hashes))
+        return false;
+
+    const merkle_tree tree(hashes);
+    hash_list partial;
+    data_chunk flags;
+    tree.partial(matches, partial, flags);
+
+    *result.mutable_header() = block.header();
+    result.set_total_transactions(static_cast<uint32_t>(hashes.size()));
+    result.set_flags(std::string(flags.begin(), flags.end()));
+
+    for (const auto& hash: partial)
+        result.add_hashes(pack_hash(hash));
+
+    return true;
+}
 
 }
 }
@@ -0,0 +1,253 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/protocol/filter_engine.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/interface.pb.h>
+
+namespace libbitcoin {
+namespace protocol {
+
+static constexpr uint32_t key_bits = 64;
+static constexpr size_t key_size = key_bits / 8;
+
+// True if the leading bits of the candidate equal those of the prefix.
+static bool is_prefix(data_slice prefix, uint32_t bits, data_slice candidate)
+{
+    if (candidate.size() * 8 < bits)
+        return false;
+
+    const auto bytes = bits / 8;
+    if (!std::equal(prefix.begin(), prefix.begin() + bytes, candidate.begin()))
+        return false;
+
+    const auto excess = bits % 8;
+    if (excess == 0)
+        return true;
+
+    const auto mask = static_cast<uint8_t>(0xff << (8 - excess));
+    return ((prefix.data()[bytes] ^ candidate.data()[bytes]) & mask) == 0;
+}
+
+bool filter_engine::add(const filter& value)
+{
+    const auto table = find(value.filter_type());
+    const auto& prefix = value.prefix();
+    const auto data = reinterpret_cast<const uint8_t*>(prefix.data());
+
+    return table != nullptr &&
+        add(*table, value.bits(), { data, data + prefix.size() });
+}
+
+bool filter_engine::add(filters type, const protocol::binary& prefix)
+{
+    const auto table = find(type);
+    const auto& blocks = prefix.blocks();
+    const auto excess = prefix.final_block_excess();
+
+    if (table == nullptr || excess >= 8 || (blocks.empty() && excess != 0))
+        return false;
+
+    const auto bits = static_cast<uint32_t>(blocks.size() * 8 - excess);
+    const auto data = reinterpret_cast<const uint8_t*>(blocks.data());
+    return add(*table, bits, { data, data + blocks.size() });
+}
+
+bool filter_engine::add(const transactions_request& request)
+{
+    for (const auto& value: request.query())
+        if (!add(value))
+            return false;
+
+    return true;
+}
+
+void filter_engine::compile()
+{
+    for (auto& table: tables_)
+        compile(table);
+}
+
+bool filter_engine::empty(filters type) const
+{
+    const auto table = find(type);
+    return table == nullptr || (table->ranges.empty() && table->longs.empty());
+}
+
+bool filter_engine::match(filters type, data_slice candidate) const
+{
+    const auto table = find(type);
+    return table != nullptr && match(*table, to_key(candidate), candidate);
+}
+
+void filter_engine::match(filters type, const hash_list& candidates,
+    std::vector<bool>& out) const
+{
+    out.assign(candidates.size(), false);
+    const auto table = find(type);
+
+    if (table == nullptr)
+        return;
+
+    for (size_t index = 0; index < candidates.size(); ++index)
+        out[index] = match(*table, to_key(candidates[index]),
+            candidates[index]);
+}
+
+void filter_engine::match(filters type,
+    const std::vector<short_hash>& candidates, std::vector<bool>& out) const
+{
+    out.assign(candidates.size(), false);
+    const auto table = find(type);
+
+    if (table == nullptr)
+        return;
+
+    for (size_t index = 0; index < candidates.size(); ++index)
+        out[index] = match(*table, to_key(candidates[index]),
+            candidates[index]);
+}
+
+// The leading 64 bits, big endian, zero padded.
+uint64_t filter_engine::to_key(data_slice value)
+{
+    uint64_t key = 0;
+    const auto size = std::min(value.size(), key_size);
+
+    for (size_t index = 0; index < size; ++index)
+        key |= uint64_t(value.data()[index]) << (8 * (key_size - 1 - index));
+
+    return key;
+}
+
+bool filter_engine::add(table& table, uint32_t bits, data_slice prefix)
+{
+    if (prefix.size() * 8 < bits)
+        return false;
+
+    const auto head = to_key(prefix);
+
+    if (bits > key_bits)
+    {
+        const auto end = prefix.begin() + (bits + 7) / 8;
+        table.longs.push_back({ head, bits, { prefix.begin(), end } });
+        return true;
+    }
+
+    // The free bits of the range are those following the prefix.
+    const auto mask = bits == 0 ? ~uint64_t(0) :
+        (uint64_t(1) << (key_bits - bits)) - 1;
+    const auto first = bits == 0 ? 0 : head & ~mask;
+    table.ranges.push_back({ first, first | mask, bits });
+    return true;
+}
+
+// Prefix ranges either nest or are disjoint, so ordering by first and then
+// by width leaves each nested range following its container, and dropped.
+void filter_engine::compile(table& table)
+{
+    auto& ranges = table.ranges;
+    std::sort(ranges.begin(), ranges.end(),
+        [](const range& left, const range& right)
+        {
+            return left.first == right.first ? left.bits < right.bits :
+                left.first < right.first;
+        });
+
+    std::vector<range> disjoint;
+    disjoint.reserve(ranges.size());
+
+    for (const auto& entry: ranges)
+        if (disjoint.empty() || entry.first > disjoint.back().last)
+            disjoint.push_back(entry);
+
+    ranges.swap(disjoint);
+    table.firsts.clear();
+    table.firsts.reserve(ranges.size());
+
+    for (const auto& entry: ranges)
+        table.firsts.push_back(entry.first);
+
+    // Long prefixes within a range are redundant.
+    auto& longs = table.longs;
+    longs.erase(std::remove_if(longs.begin(), longs.end(),
+        [&table](const long_prefix& entry)
+        {
+            return in_ranges(table, entry.head, entry.bits);
+        }), longs.end());
+
+    std::sort(longs.begin(), longs.end(),
+        [](const long_prefix& left, const long_prefix& right)
+        {
+            return left.head < right.head;
+        });
+}
+
+// True if the key falls in a range no longer than the candidate bits.
+bool filter_engine::in_ranges(const table& table, uint64_t key,
+    size_t candidate_bits)
+{
+    const auto& firsts = table.firsts;
+    const auto it = std::upper_bound(firsts.begin(), firsts.end(), key);
+
+    if (it == firsts.begin())
+        return false;
+
+    const auto& entry = table.ranges[std::distance(firsts.begin(), it) - 1];
+    return key <= entry.last && candidate_bits >= entry.bits;
+}
+
+bool filter_engine::match(const table& table, uint64_t key,
+    data_slice candidate)
+{
+    if (in_ranges(table, key, candidate.size() * 8))
+        return true;
+
+    const auto& longs = table.longs;
+    auto entry = std::lower_bound(longs.begin(), longs.end(), key,
+        [](const long_prefix& left, uint64_t right)
+        {
+            return left.head < right;
+        });
+
+    for (; entry != longs.end() && entry->head == key; ++entry)
+        if (is_prefix(entry->prefix, entry->bits, candidate))
+            return true;
+
+    return false;
+}
+
+filter_engine::table* filter_engine::find(filters type)
+{
+    return filters_IsValid(type) && type != _FILTERS_NONE ?
+        &tables_[type] : nullptr;
+}
+
+const filter_engine::table* filter_engine::find(filters type) const
+{
+    return filters_IsValid(type) && type != _FILTERS_NONE ?
+        &tables_[type] : nullptr;
+}
+
+} // namespace protocol
+} // namespace libbitcoin
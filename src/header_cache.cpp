@@ -0,0 +1,302 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/protocol/header_cache.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/interface.pb.h>
+
+namespace libbitcoin {
+namespace protocol {
+
+// Heights per page, a page of headers and hashes is about 228KB.
+static constexpr size_t page_heights = 2048;
+
+template <typename Integer>
+static void put_little_endian(uint8_t*& out, Integer value)
+{
+    for (size_t byte = 0; byte < sizeof(Integer); ++byte)
+        *out++ = static_cast<uint8_t>(value >> (8 * byte));
+}
+
+template <typename Integer>
+static Integer get_little_endian(const uint8_t*& in)
+{
+    Integer value = 0;
+    for (size_t byte = 0; byte < sizeof(Integer); ++byte)
+        value |= static_cast<Integer>(*in++) << (8 * byte);
+
+    return value;
+}
+
+header_cache::page::page()
+  : headers(page_heights),
+    hashes(page_heights),
+    states(page_heights, state::empty)
+{
+}
+
+header_cache::header_cache(size_t min_depth)
+  : min_depth_(min_depth),
+    top_(0),
+    size_(0)
+{
+}
+
+void header_cache::set_top(size_t height)
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    unique_lock lock(mutex_);
+
+    top_ = height;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// Call while holding the mutex.
+// Shallow blocks may yet be reorganized out without notice reaching us.
+bool header_cache::deep(size_t height) const
+{
+    return height <= top_ && top_ - height >= min_depth_;
+}
+
+bool header_cache::store(size_t height, const block_header& header)
+{
+    const auto& previous = header.previous_block_hash();
+    const auto& merkle = header.merkle_root();
+
+    if (previous.size() != hash_size || merkle.size() != hash_size)
+        return false;
+
+    wire_header wire;
+    auto out = wire.data();
+    put_little_endian<uint32_t>(out, header.version());
+    out = std::copy(previous.begin(), previous.end(), out);
+    out = std::copy(merkle.begin(), merkle.end(), out);
+    put_little_endian<uint32_t>(out, header.timestamp());
+    put_little_endian<uint32_t>(out, header.bits());
+    put_little_endian<uint32_t>(out, header.nonce());
+
+    const auto hash = bitcoin_hash(wire);
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    unique_lock lock(mutex_);
+
+    if (!deep(height))
+        return false;
+
+    set_hash(height, hash);
+    auto& entry = get(height);
+    const auto offset = height % page_heights;
+    entry.headers[offset] = wire;
+    entry.states[offset] = state::header;
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool header_cache::store(size_t height, const hash_digest& hash)
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    unique_lock lock(mutex_);
+
+    if (!deep(height))
+        return false;
+
+    set_hash(height, hash);
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// Call while holding the mutex exclusively.
+void header_cache::set_hash(size_t height, const hash_digest& hash)
+{
+    auto& entry = get(height);
+    const auto offset = height % page_heights;
+
+    if (entry.states[offset] != state::empty)
+    {
+        if (entry.hashes[offset] == hash)
+            return;
+
+        // A different block at the height, the old one was reorganized out.
+        erase(height);
+    }
+
+    entry.hashes[offset] = hash;
+    entry.states[offset] = state::hash;
+    heights_[hash] = height;
+    ++size_;
+}
+
+bool header_cache::header(size_t height, block_header& out) const
+{
+    wire_header wire;
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    {
+        shared_lock lock(mutex_);
+
+        const auto entry = find(height);
+        const auto offset = height % page_heights;
+
+        if (entry == nullptr || entry->states[offset] != state::header)
+            return false;
+
+        wire = entry->headers[offset];
+    }
+    ///////////////////////////////////////////////////////////////////////////
+
+    auto in = static_cast<const uint8_t*>(wire.data());
+    out.set_version(get_little_endian<uint32_t>(in));
+    out.set_previous_block_hash(std::string(in, in + hash_size));
+    in += hash_size;
+    out.set_merkle_root(std::string(in, in + hash_size));
+    in += hash_size;
+    out.set_timestamp(get_little_endian<uint32_t>(in));
+    out.set_bits(get_little_endian<uint32_t>(in));
+    out.set_nonce(get_little_endian<uint32_t>(in));
+    return true;
+}
+
+bool header_cache::hash(size_t height, hash_digest& out) const
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    shared_lock lock(mutex_);
+
+    const auto entry = find(height);
+    const auto offset = height % page_heights;
+
+    if (entry == nullptr || entry->states[offset] == state::empty)
+        return false;
+
+    out = entry->hashes[offset];
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool header_cache::height(const hash_digest& hash, size_t& out) const
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    shared_lock lock(mutex_);
+
+    const auto it = heights_.find(hash);
+    if (it == heights_.end())
+        return false;
+
+    out = it->second;
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void header_cache::reorganize(size_t fork_point)
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    unique_lock lock(mutex_);
+
+    // Blocks of the new branch are shallow until the top is set again.
+    top_ = std::min(top_, fork_point);
+
+    const auto first_page = fork_point / page_heights;
+    if (first_page >= pages_.size())
+        return;
+
+    // Erase the remainder of the fork point's page, then drop later pages.
+    const auto page_end = (first_page + 1) * page_heights;
+    for (auto height = fork_point + 1; height < page_end; ++height)
+        erase(height);
+
+    for (auto index = first_page + 1; index < pages_.size(); ++index)
+    {
+        if (!pages_[index])
+            continue;
+
+        for (size_t offset = 0; offset < page_heights; ++offset)
+            erase(index * page_heights + offset);
+    }
+
+    pages_.resize(first_page + 1);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void header_cache::clear()
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    unique_lock lock(mutex_);
+
+    pages_.clear();
+    heights_.clear();
+    size_ = 0;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+size_t header_cache::size() const
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    shared_lock lock(mutex_);
+
+    return size_;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// Call while holding the mutex exclusively.
+void header_cache::erase(size_t height)
+{
+    const auto entry = find(height);
+    const auto offset = height % page_heights;
+
+    if (entry == nullptr || entry->states[offset] == state::empty)
+        return;
+
+    heights_.erase(entry->hashes[offset]);
+    entry->states[offset] = state::empty;
+    --size_;
+}
+
+// Call while holding the mutex.
+header_cache::page* header_cache::find(size_t height) const
+{
+    const auto index = height / page_heights;
+    return index < pages_.size() ? pages_[index].get() : nullptr;
+}
+
+// Call while holding the mutex exclusively.
+header_cache::page& header_cache::get(size_t height)
+{
+    const auto index = height / page_heights;
+
+    if (index >= pages_.size())
+        pages_.resize(index + 1);
+
+    if (!pages_[index])
+        pages_[index].reset(new page);
+
+    return *pages_[index];
+}
+
+} // namespace protocol
+} // namespace libbitcoin
@@ -0,0 +1,154 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/protocol/history_batch.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/blockchain.pb.h>
+
+namespace libbitcoin {
+namespace protocol {
+
+history_batch::history_batch(
+    const blockchain::fetch_history_batch_request& request)
+  : from_height_(request.from_height()),
+    chunk_rows_(request.chunk_rows() == 0 ?
+        history_stream::default_chunk_rows : request.chunk_rows()),
+    valid_(request.address_hashes().size() % short_hash_size == 0),
+    address_(0),
+    row_(0),
+    sequence_(0)
+{
+    if (!valid_)
+        return;
+
+    const auto& packed = request.address_hashes();
+    const auto count = packed.size() / short_hash_size;
+    std::unordered_set<std::string> seen;
+
+    for (size_t index = 0; index < count; ++index)
+    {
+        const auto begin = packed.begin() + index * short_hash_size;
+        if (!seen.emplace(begin, begin + short_hash_size).second)
+            continue;
+
+        address entry;
+        std::copy(begin, begin + short_hash_size, entry.hash.begin());
+        entry.index = static_cast<uint32_t>(index);
+        addresses_.push_back(std::move(entry));
+    }
+
+    // Separate fetches in hash order at best touch the history table in
+    // key order, there is no single pass over it.
+    scan_order_.resize(addresses_.size());
+    for (size_t index = 0; index < scan_order_.size(); ++index)
+        scan_order_[index] = index;
+
+    std::sort(scan_order_.begin(), scan_order_.end(),
+        [this](size_t left, size_t right)
+        {
+            return addresses_[left].hash < addresses_[right].hash;
+        });
+}
+
+bool history_batch::addresses(std::vector<short_hash>& out) const
+{
+    out.clear();
+
+    if (!valid_)
+        return false;
+
+    out.reserve(scan_order_.size());
+    for (const auto index: scan_order_)
+        out.push_back(addresses_[index].hash);
+
+    return true;
+}
+
+bool history_batch::scan(fetch_function fetch)
+{
+    if (!valid_)
+        return false;
+
+    for (const auto index: scan_order_)
+    {
+        auto& entry = addresses_[index];
+
+        if (!fetch(entry.hash, from_height_, entry.history))
+        {
+            valid_ = false;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool history_batch::next(blockchain::fetch_history_batch_handler& chunk)
+{
+    chunk.Clear();
+    chunk.set_sequence(sequence_++);
+
+    if (!valid_)
+    {
+        chunk.set_error(error::bad_stream);
+        chunk.set_last(true);
+        return false;
+    }
+
+    uint32_t rows = 0;
+
+    // An address without history still gets an entry, marked complete,
+    // which counts as a row so that empty entries also bound the chunk.
+    while (address_ < addresses_.size() && rows < chunk_rows_)
+    {
+        const auto& entry = addresses_[address_];
+        auto& group = *chunk.add_addresses();
+        group.set_address_index(entry.index);
+
+        const auto remaining = entry.history.size() - row_;
+        const auto count = std::min<uint32_t>(remaining, chunk_rows_ - rows);
+        auto& history = *group.mutable_history();
+        history.Reserve(static_cast<int>(count));
+
+        for (uint32_t row = 0; row < count; ++row)
+            *history.Add() = entry.history.Get(row_++);
+
+        rows += std::max<uint32_t>(count, 1);
+
+        if (row_ == entry.history.size())
+        {
+            group.set_complete(true);
+            ++address_;
+            row_ = 0;
+        }
+    }
+
+    const auto last = address_ == addresses_.size();
+    chunk.set_last(last);
+    return !last;
+}
+
+} // namespace protocol
+} // namespace libbitcoin
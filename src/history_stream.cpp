@@ -0,0 +1,154 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/protocol/history_stream.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/blockchain.pb.h>
+
+namespace libbitcoin {
+namespace protocol {
+
+template <typename Integer>
+static void put_little_endian(std::string& out, Integer value)
+{
+    for (size_t byte = 0; byte < sizeof(Integer); ++byte)
+        out.push_back(static_cast<char>(value >> (8 * byte)));
+}
+
+template <typename Integer>
+static Integer get_little_endian(std::string::const_iterator& in)
+{
+    Integer value = 0;
+    for (size_t byte = 0; byte < sizeof(Integer); ++byte)
+        value |= static_cast<Integer>(static_cast<uint8_t>(*in++)) <<
+            (8 * byte);
+
+    return value;
+}
+
+std::string history_stream::to_cursor(const row& row)
+{
+    // A missing or malformed point hash is encoded as all zeros.
+    auto hash = row.point().hash();
+    hash.resize(hash_size, 0);
+
+    std::string cursor;
+    cursor.reserve(cursor_size);
+    put_little_endian<uint64_t>(cursor, row.height());
+    cursor += hash;
+    put_little_endian<uint32_t>(cursor, row.point().index());
+    put_little_endian<uint32_t>(cursor, row.kind());
+    return cursor;
+}
+
+bool history_stream::from_cursor(const std::string& cursor, row& out)
+{
+    if (cursor.size() != cursor_size)
+        return false;
+
+    auto in = cursor.begin();
+    out.set_height(get_little_endian<uint64_t>(in));
+    out.mutable_point()->set_hash(std::string(in, in + hash_size));
+    in += hash_size;
+    out.mutable_point()->set_index(get_little_endian<uint32_t>(in));
+    out.set_kind(get_little_endian<uint32_t>(in));
+    return true;
+}
+
+bool history_stream::before(const row& left, const row& right)
+{
+    return std::make_tuple(left.height(), std::cref(left.point().hash()),
+        left.point().index(), left.kind()) <
+        std::make_tuple(right.height(), std::cref(right.point().hash()),
+        right.point().index(), right.kind());
+}
+
+history_stream::history_stream(
+    const blockchain::fetch_history_stream_request& request,
+    row_list history)
+  : history_(std::move(history)),
+    position_(0),
+    chunk_rows_(request.chunk_rows() == 0 ? default_chunk_rows :
+        request.chunk_rows()),
+    sequence_(0),
+    cursor_(request.cursor()),
+    valid_(true)
+{
+    row after;
+    const auto resume = !cursor_.empty();
+
+    if (resume && !from_cursor(cursor_, after))
+    {
+        valid_ = false;
+        return;
+    }
+
+    order_.reserve(history_.size());
+
+    for (int index = 0; index < history_.size(); ++index)
+    {
+        const auto& entry = history_.Get(index);
+        if (entry.height() >= request.from_height() &&
+            (!resume || before(after, entry)))
+            order_.push_back(index);
+    }
+
+    const auto& rows = history_;
+    std::sort(order_.begin(), order_.end(),
+        [&rows](int left, int right)
+        {
+            return before(rows.Get(left), rows.Get(right));
+        });
+}
+
+bool history_stream::next(blockchain::fetch_history_stream_handler& chunk)
+{
+    chunk.Clear();
+    chunk.set_sequence(sequence_++);
+
+    if (!valid_)
+    {
+        chunk.set_error(error::bad_stream);
+        chunk.set_last(true);
+        return false;
+    }
+
+    const auto end = std::min(order_.size(), position_ + chunk_rows_);
+    auto& rows = *chunk.mutable_history();
+    rows.Reserve(static_cast<int>(end - position_));
+
+    for (; position_ < end; ++position_)
+        *rows.Add() = history_.Get(order_[position_]);
+
+    if (rows.size() != 0)
+        cursor_ = to_cursor(history_.Get(order_[position_ - 1]));
+
+    const auto last = position_ == order_.size();
+    chunk.set_cursor(cursor_);
+    chunk.set_last(last);
+    return !last;
+}
+
+} // namespace protocol
+} // namespace libbitcoin
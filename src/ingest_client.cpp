@@ -0,0 +1,192 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/protocol/ingest_client.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/converter.hpp>
+#include <bitcoin/protocol/database.pb.h>
+#include <bitcoin/protocol/zmq/message.hpp>
+
+namespace libbitcoin {
+namespace protocol {
+
+// Allowance for the tag and length prefix of each packed block.
+static constexpr size_t block_overhead = 8;
+
+ingest_client::ingest_client(zmq::context& context, size_t window_bytes,
+    size_t frame_bytes, int32_t timeout_milliseconds)
+  : window_bytes_(window_bytes),
+    frame_bytes_(frame_bytes),
+    timeout_(timeout_milliseconds),
+    socket_(context, zmq::socket::role::dealer),
+    frame_size_(0),
+    sequence_(0),
+    acknowledged_(0),
+    in_flight_bytes_(0)
+{
+    frame_.set_sequence(1);
+}
+
+code ingest_client::connect(const config::endpoint& address)
+{
+    const auto ec = socket_.connect(address);
+
+    if (!ec)
+        poller_.add(socket_);
+
+    return ec;
+}
+
+code ingest_client::insert(const chain::block& block, uint64_t height)
+{
+    if (failure_)
+        return failure_;
+
+    auto& entry = *frame_.add_blocks();
+
+    // A block that does not convert is not sent, the client remains usable.
+    if (!converter{}.to_protocol(block, *entry.mutable_blockr()))
+    {
+        frame_.mutable_blocks()->RemoveLast();
+        return error::bad_stream;
+    }
+
+    entry.set_height(height);
+
+    ++sequence_;
+    frame_size_ += entry.ByteSize() + block_overhead;
+
+    return frame_size_ >= frame_bytes_ ? send_frame() : error::success;
+}
+
+code ingest_client::flush()
+{
+    auto ec = send_frame();
+
+    while (!ec && !in_flight_.empty())
+        ec = await();
+
+    return ec;
+}
+
+uint64_t ingest_client::sequence() const
+{
+    return sequence_;
+}
+
+uint64_t ingest_client::acknowledged() const
+{
+    return acknowledged_;
+}
+
+size_t ingest_client::in_flight() const
+{
+    return in_flight_bytes_;
+}
+
+code ingest_client::send_frame()
+{
+    if (failure_)
+        return failure_;
+
+    if (frame_.blocks_size() == 0)
+        return error::success;
+
+    // A frame larger than the window is sent once nothing else is in flight.
+    auto ec = drain();
+    while (!ec && !in_flight_.empty() &&
+        in_flight_bytes_ + frame_size_ > window_bytes_)
+        ec = await();
+
+    if (ec)
+        return ec;
+
+    zmq::message message;
+    message.enqueue_protobuf_message(frame_);
+    ec = message.send(socket_);
+
+    if (ec)
+        return failure_ = ec;
+
+    in_flight_.emplace_back(sequence_, frame_size_);
+    in_flight_bytes_ += frame_size_;
+
+    frame_.Clear();
+    frame_.set_sequence(sequence_ + 1);
+    frame_size_ = 0;
+    return error::success;
+}
+
+// Apply the acknowledgements already received.
+code ingest_client::drain()
+{
+    code ec;
+
+    while (!ec && poller_.wait(0).contains(socket_.id()))
+        ec = receive();
+
+    return ec;
+}
+
+// Wait for the next acknowledgement.
+code ingest_client::await()
+{
+    if (!poller_.wait(timeout_).contains(socket_.id()))
+        return failure_ = error::channel_timeout;
+
+    return receive();
+}
+
+code ingest_client::receive()
+{
+    zmq::message message;
+    auto ec = message.receive(socket_);
+
+    if (ec)
+        return failure_ = ec;
+
+    database::insert_blocks_reply reply;
+    if (!message.dequeue(reply))
+        return failure_ = error::bad_stream;
+
+    acknowledge(reply.acknowledged());
+
+    if (reply.result() != 0)
+        return failure_ = code(
+            static_cast<error::error_code_t>(reply.result()));
+
+    return error::success;
+}
+
+void ingest_client::acknowledge(uint64_t sequence)
+{
+    acknowledged_ = std::max(acknowledged_, sequence);
+
+    while (!in_flight_.empty() && in_flight_.front().first <= acknowledged_)
+    {
+        in_flight_bytes_ -= in_flight_.front().second;
+        in_flight_.pop_front();
+    }
+}
+
+} // namespace protocol
+} // namespace libbitcoin
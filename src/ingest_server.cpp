@@ -0,0 +1,142 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/protocol/ingest_server.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/database.pb.h>
+#include <bitcoin/protocol/zmq/message.hpp>
+
+namespace libbitcoin {
+namespace protocol {
+
+// Clients are pruned when their number doubles since the last pruning.
+static constexpr size_t minimum_prune_size = 64;
+
+ingest_server::ingest_server(zmq::context& context, insert_handler handler,
+    int32_t idle_timeout_seconds)
+  : handler_(handler),
+    idle_timeout_(std::chrono::seconds(idle_timeout_seconds)),
+    socket_(context, zmq::socket::role::router),
+    prune_size_(minimum_prune_size)
+{
+}
+
+code ingest_server::bind(const config::endpoint& address)
+{
+    const auto ec = socket_.bind(address);
+
+    if (!ec)
+        poller_.add(socket_);
+
+    return ec;
+}
+
+code ingest_server::process(int32_t timeout_milliseconds)
+{
+    if (!poller_.wait(timeout_milliseconds).contains(socket_.id()))
+        return error::channel_timeout;
+
+    zmq::message message;
+    auto ec = message.receive(socket_);
+
+    if (ec)
+        return ec;
+
+    const auto now = clock::now();
+    prune(now);
+
+    // The router prefixes the frame with the identity of the client.
+    const auto identity = message.dequeue_text();
+    auto& entry = clients_[identity];
+    entry.active = now;
+
+    database::insert_blocks_request request;
+    database::insert_blocks_reply reply;
+
+    if (message.dequeue(request))
+        insert(entry.acknowledged, request, reply);
+    else
+        reply.set_result(error::bad_stream);
+
+    reply.set_acknowledged(entry.acknowledged);
+
+    // A failed client stores no further blocks, so it need not be tracked:
+    // its later frames are gaps from zero.
+    if (reply.result() != 0)
+        clients_.erase(identity);
+
+    zmq::message response;
+    response.enqueue(identity);
+    response.enqueue_protobuf_message(reply);
+    return response.send(socket_);
+}
+
+bool ingest_server::stop()
+{
+    return socket_.stop();
+}
+
+void ingest_server::insert(uint64_t& acknowledged,
+    const database::insert_blocks_request& request,
+    database::insert_blocks_reply& reply)
+{
+    auto sequence = request.sequence();
+
+    for (const auto& block: request.blocks())
+    {
+        // The client does not retransmit, so a frame out of sequence follows
+        // a failure and its blocks are not stored.
+        if (sequence != acknowledged + 1)
+        {
+            reply.set_result(error::bad_stream);
+            return;
+        }
+
+        const auto ec = handler_(block);
+
+        if (ec)
+        {
+            reply.set_result(ec.value());
+            return;
+        }
+
+        acknowledged = sequence++;
+    }
+}
+
+void ingest_server::prune(clock::time_point now)
+{
+    if (clients_.size() < prune_size_)
+        return;
+
+    for (auto it = clients_.begin(); it != clients_.end();)
+        it = now - it->second.active >= idle_timeout_ ? clients_.erase(it) :
+            std::next(it);
+
+    prune_size_ = std::max(minimum_prune_size, 2 * clients_.size());
+}
+
+} // namespace protocol
+} // namespace libbitcoin
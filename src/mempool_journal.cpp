@@ -0,0 +1,195 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/protocol/mempool_journal.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/blockchain.pb.h>
+
+namespace libbitcoin {
+namespace protocol {
+
+mempool_journal::mempool_journal(size_t history)
+  : history_(history),
+    sequence_(0)
+{
+}
+
+void mempool_journal::add(const hash_digest& hash,
+    transaction_ptr transaction)
+{
+    if (!transaction)
+        return;
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    unique_lock lock(mutex_);
+
+    if (pool_.emplace(hash, transaction).second)
+        record(hash, transaction);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void mempool_journal::remove(const hash_digest& hash)
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    unique_lock lock(mutex_);
+
+    if (pool_.erase(hash) != 0)
+        record(hash, nullptr);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// Call while holding the mutex exclusively.
+void mempool_journal::record(const hash_digest& hash,
+    transaction_ptr transaction)
+{
+    changes_.push_back({ ++sequence_, hash, transaction });
+
+    while (changes_.size() > history_)
+        changes_.pop_front();
+}
+
+uint64_t mempool_journal::sequence() const
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    shared_lock lock(mutex_);
+
+    return sequence_;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+size_t mempool_journal::size() const
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    shared_lock lock(mutex_);
+
+    return pool_.size();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void mempool_journal::delta(
+    const blockchain::fetch_mempool_delta_request& request,
+    blockchain::fetch_mempool_delta_reply& reply) const
+{
+    // A transaction's net change: whether it was in the mirror before the
+    // delta and its body if it is in the mempool after.
+    struct net
+    {
+        bool existed;
+        transaction_ptr transaction;
+    };
+
+    const auto since = request.since_sequence();
+    const auto max_bytes = request.max_bytes();
+    reply.Clear();
+    reply.set_since_sequence(since);
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    shared_lock lock(mutex_);
+
+    if (since != 0 && since == sequence_)
+    {
+        reply.set_sequence(since);
+        return;
+    }
+
+    // The changes following since must all be retained.
+    if (since == 0 || since > sequence_ || changes_.empty() ||
+        changes_.front().sequence > since + 1)
+    {
+        snapshot(reply);
+        return;
+    }
+
+    std::unordered_map<hash_digest, net> nets;
+    uint64_t bytes = 0;
+    auto last = since;
+
+    for (auto it = changes_.begin() + (since + 1 - changes_.front().sequence);
+        it != changes_.end(); ++it)
+    {
+        const uint64_t size = it->transaction ?
+            it->transaction->ByteSize() : hash_size;
+
+        if (max_bytes != 0 && last != since && bytes + size > max_bytes)
+        {
+            reply.set_truncated(true);
+            break;
+        }
+
+        bytes += size;
+        last = it->sequence;
+
+        const auto found = nets.find(it->hash);
+        if (found == nets.end())
+            nets.emplace(it->hash, net{ !it->transaction, it->transaction });
+        else
+            found->second.transaction = it->transaction;
+    }
+    ///////////////////////////////////////////////////////////////////////////
+
+    reply.set_sequence(last);
+
+    for (const auto& entry: nets)
+    {
+        const auto& change = entry.second;
+
+        const std::string hash(entry.first.begin(), entry.first.end());
+
+        if (change.existed && !change.transaction)
+        {
+            reply.add_removed(hash);
+        }
+        else if (!change.existed && change.transaction)
+        {
+            *reply.add_added() = *change.transaction;
+            reply.add_added_hashes(hash);
+        }
+    }
+}
+
+// Call while holding the mutex.
+void mempool_journal::snapshot(
+    blockchain::fetch_mempool_delta_reply& reply) const
+{
+    reply.set_sequence(sequence_);
+    reply.set_snapshot(true);
+
+    auto& added = *reply.mutable_added();
+    auto& hashes = *reply.mutable_added_hashes();
+    added.Reserve(static_cast<int>(pool_.size()));
+    hashes.Reserve(static_cast<int>(pool_.size()));
+
+    for (const auto& entry: pool_)
+    {
+        *added.Add() = *entry.second;
+        hashes.Add()->assign(entry.first.begin(), entry.first.end());
+    }
+}
+
+} // namespace protocol
+} // namespace libbitcoin
@@ -0,0 +1,137 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/protocol/mempool_mirror.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/blockchain.pb.h>
+
+namespace libbitcoin {
+namespace protocol {
+
+static bool unpack_hash(hash_digest& out, const std::string& in)
+{
+    if (in.size() != hash_size)
+        return false;
+
+    std::copy(in.begin(), in.end(), out.begin());
+    return true;
+}
+
+mempool_mirror::mempool_mirror()
+  : sequence_(0)
+{
+}
+
+uint64_t mempool_mirror::sequence() const
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    shared_lock lock(mutex_);
+
+    return sequence_;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool mempool_mirror::apply(const blockchain::fetch_mempool_delta_reply& reply)
+{
+    if (reply.added_size() != reply.added_hashes_size())
+        return false;
+
+    hash_list removed(reply.removed_size());
+    for (int index = 0; index < reply.removed_size(); ++index)
+        if (!unpack_hash(removed[index], reply.removed(index)))
+            return false;
+
+    hash_list added(reply.added_hashes_size());
+    for (int index = 0; index < reply.added_hashes_size(); ++index)
+        if (!unpack_hash(added[index], reply.added_hashes(index)))
+            return false;
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    unique_lock lock(mutex_);
+
+    if (reply.snapshot())
+        pool_.clear();
+    else if (reply.since_sequence() != sequence_)
+        return false;
+
+    for (const auto& hash: removed)
+        pool_.erase(hash);
+
+    for (size_t index = 0; index < added.size(); ++index)
+        pool_[added[index]] = reply.added(static_cast<int>(index));
+
+    sequence_ = reply.sequence();
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool mempool_mirror::find(const hash_digest& hash, tx_mempool& out) const
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    shared_lock lock(mutex_);
+
+    const auto it = pool_.find(hash);
+    if (it == pool_.end())
+        return false;
+
+    out = it->second;
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool mempool_mirror::contains(const hash_digest& hash) const
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    shared_lock lock(mutex_);
+
+    return pool_.find(hash) != pool_.end();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+size_t mempool_mirror::size() const
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    shared_lock lock(mutex_);
+
+    return pool_.size();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void mempool_mirror::clear()
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    unique_lock lock(mutex_);
+
+    pool_.clear();
+    sequence_ = 0;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+} // namespace protocol
+} // namespace libbitcoin
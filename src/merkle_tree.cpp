@@ -0,0 +1,329 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/protocol/merkle_tree.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace protocol {
+
+// SHA-256 is computed for this many messages at once. Each step of the
+// compression function is applied across lanes in a fixed-size inner loop,
+// which the compiler maps onto vector registers (SSE2, NEON).
+static constexpr size_t lanes = 4;
+
+typedef uint32_t lane_word[lanes];
+
+static const uint32_t initial_state[8] =
+{
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static const uint32_t round_constants[64] =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t rotate_right(uint32_t value, size_t bits)
+{
+    return (value >> bits) | (value << (32 - bits));
+}
+
+static void compress(lane_word state[8], const lane_word block[16])
+{
+    lane_word schedule[64];
+
+    for (size_t round = 0; round < 16; ++round)
+        for (size_t lane = 0; lane < lanes; ++lane)
+            schedule[round][lane] = block[round][lane];
+
+    for (size_t round = 16; round < 64; ++round)
+    {
+        for (size_t lane = 0; lane < lanes; ++lane)
+        {
+            const auto w15 = schedule[round - 15][lane];
+            const auto w2 = schedule[round - 2][lane];
+            const auto s0 = rotate_right(w15, 7) ^ rotate_right(w15, 18) ^
+                (w15 >> 3);
+            const auto s1 = rotate_right(w2, 17) ^ rotate_right(w2, 19) ^
+                (w2 >> 10);
+            schedule[round][lane] = schedule[round - 16][lane] + s0 +
+                schedule[round - 7][lane] + s1;
+        }
+    }
+
+    lane_word a, b, c, d, e, f, g, h;
+    for (size_t lane = 0; lane < lanes; ++lane)
+    {
+        a[lane] = state[0][lane];
+        b[lane] = state[1][lane];
+        c[lane] = state[2][lane];
+        d[lane] = state[3][lane];
+        e[lane] = state[4][lane];
+        f[lane] = state[5][lane];
+        g[lane] = state[6][lane];
+        h[lane] = state[7][lane];
+    }
+
+    for (size_t round = 0; round < 64; ++round)
+    {
+        for (size_t lane = 0; lane < lanes; ++lane)
+        {
+            const auto sum1 = rotate_right(e[lane], 6) ^
+                rotate_right(e[lane], 11) ^ rotate_right(e[lane], 25);
+            const auto choose = (e[lane] & f[lane]) ^ (~e[lane] & g[lane]);
+            const auto temp1 = h[lane] + sum1 + choose +
+                round_constants[round] + schedule[round][lane];
+            const auto sum0 = rotate_right(a[lane], 2) ^
+                rotate_right(a[lane], 13) ^ rotate_right(a[lane], 22);
+            const auto majority = (a[lane] & b[lane]) ^ (a[lane] & c[lane]) ^
+                (b[lane] & c[lane]);
+
+            h[lane] = g[lane];
+            g[lane] = f[lane];
+            f[lane] = e[lane];
+            e[lane] = d[lane] + temp1;
+            d[lane] = c[lane];
+            c[lane] = b[lane];
+            b[lane] = a[lane];
+            a[lane] = temp1 + sum0 + majority;
+        }
+    }
+
+    for (size_t lane = 0; lane < lanes; ++lane)
+    {
+        state[0][lane] += a[lane];
+        state[1][lane] += b[lane];
+        state[2][lane] += c[lane];
+        state[3][lane] += d[lane];
+        state[4][lane] += e[lane];
+        state[5][lane] += f[lane];
+        state[6][lane] += g[lane];
+        state[7][lane] += h[lane];
+    }
+}
+
+static void initialize(lane_word state[8])
+{
+    for (size_t word = 0; word < 8; ++word)
+        for (size_t lane = 0; lane < lanes; ++lane)
+            state[word][lane] = initial_state[word];
+}
+
+// Padding of a message of the given number of bits, following a
+// message that filled the block words before the first.
+static void pad(lane_word block[16], size_t first, uint32_t bits)
+{
+    for (size_t word = first; word < 16; ++word)
+        for (size_t lane = 0; lane < lanes; ++lane)
+            block[word][lane] = 0;
+
+    for (size_t lane = 0; lane < lanes; ++lane)
+    {
+        block[first][lane] = 0x80000000;
+        block[15][lane] = bits;
+    }
+}
+
+static inline uint32_t get_big_endian(const uint8_t* in)
+{
+    return (static_cast<uint32_t>(in[0]) << 24) |
+        (static_cast<uint32_t>(in[1]) << 16) |
+        (static_cast<uint32_t>(in[2]) << 8) | in[3];
+}
+
+static inline void put_big_endian(uint8_t* out, uint32_t value)
+{
+    out[0] = static_cast<uint8_t>(value >> 24);
+    out[1] = static_cast<uint8_t>(value >> 16);
+    out[2] = static_cast<uint8_t>(value >> 8);
+    out[3] = static_cast<uint8_t>(value);
+}
+
+// Double SHA-256 of up to a full set of lanes of 64 byte messages.
+static void hash_lanes(const uint8_t* pairs, uint8_t* out, size_t count)
+{
+    lane_word state[8];
+    lane_word block[16];
+
+    // Unused lanes hash a copy of the first message, and are not written.
+    for (size_t lane = 0; lane < lanes; ++lane)
+    {
+        const auto message = pairs + 64 * (lane < count ? lane : 0);
+        for (size_t word = 0; word < 16; ++word)
+            block[word][lane] = get_big_endian(message + 4 * word);
+    }
+
+    initialize(state);
+    compress(state, block);
+    pad(block, 0, 512);
+    compress(state, block);
+
+    for (size_t word = 0; word < 8; ++word)
+        for (size_t lane = 0; lane < lanes; ++lane)
+            block[word][lane] = state[word][lane];
+
+    pad(block, 8, 256);
+    initialize(state);
+    compress(state, block);
+
+    for (size_t lane = 0; lane < count; ++lane)
+        for (size_t word = 0; word < 8; ++word)
+            put_big_endian(out + hash_size * lane + 4 * word,
+                state[word][lane]);
+}
+
+void merkle_tree::hash_pairs(const uint8_t* pairs, uint8_t* out,
+    size_t count)
+{
+    for (size_t offset = 0; offset < count; offset += lanes)
+        hash_lanes(pairs + 64 * offset, out + hash_size * offset,
+            std::min(lanes, count - offset));
+}
+
+merkle_tree::merkle_tree(const hash_list& leaves)
+{
+    if (leaves.empty())
+        return;
+
+    levels_.push_back(leaves);
+    data_chunk pairs;
+
+    while (levels_.back().size() > 1)
+    {
+        const auto& below = levels_.back();
+        const auto count = (below.size() + 1) / 2;
+        pairs.resize(count * 2 * hash_size);
+
+        // An odd last hash is paired with itself.
+        auto out = pairs.begin();
+        for (size_t index = 0; index < count * 2; ++index)
+        {
+            const auto& hash = below[std::min(index, below.size() - 1)];
+            out = std::copy(hash.begin(), hash.end(), out);
+        }
+
+        hash_list level(count);
+        hash_pairs(pairs.data(), level.front().data(), count);
+        levels_.push_back(std::move(level));
+    }
+}
+
+hash_digest merkle_tree::root() const
+{
+    return levels_.empty() ? null_hash : levels_.back().front();
+}
+
+size_t merkle_tree::size() const
+{
+    return levels_.empty() ? 0 : levels_.front().size();
+}
+
+bool merkle_tree::branch(size_t index, hash_list& out) const
+{
+    if (index >= size())
+        return false;
+
+    out.clear();
+    out.reserve(levels_.size() - 1);
+
+    for (size_t height = 0; height + 1 < levels_.size(); ++height)
+    {
+        const auto& level = levels_[height];
+        const auto sibling = std::min(index ^ 1, level.size() - 1);
+        out.push_back(level[sibling]);
+        index /= 2;
+    }
+
+    return true;
+}
+
+void merkle_tree::partial(const std::vector<bool>& matches,
+    hash_list& hashes, data_chunk& flags) const
+{
+    hashes.clear();
+    flags.clear();
+
+    if (levels_.empty())
+        return;
+
+    std::vector<bool> bits;
+    traverse(levels_.size() - 1, 0, matches, hashes, bits);
+
+    flags.resize((bits.size() + 7) / 8, 0);
+    for (size_t bit = 0; bit < bits.size(); ++bit)
+        if (bits[bit])
+            flags[bit / 8] |= static_cast<uint8_t>(1 << (bit % 8));
+}
+
+size_t merkle_tree::width(size_t height) const
+{
+    return levels_[height].size();
+}
+
+// Depth first, a flag bit per node: whether it is or is above a match.
+// The hash of a node is emitted if it is a leaf or no match lies below.
+void merkle_tree::traverse(size_t height, size_t position,
+    const std::vector<bool>& matches, hash_list& hashes,
+    std::vector<bool>& bits) const
+{
+    const auto begin = position << height;
+    const auto end = std::min((position + 1) << height, size());
+
+    auto matched = false;
+    for (auto leaf = begin; leaf < end && leaf < matches.size() && !matched;
+        ++leaf)
+        matched = matches[leaf];
+
+    bits.push_back(matched);
+
+    if (height == 0 || !matched)
+    {
+        hashes.push_back(levels_[height][position]);
+        return;
+    }
+
+    traverse(height - 1, position * 2, matches, hashes, bits);
+
+    if (position * 2 + 1 < width(height - 1))
+        traverse(height - 1, position * 2 + 1, matches, hashes, bits);
+}
+
+} // namespace protocol
+} // namespace libbitcoin
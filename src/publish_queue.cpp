@@ -0,0 +1,160 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/protocol/publish_queue.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <google/protobuf/message_lite.h>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/zmq/message.hpp>
+
+namespace libbitcoin {
+namespace protocol {
+
+publish_queue::publish_queue(send_function send, policy policy,
+    size_t capacity)
+  : send_(send),
+    policy_(policy),
+    capacity_(std::max(capacity, size_t(1))),
+    front_sequence_(0),
+    depth_(0),
+    sent_(0),
+    dropped_(0),
+    disconnected_(false)
+{
+}
+
+publish_queue::~publish_queue()
+{
+    for (const auto& entry: entries_)
+        delete entry.owned;
+}
+
+void publish_queue::push(const std::string& id, const zmq::message& message,
+    google::protobuf::MessageLite* owned, bool conflatable)
+{
+    if (disconnected_)
+    {
+        delete owned;
+        ++dropped_;
+        return;
+    }
+
+    if (policy_ == policy::conflate && conflatable)
+    {
+        const auto it = sequences_.find(id);
+        if (it != sequences_.end())
+        {
+            auto& entry = entries_[it->second - front_sequence_];
+            delete entry.owned;
+            entry.message = message;
+            entry.owned = owned;
+            ++dropped_;
+            return;
+        }
+    }
+
+    if (entries_.size() == capacity_)
+    {
+        if (policy_ == policy::disconnect)
+        {
+            delete owned;
+            ++dropped_;
+            drop_all();
+            disconnected_ = true;
+            return;
+        }
+
+        drop_front();
+    }
+
+    // A reply that is not conflatable is never passed by a later one.
+    if (policy_ == policy::conflate && conflatable)
+        sequences_[id] = front_sequence_ + entries_.size();
+    else if (policy_ == policy::conflate)
+        sequences_.erase(id);
+
+    entries_.push_back({ id, message, owned });
+    depth_ = entries_.size();
+}
+
+bool publish_queue::flush()
+{
+    while (!entries_.empty())
+    {
+        auto& entry = entries_.front();
+        const auto ec = send_(entry.message);
+
+        if (ec == error::channel_timeout)
+            return false;
+
+        // The receiver owns a sent reply, a reply that failed is deleted.
+        if (ec)
+        {
+            drop_front();
+            continue;
+        }
+
+        entry.owned = nullptr;
+        pop_front();
+        ++sent_;
+    }
+
+    return true;
+}
+
+bool publish_queue::disconnected() const
+{
+    return disconnected_;
+}
+
+publish_queue::statistics publish_queue::stats() const
+{
+    return { depth_, sent_, dropped_, disconnected_ };
+}
+
+// The handler id is forgotten only if the front is its last queued reply.
+void publish_queue::pop_front()
+{
+    const auto it = sequences_.find(entries_.front().id);
+    if (it != sequences_.end() && it->second == front_sequence_)
+        sequences_.erase(it);
+
+    entries_.pop_front();
+    ++front_sequence_;
+    depth_ = entries_.size();
+}
+
+void publish_queue::drop_front()
+{
+    delete entries_.front().owned;
+    pop_front();
+    ++dropped_;
+}
+
+void publish_queue::drop_all()
+{
+    while (!entries_.empty())
+        drop_front();
+}
+
+} // namespace protocol
+} // namespace libbitcoin
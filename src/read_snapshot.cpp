@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/protocol/read_snapshot.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/database.pb.h>
+#include <bitcoin/protocol/requester.hpp>
+
+namespace libbitcoin {
+namespace protocol {
+
+code read_snapshot::read(requester& requester, reads body, size_t attempts,
+    int32_t retry_milliseconds)
+{
+    std::chrono::milliseconds pause(retry_milliseconds);
+
+    for (size_t attempt = 0; attempt < attempts; ++attempt)
+    {
+        if (attempt > 0)
+        {
+            std::this_thread::sleep_for(pause);
+            pause *= 2;
+        }
+
+        read_snapshot snapshot(requester);
+
+        if (snapshot.begin_)
+            return snapshot.begin_;
+
+        // Results of an invalidated snapshot are discarded, even if failed.
+        const auto ec = body(snapshot);
+
+        if (snapshot.valid_)
+            return ec;
+    }
+
+    return error::operation_failed;
+}
+
+read_snapshot::read_snapshot(requester& requester)
+  : requester_(requester),
+    handle_(0),
+    valid_(false)
+{
+    database::request request;
+    request.mutable_begin_read();
+
+    database::begin_read_reply reply;
+    begin_ = requester_.send(request, reply);
+
+    handle_ = reply.result();
+    valid_ = !begin_;
+}
+
+read_snapshot::operator const bool() const
+{
+    return valid_;
+}
+
+uint64_t read_snapshot::handle() const
+{
+    return handle_;
+}
+
+} // namespace protocol
+} // namespace libbitcoin
@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/protocol/replay_ring.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace libbitcoin {
+namespace protocol {
+
+replay_ring::replay_ring(const std::string& handler_id, size_t capacity)
+  : capacity_(std::max(capacity, size_t(1))),
+    handler_id_(handler_id),
+    sequence_(0)
+{
+}
+
+std::string replay_ring::handler_id() const
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return handler_id_;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+uint64_t replay_ring::sequence() const
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return sequence_;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// The reply of a sequence is at index sequence % capacity.
+uint64_t replay_ring::push(reply value, send_handler send)
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const auto sequence = ++sequence_;
+    const auto index = static_cast<size_t>(sequence % capacity_);
+
+    if (replies_.size() < capacity_)
+        replies_.resize(capacity_);
+
+    replies_[index] = value;
+
+    // Sending under the lock orders live replies after those of a resume.
+    send(handler_id_, sequence, value);
+    return sequence;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool replay_ring::resume(const std::string& handler_id,
+    uint64_t last_sequence, send_handler send)
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    handler_id_ = handler_id;
+
+    const auto oldest = sequence_ < capacity_ ? 1 : sequence_ - capacity_ + 1;
+
+    // A last sequence ahead of ours was not numbered by this ring (such as
+    // before a server restart), so all retained replies are sent as a gap.
+    const auto ahead = last_sequence > sequence_;
+    const auto first = ahead ? oldest : std::max(oldest, last_sequence + 1);
+
+    for (auto sequence = first; sequence <= sequence_; ++sequence)
+        send(handler_id_, sequence,
+            replies_[static_cast<size_t>(sequence % capacity_)]);
+
+    return !ahead && last_sequence + 1 >= oldest;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+} // namespace protocol
+} // namespace libbitcoin
@@ -1,24 +1,121 @@
 
 #include <bitcoin/protocol/replier.hpp>
 
+#include <algorithm>
+#include <chrono>
 #include <functional>
+#include <iterator>
 #include <mutex>
 #include <string>
 #include <system_error>
 #include <tuple>
+#include <vector>
 #include <boost/thread/latch.hpp>
 #include <boost/utility/in_place_factory.hpp>
 #include <google/protobuf/message_lite.h>
+#include <bitcoin/protocol/blockchain.pb.h>
+#include <bitcoin/protocol/interface.pb.h>
 #include <bitcoin/protocol/zmq/message.hpp>
 #include <bitcoin/protocol/zmq/zeromq.hpp>
 
 namespace libbitcoin {
 namespace protocol {
 
+static const std::string inproc_scheme = "inproc://";
+
+// Handler ids are "<endpoint>/<message type>/<sequence>". The endpoint is
+// either a scheme-less tcp "host:port" or an inproc address, which may
+// itself contain '/', so split from the right. The id comes from the
+// client, so false if malformed.
+static bool split_handler_id(std::string const& handler_id,
+    std::string& out_endpoint, std::string& out_id)
+{
+    const auto sequence = handler_id.find_last_of('/');
+    if (sequence == std::string::npos || sequence == 0 ||
+        sequence + 1 == handler_id.size())
+        return false;
+
+    const auto separator = handler_id.find_last_of('/', sequence - 1);
+    if (separator == std::string::npos || separator == 0 ||
+        separator + 1 == sequence)
+        return false;
+
+    out_endpoint = handler_id.substr(0, separator);
+    out_id = handler_id.substr(separator + 1);
+    return true;
+}
+
+static bool is_inproc_endpoint(std::string const& endpoint)
+{
+    return endpoint.compare(0, inproc_scheme.size(), inproc_scheme) == 0;
+}
+
+// The endpoint comes from the client, so only tcp is connected, and inproc
+// when the replier itself is bound to inproc. Anything else, such as ipc,
+// could point the server at an arbitrary local endpoint.
+static bool is_allowed_endpoint(std::string const& endpoint, bool inproc)
+{
+    if (is_inproc_endpoint(endpoint))
+        return inproc;
+
+    return endpoint.find('/') == std::string::npos &&
+        endpoint.find(':') != std::string::npos;
+}
+
+static std::string to_publish_address(std::string const& endpoint)
+{
+    return is_inproc_endpoint(endpoint) ? endpoint : "tcp://" + endpoint;
+}
+
+// Requests and replays are pruned when their number doubles since the last
+// pruning.
+static constexpr size_t minimum_requests_prune_size = 1024;
+
+// Publishers are pruned when their number doubles since the last pruning.
+static constexpr size_t minimum_publishers_prune_size = 64;
+
+// Requests carry the milliseconds the client waits for the reply, from the
+// time it sent the request.
+static std::chrono::steady_clock::time_point to_deadline(
+    const google::protobuf::MessageLite& request,
+    std::chrono::steady_clock::time_point sent)
+{
+    typedef std::chrono::steady_clock clock;
+
+    if (request.GetTypeName() !=
+        blockchain::request::default_instance().GetTypeName())
+        return clock::time_point::max();
+
+    const auto timeout =
+        static_cast<const blockchain::request&>(request).timeout();
+
+    return timeout == 0 ? clock::time_point::max() :
+        sent + std::chrono::milliseconds(timeout);
+}
+
+// The delay before queues of blocked subscribers are sent again.
+static const auto flush_interval = std::chrono::milliseconds(10);
+
+// A subscriber that accepts no reply for this long is presumed gone.
+static const auto publish_stall_timeout = std::chrono::seconds(30);
+
+// Copy the parts of a message without consuming it.
+static std::vector<data_chunk> to_parts(zmq::message message)
+{
+    std::vector<data_chunk> parts;
+    parts.reserve(message.size());
+
+    while (!message.empty())
+        parts.push_back(message.dequeue_data());
+
+    return parts;
+}
+
 replier::replier(zmq::context& context)
   : _context(context),
     _handlers_service(),
-    _handlers_work(_handlers_service)
+    _handlers_work(_handlers_service),
+    _flush_timer(_handlers_service)
 {
     _handlers_thread = asio::thread([&] {
         _handlers_service.run();
@@ -33,7 +130,11 @@ replier::replier(zmq::context& context, const config::endpoint& address)
 }
 
 replier::~replier()
-{}
+{
+    _handlers_service.stop();
+    if (_handlers_thread.joinable())
+        _handlers_thread.join();
+}
 
 replier::operator const bool() const
 {
@@ -47,9 +148,134 @@ code replier::bind(const config::endpoint& address)
     if (!*_socket)
         return zmq::get_last_error();
 
+    _inproc = (address.scheme() == "inproc");
     return _socket->bind(address);
 }
 
+void replier::set_capture(capture::ptr capture)
+{
+    _capture = capture;
+}
+
+void replier::set_response_cache(response_cache::ptr cache)
+{
+    _response_cache = cache;
+}
+
+void replier::set_admission_control(admission_control::ptr admission)
+{
+    _admission = admission;
+}
+
+void replier::set_publish_policy(publish_queue::policy policy,
+    size_t capacity)
+{
+    _publish_policy = policy;
+    _publish_capacity = capacity;
+}
+
+void replier::set_replay_capacity(size_t capacity)
+{
+    _replay_capacity = capacity;
+}
+
+code replier::resume(std::string const& handler_id,
+    std::string const& new_handler_id, uint64_t last_sequence)
+{
+    replay_ring::ptr ring;
+
+    {
+        std::lock_guard<std::mutex> lock(_handlers_mutex);
+
+        auto const replay = _replays.find(handler_id);
+        if (replay == _replays.end())
+            return error::not_found;
+
+        ring = replay->second.ring.lock();
+        if (!ring)
+        {
+            _replays.erase(replay);
+            return error::not_found;
+        }
+    }
+
+    // The subscription's own lease is for the endpoint it was made for.
+    publisher_lease lease;
+    code ec = publish_connect(new_handler_id, lease);
+    if (ec)
+        return ec;
+
+    {
+        std::lock_guard<std::mutex> lock(_handlers_mutex);
+        _replays.erase(handler_id);
+        _replays[new_handler_id] = { ring, lease };
+    }
+
+    const auto complete = ring->resume(new_handler_id, last_sequence,
+        [this](std::string const& id, uint64_t sequence,
+            replay_ring::reply const& reply)
+        {
+            send_sequenced_reply(id, sequence, *reply);
+        });
+
+    return complete ? error::success : error::operation_failed;
+}
+
+bool replier::expired(std::string const& handler_id) const
+{
+    std::lock_guard<std::mutex> lock(_handlers_mutex);
+
+    const auto request = _requests.find(handler_id);
+    if (request == _requests.end())
+        return false;
+
+    const auto state = request->second.lock();
+    return state && state->expired();
+}
+
+void replier::cancel(std::string const& handler_id)
+{
+    std::lock_guard<std::mutex> lock(_handlers_mutex);
+
+    const auto request = _requests.find(handler_id);
+    if (request == _requests.end())
+        return;
+
+    const auto state = request->second.lock();
+    if (state)
+        state->cancelled = true;
+
+    _requests.erase(request);
+}
+
+std::map<std::string, publish_queue::statistics>
+    replier::publish_statistics() const
+{
+    std::map<std::string, publish_queue::statistics> out;
+    std::lock_guard<std::mutex> lock(_handlers_mutex);
+
+    for (const auto& entry: _publishers)
+        out.emplace(entry.first, entry.second.queue.stats());
+
+    return out;
+}
+
+bool replier::send_cached(std::string const& handler_id,
+    std::string const& key)
+{
+    if (!_response_cache)
+        return false;
+
+    auto payload = _response_cache->find(key);
+    if (!payload)
+        return false;
+
+    publisher_lease lease;
+    publish_connect(handler_id, lease);
+    send_handler_payload(handler_id, std::move(payload));
+    return true;
+}
+
 code replier::receive(google::protobuf::MessageLite& request)
 {
     BITCOIN_ASSERT(_socket);
@@ -59,9 +285,29 @@ code replier::receive(google::protobuf::MessageLite& request)
     if (ec)
         return ec;
 
-    if (!message.dequeue(request))
+    const auto parsed = _inproc ?
+        message.dequeue_local(request) : message.dequeue(request);
+
+    if (!parsed)
         return error::bad_stream;
 
+    // Sojourn is measured from the time the client sent the request, so
+    // that it includes the wait in zmq buffers.
+    const auto now = clock::now();
+    _request_received = admission_control::sent_time(request, now);
+    _request_deadline = to_deadline(request, _request_received);
+    _request_class = admission_control::to_class(request);
+    _request_handled = false;
+
+    if (_capture)
+        _capture->write(capture::direction::request, request);
+
+    if (_admission && !_admission->admit(_request_class, now))
+    {
+        ec = send_overloaded(request);
+        return ec ? ec : error::peer_throttling;
+    }
+
     return error::success;
 }
 
@@ -69,22 +315,83 @@ code replier::send(zmq::message& reply)
 {
     BITCOIN_ASSERT(_socket);
 
+    if (_admission && !_request_handled)
+        _admission->record(_request_class, clock::now() - _request_received);
+
+    if (_capture)
+        _capture->write(capture::direction::reply, to_parts(reply));
+
     code ec = _socket->send(reply);
     if (ec) return ec;
 
     return error::success;
 }
 
-code replier::publish_connect(std::string const& handler_id)
+code replier::send(std::unique_ptr<google::protobuf::MessageLite> reply)
 {
-    const std::string endpoint =
-        handler_id.substr(0, handler_id.find_first_of('/'));
+    BITCOIN_ASSERT(_socket);
+
+    if (_admission && !_request_handled)
+        _admission->record(_request_class, clock::now() - _request_received);
+
+    if (_capture)
+        _capture->write(capture::direction::reply, *reply);
+
+    zmq::message message;
+
+    if (!_inproc)
+    {
+        message.enqueue_protobuf_message(*reply);
+        return _socket->send(message);
+    }
+
+    // On failure the requester never took ownership, so delete here.
+    const auto pointer = reply.get();
+    message.enqueue_protobuf_ownership(std::move(reply));
+
+    code ec = _socket->send(message);
+    if (ec)
+        delete pointer;
+
+    return ec;
+}
+
+// static
+bool replier::is_valid_handler(std::string const& handler_id, bool inproc)
+{
+    std::string endpoint;
+    std::string id;
+    return split_handler_id(handler_id, endpoint, id) &&
+        is_allowed_endpoint(endpoint, inproc);
+}
+
+// The client names the handler, so its inproc prefix alone is not trusted:
+// a replier bound to tcp never sends process-local parts.
+bool replier::is_local(std::string const& handler_id) const
+{
+    return _inproc &&
+        handler_id.compare(0, inproc_scheme.size(), inproc_scheme) == 0;
+}
+
+// The lease keeps the publisher from being pruned while a handler uses it.
+code replier::publish_connect(std::string const& handler_id,
+    publisher_lease& out_lease)
+{
+    std::string endpoint;
+    std::string id;
+    if (!split_handler_id(handler_id, endpoint, id) ||
+        !is_allowed_endpoint(endpoint, _inproc))
+        return error::bad_stream;
 
     {
         std::lock_guard<std::mutex> lock(_handlers_mutex);
 
-        if (_publish_sockets.count(endpoint))
+        auto const existing = _publishers.find(endpoint);
+        if (existing != _publishers.end())
+        {
+            out_lease = lease(existing->second);
             return error::success;
+        }
     }
 
     code ec;
@@ -93,18 +400,21 @@ code replier::publish_connect(std::string const& handler_id)
         _handlers_service.dispatch([&] () {
             auto publish_iter = [&] {
                 std::lock_guard<std::mutex> lock(_handlers_mutex);
+                prune_publishers();
 
-                auto r = _publish_sockets.emplace(std::piecewise_construct,
+                auto r = _publishers.emplace(std::piecewise_construct,
                     std::forward_as_tuple(endpoint),
-                    std::forward_as_tuple(std::ref(_context), zmq::socket::role::pair));
-                return r.second ? r.first : _publish_sockets.end();
+                    std::forward_as_tuple(std::ref(_context), _publish_policy,
+                        _publish_capacity));
+                out_lease = lease(r.first->second);
+                return r.second ? r.first : _publishers.end();
             }();
 
-            if (publish_iter != _publish_sockets.end())
+            if (publish_iter != _publishers.end())
             {
-                auto& socket = publish_iter->second;
+                auto& socket = publish_iter->second.socket;
 
-                ec = socket.connect("tcp://" + endpoint);
+                ec = socket.connect_address(to_publish_address(endpoint));
             } else {
                 ec = error::success;
             }
@@ -116,25 +426,357 @@ code replier::publish_connect(std::string const& handler_id)
 }
 
 void replier::send_handler_reply(std::string const& handler_id,
-    const google::protobuf::MessageLite& reply)
+    const google::protobuf::MessageLite& reply, bool conflatable)
 {
-    const auto separator = handler_id.find_first_of('/');
-    const std::string endpoint = handler_id.substr(0, separator);
-    const std::string id = handler_id.substr(separator + 1);
+    std::string endpoint;
+    std::string id;
+    if (!split_handler_id(handler_id, endpoint, id))
+        return;
 
-    auto publish_iter = [&] {
-        std::lock_guard<std::mutex> lock(_handlers_mutex);
-        return _publish_sockets.find(endpoint);
-    }();
-    BITCOIN_ASSERT(publish_iter != _publish_sockets.end());
+    if (_capture)
+        _capture->write(capture::direction::handler, handler_id, reply);
 
     zmq::message message;
     message.enqueue(id);
     message.enqueue_protobuf_message(reply);
     BITCOIN_ASSERT(message.size() == 2);
 
-    _handlers_service.dispatch([=] () mutable {
-        publish_iter->second.send(message);
+    _handlers_service.dispatch([=] () {
+        publish(endpoint, id, message, nullptr, conflatable);
+    });
+}
+
+void replier::send_handler_reply(std::string const& handler_id,
+    std::unique_ptr<google::protobuf::MessageLite> reply, bool conflatable)
+{
+    std::string endpoint;
+    std::string id;
+    if (!split_handler_id(handler_id, endpoint, id))
+        return;
+
+    if (_capture)
+        _capture->write(capture::direction::handler, handler_id, *reply);
+
+    const auto pointer = reply.get();
+    zmq::message message;
+    message.enqueue(id);
+    message.enqueue_protobuf_ownership(std::move(reply));
+    BITCOIN_ASSERT(message.size() == 2);
+
+    // Until sent the queue owns the reply, deleting it if dropped.
+    _handlers_service.dispatch([=] () {
+        publish(endpoint, id, message, pointer, conflatable);
+    });
+}
+
+void replier::send_cacheable_reply(std::string const& handler_id,
+    std::string const& key, size_t height,
+    const google::protobuf::MessageLite& reply)
+{
+    if (!_response_cache)
+    {
+        send_handler_reply(handler_id, reply);
+        return;
+    }
+
+    // Serialized once, the same bytes are sent now and on every cache hit.
+    const auto chunk = std::make_shared<data_chunk>(reply.ByteSize());
+    reply.SerializeToArray(chunk->data(), chunk->size());
+
+    const response_cache::payload payload = chunk;
+    _response_cache->store(key, height, payload);
+    send_handler_payload(handler_id, payload);
+}
+
+void replier::send_handler_payload(std::string const& handler_id,
+    response_cache::payload payload)
+{
+    std::string endpoint;
+    std::string id;
+    if (!split_handler_id(handler_id, endpoint, id))
+        return;
+
+    if (_capture)
+        _capture->write(capture::direction::handler, std::vector<data_chunk>
+        {
+            data_chunk(handler_id.begin(), handler_id.end()), *payload
+        });
+
+    // The payload is shared with the cache, so the part is a copy of it.
+    _handlers_service.dispatch([=] () {
+        zmq::message message;
+        message.enqueue(id);
+        message.enqueue(*payload);
+        publish(endpoint, id, message);
+    });
+}
+
+// The state is released with the handler, after which it is pruned.
+replier::request_state::ptr replier::make_request(
+    std::string const& handler_id)
+{
+    const auto state = std::make_shared<request_state>(_request_deadline,
+        _request_class, _request_received);
+    _request_handled = true;
+
+    std::lock_guard<std::mutex> lock(_handlers_mutex);
+
+    if (_requests.size() >= _requests_prune_size)
+    {
+        for (auto it = _requests.begin(); it != _requests.end();)
+            it = it->second.expired() ? _requests.erase(it) : std::next(it);
+
+        _requests_prune_size = std::max(minimum_requests_prune_size,
+            2 * _requests.size());
+    }
+
+    _requests[handler_id] = state;
+    return state;
+}
+
+void replier::record_sojourn(request_state const& state)
+{
+    if (_admission)
+        _admission->record(state.request_class,
+            clock::now() - state.received);
+}
+
+// Status replies start with the status frame, unlike other replies, so that
+// the requester recognizes them whatever the type of reply expected.
+code replier::send_overloaded(const google::protobuf::MessageLite& request)
+{
+    response status;
+    status.set_status(error::peer_throttling);
+
+    if (request.GetTypeName() ==
+        protocol::request::default_instance().GetTypeName())
+        status.set_id(static_cast<const protocol::request&>(request).id());
+
+    zmq::message message;
+    message.enqueue(admission_control::status_frame());
+    message.enqueue_protobuf_message(status);
+
+    if (_capture)
+        _capture->write(capture::direction::reply, to_parts(message));
+
+    return _socket->send(message);
+}
+
+replay_ring::ptr replier::make_replay(std::string const& handler_id)
+{
+    if (_replay_capacity == 0)
+        return nullptr;
+
+    auto const ring = std::make_shared<replay_ring>(handler_id,
+        _replay_capacity);
+
+    std::lock_guard<std::mutex> lock(_handlers_mutex);
+
+    if (_replays.size() >= _replays_prune_size)
+    {
+        for (auto it = _replays.begin(); it != _replays.end();)
+            it = it->second.ring.expired() ? _replays.erase(it) :
+                std::next(it);
+
+        _replays_prune_size = std::max(minimum_requests_prune_size,
+            2 * _replays.size());
+    }
+
+    _replays[handler_id] = { ring, nullptr };
+    return ring;
+}
+
+void replier::send_sequenced_reply(replay_ring::ptr const& ring,
+    replay_ring::reply reply)
+{
+    ring->push(std::move(reply),
+        [this](std::string const& id, uint64_t sequence,
+            replay_ring::reply const& value)
+        {
+            send_sequenced_reply(id, sequence, *value);
+        });
+}
+
+// The ring retains the reply, so over inproc a copy is passed instead.
+// Sequenced replies are not conflated, as replacing one would read as a gap.
+void replier::send_sequenced_reply(std::string const& handler_id,
+    uint64_t sequence, const google::protobuf::MessageLite& reply)
+{
+    std::string endpoint;
+    std::string id;
+    if (!split_handler_id(handler_id, endpoint, id))
+        return;
+
+    if (_capture)
+        _capture->write(capture::direction::handler, handler_id, reply);
+
+    google::protobuf::MessageLite* pointer = nullptr;
+    zmq::message message;
+    message.enqueue(id);
+
+    if (is_local(handler_id))
+    {
+        std::unique_ptr<google::protobuf::MessageLite> copy(reply.New());
+        copy->CheckTypeAndMergeFrom(reply);
+        pointer = copy.get();
+        message.enqueue_protobuf_ownership(std::move(copy));
+    }
+    else
+    {
+        message.enqueue_protobuf_message(reply);
+    }
+
+    message.enqueue_little_endian<uint64_t>(sequence);
+    BITCOIN_ASSERT(message.size() == 3);
+
+    _handlers_service.dispatch([=] () {
+        publish(endpoint, id, message, pointer);
+    });
+}
+
+replier::publisher::publisher(zmq::context& context,
+    publish_queue::policy policy, size_t capacity)
+  : socket(context, zmq::socket::role::pair),
+    queue([this](zmq::message& message)
+    {
+        return message.try_send(socket);
+    }, policy, capacity)
+{
+}
+
+// Call on the handlers thread, which alone modifies the publishers.
+void replier::publish(std::string const& endpoint, std::string const& id,
+    zmq::message const& message, google::protobuf::MessageLite* owned,
+    bool conflatable)
+{
+    const auto publish_iter = [&] {
+        std::lock_guard<std::mutex> lock(_handlers_mutex);
+        return _publishers.find(endpoint);
+    }();
+
+    // The handler id was not connected (see is_valid_handler).
+    if (publish_iter == _publishers.end())
+    {
+        delete owned;
+        return;
+    }
+
+    auto& target = publish_iter->second;
+    target.queue.push(id, message, owned, conflatable);
+
+    // Erased, closing its socket, so that the next request of the
+    // subscriber connects it again (see publish_connect).
+    if (target.queue.disconnected())
+    {
+        std::lock_guard<std::mutex> lock(_handlers_mutex);
+        _publishers.erase(publish_iter);
+        return;
+    }
+
+    if (target.queue.flush())
+    {
+        target.blocked_since = clock::time_point();
+        return;
+    }
+
+    if (target.blocked_since == clock::time_point())
+        target.blocked_since = clock::now();
+
+    schedule_flush();
+}
+
+// Call while holding the handlers mutex.
+replier::publisher_lease replier::lease(publisher& target)
+{
+    auto out = target.lease.lock();
+    if (!out)
+    {
+        out = std::make_shared<bool>(true);
+        target.lease = out;
+    }
+
+    return out;
+}
+
+// Call on the handlers thread while holding the handlers mutex.
+// A publisher without handlers is erased, once sent what its subscriber
+// accepts. A subscriber that has gone away never drains its queue, the
+// remaining replies of which are deleted with it.
+void replier::prune_publishers()
+{
+    if (_publishers.size() < _publishers_prune_size)
+        return;
+
+    for (auto it = _publishers.begin(); it != _publishers.end();)
+    {
+        if (!it->second.lease.expired())
+        {
+            ++it;
+            continue;
+        }
+
+        it->second.queue.flush();
+        it = _publishers.erase(it);
+    }
+
+    _publishers_prune_size = std::max(minimum_publishers_prune_size,
+        2 * _publishers.size());
+}
+
+// Call on the handlers thread.
+// A blocked publisher without handlers, or stalled past the timeout, is
+// erased, deleting its unsent replies, so that the flush is not scheduled
+// forever for a subscriber that has gone away. A live subscriber connects
+// again with its next request (see publish_connect).
+void replier::flush_publishers()
+{
+    auto blocked = false;
+    const auto now = clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(_handlers_mutex);
+
+        for (auto it = _publishers.begin(); it != _publishers.end();)
+        {
+            auto& target = it->second;
+
+            if (target.queue.disconnected() || target.queue.flush())
+            {
+                target.blocked_since = clock::time_point();
+                ++it;
+                continue;
+            }
+
+            if (target.lease.expired() ||
+                now - target.blocked_since >= publish_stall_timeout)
+            {
+                it = _publishers.erase(it);
+                continue;
+            }
+
+            blocked = true;
+            ++it;
+        }
+    }
+
+    if (blocked)
+        schedule_flush();
+}
+
+// Call on the handlers thread.
+void replier::schedule_flush()
+{
+    if (_flush_pending)
+        return;
+
+    _flush_pending = true;
+    _flush_timer.expires_from_now(flush_interval);
+    _flush_timer.async_wait([this](const boost::system::error_code& ec)
+    {
+        _flush_pending = false;
+
+        if (!ec)
+            flush_publishers();
     });
 }
 
@@ -1,9 +1,17 @@
 #include <bitcoin/protocol/requester.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <vector>
 #include <boost/thread/latch.hpp>
 
 #include <boost/utility/in_place_factory.hpp>
 #include <google/protobuf/message_lite.h>
+#include <bitcoin/protocol/admission_control.hpp>
+#include <bitcoin/protocol/blockchain.pb.h>
 #include <bitcoin/protocol/interface.pb.h>
 #include <bitcoin/protocol/zmq/message.hpp>
 #include <bitcoin/protocol/zmq/poller.hpp>
@@ -12,6 +20,12 @@
 namespace libbitcoin {
 namespace protocol {
 
+template <typename Message>
+static bool is_type(google::protobuf::MessageLite const& message)
+{
+    return message.GetTypeName() == Message::default_instance().GetTypeName();
+}
+
 code requester::simple_req_connect(const config::endpoint& address)
 {
     return connect(address);
@@ -50,6 +64,10 @@ code requester::connect(const config::endpoint& address)
 {
     _io_service.reset();
 
+    // Handlers survive disconnection, to be resumed on reconnection.
+    if (_handlers_threadpool.empty())
+        _handlers_threadpool.spawn(1);
+
     code ec;
     {
         boost::latch latch(2);
@@ -69,13 +87,25 @@ code requester::connect(const config::endpoint& address)
                 {
                     zmq::message message;
                     _subscriber_socket->receive(message);
-                    BITCOIN_ASSERT(message.size() == 2);
+                    BITCOIN_ASSERT(message.size() == 2 ||
+                        message.size() == 3);
 
                     std::string const id = message.dequeue_text();
                     data_chunk const payload = message.dequeue_data();
-                    call_handler(id, payload);
+
+                    // Subscriptions retained for resume are sequenced.
+                    uint64_t sequence = 0;
+                    data_chunk const part = message.dequeue_data();
+                    if (part.size() == sizeof(uint64_t))
+                        sequence = from_little_endian_unsafe<uint64_t>(
+                            part.begin());
+
+                    call_handler(id, payload, sequence);
                 }
 
+                if (_timeout > 0)
+                    expire_handlers();
+
             }
         });
         latch.count_down_and_wait();
@@ -84,9 +114,14 @@ code requester::connect(const config::endpoint& address)
 }
 
 void requester::call_handler(const std::string& str_id,
-     const data_chunk& payload)
+     const data_chunk& payload, uint64_t sequence)
 {
     std::function<code(const data_chunk&)> callback;
+    std::function<code(const google::protobuf::MessageLite&)> local_callback;
+
+    // Over inproc the replier passes ownership of the reply object itself.
+    const auto local = _inproc ?
+        zmq::message::to_protobuf_reference(payload) : nullptr;
 
 
     {
@@ -98,13 +133,20 @@ void requester::call_handler(const std::string& str_id,
             return x.first == str_id;
         });
 
-        BITCOIN_ASSERT(handler_iter != _handlers.end());
+        // The handler expired, was cancelled or removed before its reply
+        // arrived, so the reply (and an owned local reply) is dropped.
+        if (handler_iter == _handlers.end())
+        {
+            ++_dropped_replies;
+            return;
+        }
 
         auto& handler = handler_iter->second;
         if (handler.single)
         {
             // std::cout << "generating single: handler_id: " << str_id << std::endl;
             callback = std::move(handler_iter->second.function);
+            local_callback = std::move(handler_iter->second.local);
             _handlers.erase(handler_iter);
 
             if (_handlers.capacity() - _handlers.size() >= 1000) { //TODO: hardcoded
@@ -120,10 +162,34 @@ void requester::call_handler(const std::string& str_id,
                 // MAP
                 // callback = std::ref(handler_iter->second.function);
                 callback = handler_iter->second.function;
+                local_callback = handler_iter->second.local;
+
+                if (sequence != 0)
+                    handler.sequence = sequence;
             //}
         }
     }
 
+    if (_header_cache)
+        populate_cache(str_id, payload, local.get());
+
+    if (_capture)
+    {
+        if (local)
+            _capture->write(capture::direction::handler, str_id, *local);
+        else
+            _capture->write(capture::direction::handler,
+                { data_chunk(str_id.begin(), str_id.end()), payload });
+    }
+
+    if (local && local_callback != nullptr)
+    {
+        _handlers_threadpool.service().dispatch([=] {
+            local_callback(*local);
+        });
+        return;
+    }
+
     if (callback != nullptr)
     {
         _handlers_threadpool.service().dispatch([=] {
@@ -148,11 +214,79 @@ code requester::disconnect()
     return error::success;
 }
 
+size_t requester::dropped_replies() const
+{
+    return _dropped_replies;
+}
+
+bool requester::resume_point(std::string const& handler_id,
+    std::string& out_handler_id, uint64_t& out_sequence) const
+{
+    // The local id is "<message type>/<number>", after the endpoint.
+    auto const number = handler_id.find_last_of('/');
+    if (number == std::string::npos || number == 0)
+        return false;
+
+    auto const type = handler_id.find_last_of('/', number - 1);
+    auto const id = type == std::string::npos ? handler_id :
+        handler_id.substr(type + 1);
+
+    std::lock_guard<std::mutex> lock(_handlers_mutex);
+
+    auto const handler_iter = std::find_if(_handlers.begin(), _handlers.end(),
+        [&id](handlers_value_t const& x) {
+            return x.first == id;
+        });
+
+    if (handler_iter == _handlers.end() || handler_iter->second.single)
+        return false;
+
+    out_handler_id = _subscriber_endpoint + '/' + id;
+    out_sequence = handler_iter->second.sequence;
+    return true;
+}
+
+void requester::set_timeout(int32_t timeout_milliseconds)
+{
+    _timeout = timeout_milliseconds;
+}
+
+void requester::set_backoff(int32_t initial_milliseconds,
+    int32_t maximum_milliseconds)
+{
+    _initial_backoff = std::chrono::milliseconds(initial_milliseconds);
+    _maximum_backoff = std::chrono::milliseconds(maximum_milliseconds);
+}
+
+code requester::cancel(std::string const& handler_id)
+{
+    remove_handler(handler_id);
+
+    blockchain::request request;
+    request.mutable_cancel()->set_handler(handler_id);
+
+    blockchain::cancel_reply reply;
+    return send(request, reply);
+}
+
+void requester::set_capture(capture::ptr capture)
+{
+    _capture = capture;
+}
+
+void requester::set_header_cache(header_cache::ptr cache)
+{
+    _header_cache = cache;
+}
+
 code requester::send(const google::protobuf::MessageLite& request,
                      google::protobuf::MessageLite& reply)
 {
     BITCOIN_ASSERT(_socket);
 
+    if (_header_cache && answer_from_cache(request, reply))
+        return error::success;
+
     code ec;
     {
         boost::latch latch(2);
@@ -167,6 +301,7 @@ code requester::send(const google::protobuf::MessageLite& request,
 
 code requester::do_connect(const config::endpoint& address)
 {
+    _address = address;
     _socket = boost::in_place(
             std::ref(_context), zmq::socket::role::requester);
     if (!*_socket)
@@ -180,6 +315,19 @@ code requester::do_connect(const config::endpoint& address)
             std::ref(_context), zmq::socket::role::pair);
     if (!*_subscriber_socket)
         return zmq::get_last_error();
+
+    // Same-process (inproc) clients get an inproc subscriber channel, so they
+    // bypass tcp loopback. config::endpoint does not parse ipc addresses, so
+    // all other clients subscribe over tcp.
+    _inproc = (address.scheme() == "inproc");
+    if (_inproc)
+    {
+        std::stringstream name;
+        name << "inproc://" << address.host() << ".subscriber." << this;
+        _subscriber_endpoint = name.str();
+        return _subscriber_socket->bind_ephemeral(_subscriber_endpoint);
+    }
+
 //OLD CODE: ERROR WHEN USING BITPRIM-SERVER
 //    ec = _subscriber_socket->bind({ "tcp://127.0.0.1:0" });
 //TODO: change the endpoint
@@ -191,6 +339,7 @@ code requester::do_connect(const config::endpoint& address)
     if (ec)
         return ec;
 
+    // Tcp handler ids omit the scheme, as expected by existing servers.
     _subscriber_socket->get_last_endpoint(_subscriber_endpoint);
     _subscriber_endpoint = _subscriber_endpoint.substr(sizeof("tcp://")-1);
 
@@ -200,25 +349,371 @@ code requester::do_connect(const config::endpoint& address)
 code requester::do_send(const google::protobuf::MessageLite& request,
                         google::protobuf::MessageLite& reply)
 {
+    const auto request_class = admission_control::to_class(request);
+    if (backing_off(request_class))
+        return error::peer_throttling;
+
     zmq::message message;
-    message.enqueue_protobuf_message(request);
+
+    if (_capture)
+        _capture->write(capture::direction::request, request);
+
+    const auto bounded = _timeout > 0;
+
+    // Without a timeout the caller blocks until the reply, so the request
+    // remains valid until the replier has dequeued it and no serialization
+    // is required. With one, the replier may dequeue it after the caller has
+    // returned, so over inproc it takes ownership of a copy. Blockchain
+    // requests are copied to set the envelope.
+    std::unique_ptr<google::protobuf::MessageLite> copy;
+    if ((bounded && _inproc) || is_type<blockchain::request>(request))
+    {
+        copy.reset(request.New());
+        copy->CheckTypeAndMergeFrom(request);
+
+        if (is_type<blockchain::request>(*copy))
+        {
+            auto& query = static_cast<blockchain::request&>(*copy);
+            if (bounded && query.timeout() == 0)
+                query.set_timeout(static_cast<uint32_t>(_timeout));
+
+            query.set_sent(admission_control::to_sent(
+                std::chrono::system_clock::now()));
+        }
+    }
+
+    const auto pointer = copy.get();
+
+    if (_inproc && copy)
+        message.enqueue_protobuf_ownership(std::move(copy));
+    else if (_inproc)
+        message.enqueue_protobuf_reference(request);
+    else
+        message.enqueue_protobuf_message(copy ? *copy : request);
 
     code ec = _socket->send(message);
-    if (ec) return ec;
+    if (ec)
+    {
+        // On failure the replier never took ownership, so delete here.
+        if (_inproc)
+            delete pointer;
+
+        return ec;
+    }
+
+    if (bounded)
+    {
+        zmq::poller poller;
+        poller.add(*_socket);
+
+        // A late reply would break the send/receive lockstep, so the
+        // socket is replaced (lazy pirate).
+        if (!poller.wait(_timeout).contains(_socket->id()))
+        {
+            ec = do_reconnect();
+            return ec ? ec : error::channel_timeout;
+        }
+    }
 
     zmq::message response;
     ec = _socket->receive(response);
     if (ec) return ec;
 
-    if (!response.dequeue(reply))
+    // Status replies are never process-local.
+    if (admission_control::is_status_reply(response))
+    {
+        protocol::response status;
+        if (!response.dequeue() || !response.dequeue(status))
+            return error::bad_stream;
+
+        const auto result = static_cast<error::error_code_t>(status.status());
+        if (result == error::peer_throttling)
+            back_off(request_class);
+
+        return result;
+    }
+
+    _backoffs.erase(request_class);
+
+    const auto parsed = _inproc ?
+        response.dequeue_local(reply) : response.dequeue(reply);
+
+    if (!parsed)
         return error::bad_stream;
 
+    if (_capture)
+        _capture->write(capture::direction::reply, reply);
+
+    if (_header_cache)
+        populate_cache(request, reply);
+
     return error::success;
 }
 
+code requester::do_reconnect()
+{
+    _socket = boost::in_place(
+            std::ref(_context), zmq::socket::role::requester);
+    if (!*_socket)
+        return zmq::get_last_error();
+
+    return _socket->connect(_address);
+}
+
+bool requester::backing_off(int request_class) const
+{
+    const auto entry = _backoffs.find(request_class);
+    return entry != _backoffs.end() && clock::now() < entry->second.until;
+}
+
+void requester::back_off(int request_class)
+{
+    if (_initial_backoff == clock::duration::zero())
+        return;
+
+    const auto entry = _backoffs.find(request_class);
+    const auto delay = entry == _backoffs.end() ? _initial_backoff :
+        std::min(2 * entry->second.delay, _maximum_backoff);
+
+    _backoffs[request_class] = { delay, clock::now() + delay };
+}
+
+// Header cache.
+//-----------------------------------------------------------------------------
+
+static bool to_hash(std::string const& value, hash_digest& out)
+{
+    if (value.size() != hash_size)
+        return false;
+
+    std::copy(value.begin(), value.end(), out.begin());
+    return true;
+}
+
+bool requester::answer_from_cache(
+    const google::protobuf::MessageLite& request,
+    google::protobuf::MessageLite& reply)
+{
+    if (!is_type<blockchain::request>(request))
+        return false;
+
+    auto const& query = static_cast<blockchain::request const&>(request);
+
+    switch (query.request_type_case())
+    {
+        case blockchain::request::kGetHeader:
+        {
+            if (!is_type<blockchain::get_header_reply>(reply))
+                return false;
+
+            auto& out = static_cast<blockchain::get_header_reply&>(reply);
+            block_header header;
+            if (!_header_cache->header(query.get_header().height(), header))
+                return false;
+
+            out.Clear();
+            out.set_result(true);
+            out.mutable_out_header()->Swap(&header);
+            return true;
+        }
+        case blockchain::request::kGetBlockHash:
+        {
+            if (!is_type<blockchain::get_block_hash_reply>(reply))
+                return false;
+
+            auto& out = static_cast<blockchain::get_block_hash_reply&>(reply);
+            hash_digest hash;
+            if (!_header_cache->hash(query.get_block_hash().height(), hash))
+                return false;
+
+            out.Clear();
+            out.set_result(true);
+            out.set_out_hash(std::string(hash.begin(), hash.end()));
+            return true;
+        }
+        case blockchain::request::kGetHeight:
+        {
+            if (!is_type<blockchain::get_height_reply>(reply))
+                return false;
+
+            auto& out = static_cast<blockchain::get_height_reply&>(reply);
+            hash_digest hash;
+            size_t height;
+            if (!to_hash(query.get_height().block_hash(), hash) ||
+                !_header_cache->height(hash, height))
+                return false;
+
+            out.Clear();
+            out.set_result(true);
+            out.set_out_height(height);
+            return true;
+        }
+        case blockchain::request::kFetchBlockHeader:
+        {
+            // The handler is invoked locally, as if replied by the server.
+            auto const& fetch = query.fetch_block_header();
+            auto const prefix = _subscriber_endpoint + '/';
+            if (fetch.handler().compare(0, prefix.size(), prefix) != 0)
+                return false;
+
+            size_t height = fetch.height();
+            hash_digest hash;
+            if (!fetch.hash().empty() && (!to_hash(fetch.hash(), hash) ||
+                !_header_cache->height(hash, height)))
+                return false;
+
+            blockchain::fetch_block_header_handler handler;
+            if (!_header_cache->header(height, *handler.mutable_header()))
+                return false;
+
+            handler.set_height(height);
+            auto const id = fetch.handler().substr(prefix.size());
+
+            {
+                std::lock_guard<std::mutex> lock(_handlers_mutex);
+                auto const registered = std::find_if(_handlers.begin(),
+                    _handlers.end(), [&id](handlers_value_t const& x) {
+                        return x.first == id;
+                    });
+
+                if (registered == _handlers.end())
+                    return false;
+            }
+
+            data_chunk payload(handler.ByteSize());
+            handler.SerializeWithCachedSizesToArray(payload.data());
+            call_handler(id, payload);
+
+            reply.Clear();
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+void requester::populate_cache(const google::protobuf::MessageLite& request,
+    const google::protobuf::MessageLite& reply)
+{
+    if (!is_type<blockchain::request>(request))
+        return;
+
+    auto const& query = static_cast<blockchain::request const&>(request);
+
+    switch (query.request_type_case())
+    {
+        case blockchain::request::kGetHeader:
+        {
+            if (!is_type<blockchain::get_header_reply>(reply))
+                return;
+
+            auto const& out =
+                static_cast<blockchain::get_header_reply const&>(reply);
+            if (out.result() && out.has_out_header())
+                _header_cache->store(query.get_header().height(),
+                    out.out_header());
+            return;
+        }
+        case blockchain::request::kGetBlockHash:
+        {
+            if (!is_type<blockchain::get_block_hash_reply>(reply))
+                return;
+
+            auto const& out =
+                static_cast<blockchain::get_block_hash_reply const&>(reply);
+            hash_digest hash;
+            if (out.result() && to_hash(out.out_hash(), hash))
+                _header_cache->store(query.get_block_hash().height(), hash);
+            return;
+        }
+        case blockchain::request::kGetLastHeight:
+        {
+            if (!is_type<blockchain::get_last_height_reply>(reply))
+                return;
+
+            auto const& out =
+                static_cast<blockchain::get_last_height_reply const&>(reply);
+            if (out.result())
+                _header_cache->set_top(out.out_height());
+            return;
+        }
+        case blockchain::request::kGetHeight:
+        {
+            if (!is_type<blockchain::get_height_reply>(reply))
+                return;
+
+            auto const& out =
+                static_cast<blockchain::get_height_reply const&>(reply);
+            hash_digest hash;
+            if (out.result() && to_hash(query.get_height().block_hash(), hash))
+                _header_cache->store(out.out_height(), hash);
+            return;
+        }
+        default:
+            return;
+    }
+}
+
+template <typename Message>
+static bool to_message(const data_chunk& payload,
+    const google::protobuf::MessageLite* local, Message& out)
+{
+    if (local != nullptr)
+    {
+        if (!is_type<Message>(*local))
+            return false;
+
+        out = static_cast<Message const&>(*local);
+        return true;
+    }
+
+    return out.ParseFromArray(payload.data(), static_cast<int>(payload.size()));
+}
+
+void requester::populate_cache(const std::string& id,
+    const data_chunk& payload, const google::protobuf::MessageLite* local)
+{
+    auto const type = id.substr(0, id.find('/'));
+
+    if (type == blockchain::fetch_block_header_handler::default_instance()
+        .GetTypeName())
+    {
+        blockchain::fetch_block_header_handler handler;
+        if (to_message(payload, local, handler) && handler.error() == 0 &&
+            handler.has_header())
+            _header_cache->store(handler.height(), handler.header());
+    }
+    else if (type == blockchain::fetch_last_height_handler::default_instance()
+        .GetTypeName())
+    {
+        blockchain::fetch_last_height_handler handler;
+        if (to_message(payload, local, handler) && handler.error() == 0)
+            _header_cache->set_top(handler.height());
+    }
+    else if (type == blockchain::subscribe_reorganize_handler::
+        default_instance().GetTypeName())
+    {
+        blockchain::subscribe_reorganize_handler handler;
+        if (!to_message(payload, local, handler) || handler.error() != 0)
+            return;
+
+        // Entries above the fork point may belong to the replaced branch.
+        auto height = handler.fork_point();
+        _header_cache->reorganize(height);
+        _header_cache->set_top(height + handler.new_blocks_size());
+
+        for (auto const& block: handler.new_blocks())
+            if (block.actual().has_header())
+                _header_cache->store(++height, block.actual().header());
+    }
+}
+
 std::string requester::add_handler(const std::string& message_name,
                                    handler_type handler)
 {
+    if (handler.single && _timeout > 0)
+        handler.expiry = clock::now() + std::chrono::milliseconds(_timeout);
+
     std::lock_guard<std::mutex> lock(_handlers_mutex);
 
     const std::string handler_id =
@@ -231,5 +726,47 @@ std::string requester::add_handler(const std::string& message_name,
     return _subscriber_endpoint + '/' + handler_id;
 }
 
+void requester::remove_handler(const std::string& handler_id)
+{
+    // Handler ids are returned with the subscriber endpoint prefixed.
+    const auto id = handler_id.substr(_subscriber_endpoint.size() + 1);
+
+    std::lock_guard<std::mutex> lock(_handlers_mutex);
+
+    auto handler_iter = std::find_if(_handlers.begin(), _handlers.end(), [&id](handlers_value_t const& x) {
+        return x.first == id;
+    });
+
+    if (handler_iter != _handlers.end())
+        _handlers.erase(handler_iter);
+}
+
+void requester::expire_handlers()
+{
+    auto const now = clock::now();
+    std::vector<std::function<void()>> expired;
+
+    {
+        std::lock_guard<std::mutex> lock(_handlers_mutex);
+
+        for (auto it = _handlers.begin(); it != _handlers.end();)
+        {
+            if (!it->second.single || it->second.expiry > now)
+            {
+                ++it;
+                continue;
+            }
+
+            if (it->second.expire != nullptr)
+                expired.push_back(std::move(it->second.expire));
+
+            it = _handlers.erase(it);
+        }
+    }
+
+    for (auto& expire: expired)
+        _handlers_threadpool.service().dispatch(std::move(expire));
+}
+
 }
 }
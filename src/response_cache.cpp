@@ -0,0 +1,273 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/protocol/response_cache.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/blockchain.pb.h>
+
+namespace libbitcoin {
+namespace protocol {
+
+// Blocks are identified by hash when given, otherwise by height.
+static std::string block_key(blockchain::request::RequestTypeCase type,
+    const std::string& hash, uint64_t height)
+{
+    auto key = std::to_string(type);
+
+    if (hash.empty())
+        return key + 'h' + std::to_string(height);
+
+    return key + 'x' + hash;
+}
+
+response_cache::response_cache(size_t budget_bytes, size_t min_depth)
+  : budget_(budget_bytes),
+    min_depth_(min_depth),
+    top_(0),
+    bytes_(0),
+    hand_(0)
+{
+}
+
+bool response_cache::to_key(const blockchain::request& request,
+    std::string& out)
+{
+    const auto type = request.request_type_case();
+
+    switch (type)
+    {
+        case blockchain::request::kFetchBlock:
+            out = block_key(type, request.fetch_block().hash(),
+                request.fetch_block().height());
+            return true;
+        case blockchain::request::kFetchBlockHeader:
+            out = block_key(type, request.fetch_block_header().hash(),
+                request.fetch_block_header().height());
+            return true;
+        case blockchain::request::kFetchMerkleBlock:
+            out = block_key(type, request.fetch_merkle_block().hash(),
+                request.fetch_merkle_block().height());
+            return true;
+        case blockchain::request::kFetchTransaction:
+        {
+            // Without require_confirmed the reply may be of a pool
+            // transaction, whose height is not a block height and which is
+            // replaced once confirmed, so only confirmed fetches are keyed.
+            const auto& fetch = request.fetch_transaction();
+            if (!fetch.require_confirmed() || fetch.hash().size() != hash_size)
+                return false;
+
+            out = std::to_string(type) + fetch.hash();
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+bool response_cache::cacheable(const blockchain::fetch_block_handler& reply,
+    size_t& out_height)
+{
+    out_height = reply.height();
+    return reply.error() == 0 && reply.has_block();
+}
+
+bool response_cache::cacheable(
+    const blockchain::fetch_block_header_handler& reply, size_t& out_height)
+{
+    out_height = reply.height();
+    return reply.error() == 0 && reply.has_header();
+}
+
+bool response_cache::cacheable(
+    const blockchain::fetch_merkle_block_handler& reply, size_t& out_height)
+{
+    out_height = reply.height();
+    return reply.error() == 0 && reply.has_block();
+}
+
+bool response_cache::cacheable(
+    const blockchain::fetch_transaction_handler& reply, size_t& out_height)
+{
+    out_height = reply.height();
+    return reply.error() == 0 && reply.has_transaction();
+}
+
+void response_cache::set_top(size_t height)
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    top_ = height;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void response_cache::reorganize(size_t fork_point)
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Replies of the new branch are shallow until the top is set again.
+    top_ = std::min(top_, fork_point);
+
+    for (size_t index = 0; index < slots_.size(); ++index)
+        if (slots_[index].value && slots_[index].height > fork_point)
+            evict(index);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+response_cache::payload response_cache::find(const std::string& key)
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const auto it = index_.find(key);
+    if (it == index_.end())
+        return nullptr;
+
+    auto& entry = slots_[it->second];
+    entry.referenced = true;
+    return entry.value;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool response_cache::store(const std::string& key, size_t height,
+    payload value)
+{
+    if (!value)
+        return false;
+
+    slot entry{ key, value, height, false };
+    const auto needed = cost(entry);
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Replies of shallow blocks may yet change, and a reply that alone
+    // exceeds the budget would evict everything for nothing.
+    if (height > top_ || top_ - height < min_depth_ || needed > budget_ ||
+        index_.find(key) != index_.end() || !make_room(needed))
+        return false;
+
+    size_t index;
+    if (free_.empty())
+    {
+        index = slots_.size();
+        slots_.push_back(std::move(entry));
+    }
+    else
+    {
+        index = free_.back();
+        free_.pop_back();
+        slots_[index] = std::move(entry);
+    }
+
+    index_.emplace(key, index);
+    bytes_ += needed;
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void response_cache::clear()
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    slots_.clear();
+    free_.clear();
+    index_.clear();
+    bytes_ = 0;
+    hand_ = 0;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+size_t response_cache::size() const
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return index_.size();
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+size_t response_cache::bytes() const
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return bytes_;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+size_t response_cache::cost(const slot& entry)
+{
+    return entry.value->size() + 2 * entry.key.size() + sizeof(slot);
+}
+
+// Call while holding the mutex.
+void response_cache::evict(size_t index)
+{
+    auto& entry = slots_[index];
+    bytes_ -= cost(entry);
+    index_.erase(entry.key);
+    entry = slot{ {}, nullptr, 0, false };
+    free_.push_back(index);
+}
+
+// Call while holding the mutex.
+// The clock hand clears reference bits and evicts the first unreferenced.
+bool response_cache::make_room(size_t needed)
+{
+    while (bytes_ + needed > budget_)
+    {
+        if (index_.empty())
+            return false;
+
+        if (hand_ >= slots_.size())
+            hand_ = 0;
+
+        auto& entry = slots_[hand_];
+
+        if (entry.value)
+        {
+            if (entry.referenced)
+                entry.referenced = false;
+            else
+                evict(hand_);
+        }
+
+        ++hand_;
+    }
+
+    return true;
+}
+
+} // namespace protocol
+} // namespace libbitcoin
@@ -0,0 +1,126 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/protocol/script_verifier.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/consensus.pb.h>
+
+namespace libbitcoin {
+namespace protocol {
+
+static const uint8_t* to_bytes(const std::string& value)
+{
+    return reinterpret_cast<const uint8_t*>(value.data());
+}
+
+script_verifier::script_verifier(threadpool& pool, verify_function verify)
+  : pool_(pool),
+    verify_(verify)
+{
+}
+
+void script_verifier::verify(request_ptr request, result_handler handler)
+{
+    const auto transactions = static_cast<uint32_t>(
+        request->transactions_size());
+
+    for (const auto& input: request->inputs())
+    {
+        if (input.transaction() >= transactions)
+        {
+            pool_.service().post([handler]()
+            {
+                handler(error::bad_stream, {});
+            });
+
+            return;
+        }
+    }
+
+    const auto count = static_cast<size_t>(request->inputs_size());
+
+    if (count == 0)
+    {
+        pool_.service().post([handler]()
+        {
+            handler(error::success, {});
+        });
+
+        return;
+    }
+
+    const auto threads = std::max(pool_.size(), size_t(1));
+    const auto chunks = std::min(count, threads * chunks_per_thread);
+
+    auto work = std::make_shared<batch>();
+    work->request = request;
+    work->handler = handler;
+    work->verify = verify_;
+    work->results.resize(count);
+    work->remaining = chunks;
+
+    for (size_t chunk = 0; chunk < chunks; ++chunk)
+    {
+        const auto begin = count * chunk / chunks;
+        const auto end = count * (chunk + 1) / chunks;
+
+        pool_.service().post([work, begin, end]()
+        {
+            verify_range(work, begin, end);
+        });
+    }
+}
+
+// The last chunk to finish assembles the reply.
+void script_verifier::verify_range(batch_ptr work, size_t begin, size_t end)
+{
+    const auto& request = *work->request;
+
+    for (auto index = begin; index < end; ++index)
+    {
+        const auto& input = request.inputs(static_cast<int>(index));
+        const auto& transaction = request.transactions(
+            static_cast<int>(input.transaction()));
+        const auto& script = input.prevout_script();
+
+        work->results[index] = work->verify(to_bytes(transaction),
+            transaction.size(), to_bytes(script), script.size(),
+            input.prevout_amount(), input.tx_input_index(), request.flags());
+    }
+
+    if (--work->remaining != 0)
+        return;
+
+    consensus::verify_scripts_reply reply;
+    auto& results = *reply.mutable_results();
+    results.Reserve(static_cast<int>(work->results.size()));
+
+    for (const auto result: work->results)
+        results.Add(result);
+
+    work->handler(error::success, reply);
+}
+
+} // namespace protocol
+} // namespace libbitcoin
@@ -0,0 +1,243 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/protocol/stealth_scanner.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/interface.pb.h>
+
+namespace libbitcoin {
+namespace protocol {
+
+static constexpr uint32_t prefix_bits = 32;
+
+// Filters apply to the little endian bytes of the prefix, most significant
+// bit first (as bc::binary::is_prefix_of), the key reads them in order.
+static uint32_t to_key(uint32_t prefix)
+{
+    return ((prefix & 0x000000ff) << 24) | ((prefix & 0x0000ff00) << 8) |
+        ((prefix & 0x00ff0000) >> 8) | ((prefix & 0xff000000) >> 24);
+}
+
+static void append_row(data_chunk& to, const data_chunk& from,
+    size_t position, size_t width)
+{
+    const auto begin = from.begin() + position * width;
+    to.insert(to.end(), begin, begin + width);
+}
+
+template <typename Column>
+static void append_all(Column& to, const Column& from)
+{
+    to.insert(to.end(), from.begin(), from.end());
+}
+
+size_t stealth_scanner::rows::size() const
+{
+    return transaction_hashes.size() / transaction_hash_size;
+}
+
+void stealth_scanner::rows::clear()
+{
+    prefixes.clear();
+    heights.clear();
+    ephemeral_public_key_hashes.clear();
+    public_key_hashes.clear();
+    transaction_hashes.clear();
+}
+
+void stealth_scanner::rows::append(const rows& other, size_t position)
+{
+    prefixes.push_back(other.prefixes[position]);
+    heights.push_back(other.heights[position]);
+    append_row(ephemeral_public_key_hashes,
+        other.ephemeral_public_key_hashes, position,
+        ephemeral_public_key_hash_size);
+    append_row(public_key_hashes, other.public_key_hashes, position,
+        public_key_hash_size);
+    append_row(transaction_hashes, other.transaction_hashes, position,
+        transaction_hash_size);
+}
+
+bool stealth_scanner::to_filter(uint64_t bits, const std::string& blocks,
+    filter& out)
+{
+    if (blocks.size() != (bits + 7) / 8)
+        return false;
+
+    // A filter longer than the prefix matches nothing (nor would binary).
+    if (bits > prefix_bits)
+    {
+        out = { 0, 1 };
+        return true;
+    }
+
+    uint32_t key = 0;
+    for (size_t index = 0; index < blocks.size(); ++index)
+        key |= uint32_t(static_cast<uint8_t>(blocks[index])) <<
+            (8 * (3 - index));
+
+    out.mask = bits == 0 ? 0 : ~uint32_t(0) << (prefix_bits - bits);
+    out.value = key & out.mask;
+    return true;
+}
+
+// The compare is branch free over the contiguous column, and vectorized.
+void stealth_scanner::match(const filter& filter,
+    const std::vector<uint32_t>& prefixes, std::vector<size_t>& out)
+{
+    const auto count = prefixes.size();
+    std::vector<uint8_t> matches(count);
+
+    for (size_t index = 0; index < count; ++index)
+        matches[index] = (to_key(prefixes[index]) & filter.mask) ==
+            filter.value;
+
+    for (size_t index = 0; index < count; ++index)
+        if (matches[index] != 0)
+            out.push_back(index);
+}
+
+void stealth_scanner::to_columns(const rows& rows,
+    stealth_compact_columns& out)
+{
+    const auto& ephemeral = rows.ephemeral_public_key_hashes;
+    const auto& public_key = rows.public_key_hashes;
+    const auto& transaction = rows.transaction_hashes;
+
+    out.set_ephemeral_public_key_hashes(ephemeral.data(), ephemeral.size());
+    out.set_public_key_hashes(public_key.data(), public_key.size());
+    out.set_transaction_hashes(transaction.data(), transaction.size());
+}
+
+bool stealth_scanner::from_columns(const stealth_compact_columns& columns,
+    rows& out)
+{
+    const auto& ephemeral = columns.ephemeral_public_key_hashes();
+    const auto& public_key = columns.public_key_hashes();
+    const auto& transaction = columns.transaction_hashes();
+    const auto count = transaction.size() / transaction_hash_size;
+
+    if (transaction.size() % transaction_hash_size != 0 ||
+        ephemeral.size() != count * ephemeral_public_key_hash_size ||
+        public_key.size() != count * public_key_hash_size)
+        return false;
+
+    out.clear();
+    out.ephemeral_public_key_hashes.assign(ephemeral.begin(), ephemeral.end());
+    out.public_key_hashes.assign(public_key.begin(), public_key.end());
+    out.transaction_hashes.assign(transaction.begin(), transaction.end());
+    return true;
+}
+
+stealth_scanner::stealth_scanner(threadpool& pool, fetch_function fetch,
+    uint64_t heights_per_range)
+  : pool_(pool),
+    fetch_(fetch),
+    heights_per_range_(std::max(heights_per_range, uint64_t(1)))
+{
+}
+
+void stealth_scanner::scan(const filter& filter, uint64_t from_height,
+    uint64_t to_height, result_handler handler)
+{
+    if (from_height >= to_height)
+    {
+        pool_.service().post([handler]()
+        {
+            handler(error::success, {});
+        });
+
+        return;
+    }
+
+    const auto heights = to_height - from_height;
+    const auto ranges = static_cast<size_t>(
+        (heights + heights_per_range_ - 1) / heights_per_range_);
+
+    auto work = std::make_shared<batch>();
+    work->prefix = filter;
+    work->handler = handler;
+    work->fetch = fetch_;
+    work->results.resize(ranges);
+    work->failed = false;
+    work->remaining = ranges;
+
+    for (size_t range = 0; range < ranges; ++range)
+    {
+        const auto begin = from_height + range * heights_per_range_;
+        const auto end = std::min(begin + heights_per_range_, to_height);
+
+        pool_.service().post([work, range, begin, end]()
+        {
+            scan_range(work, range, begin, end);
+        });
+    }
+}
+
+// The last range to finish merges the results, in height order.
+void stealth_scanner::scan_range(batch_ptr work, size_t range,
+    uint64_t from_height, uint64_t to_height)
+{
+    rows candidates;
+
+    if (!work->failed && work->fetch(from_height, to_height, candidates))
+    {
+        std::vector<size_t> positions;
+        match(work->prefix, candidates.prefixes, positions);
+
+        auto& result = work->results[range];
+        for (const auto position: positions)
+            result.append(candidates, position);
+    }
+    else
+    {
+        work->failed = true;
+    }
+
+    if (--work->remaining != 0)
+        return;
+
+    if (work->failed)
+    {
+        work->handler(error::operation_failed, {});
+        return;
+    }
+
+    rows merged;
+    for (const auto& result: work->results)
+    {
+        append_all(merged.prefixes, result.prefixes);
+        append_all(merged.heights, result.heights);
+        append_all(merged.ephemeral_public_key_hashes,
+            result.ephemeral_public_key_hashes);
+        append_all(merged.public_key_hashes, result.public_key_hashes);
+        append_all(merged.transaction_hashes, result.transaction_hashes);
+    }
+
+    work->handler(error::success, merged);
+}
+
+} // namespace protocol
+} // namespace libbitcoin
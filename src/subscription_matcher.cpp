@@ -0,0 +1,159 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/protocol/subscription_matcher.hpp>
+
+#include <cstdint>
+#include <string>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/blockchain.pb.h>
+#include <bitcoin/protocol/converter.hpp>
+#include <bitcoin/protocol/interface.pb.h>
+
+namespace libbitcoin {
+namespace protocol {
+
+static const uint8_t* to_bytes(const std::string& value)
+{
+    return reinterpret_cast<const uint8_t*>(value.data());
+}
+
+// The payment hash of a pay to key hash or script hash output script,
+// nullptr if neither.
+static const uint8_t* to_payment_hash(const std::string& script)
+{
+    const auto bytes = to_bytes(script);
+
+    if (script.size() == 25 && bytes[0] == 0x76 && bytes[1] == 0xa9 &&
+        bytes[2] == 0x14 && bytes[23] == 0x88 && bytes[24] == 0xac)
+        return bytes + 3;
+
+    if (script.size() == 23 && bytes[0] == 0xa9 && bytes[1] == 0x14 &&
+        bytes[22] == 0x87)
+        return bytes + 2;
+
+    return nullptr;
+}
+
+subscription_matcher::subscription_matcher()
+  : all_(true),
+    headers_only_(false),
+    hash_filters_(false)
+{
+}
+
+bool subscription_matcher::compile(
+    const blockchain::subscription_filter& filter, bool headers_only)
+{
+    for (const auto& query: filter.query())
+        if (!prefixes_.add(query))
+            return false;
+
+    if (!bloom_.set(filter.bloom(), filter.bloom_hash_functions(),
+        filter.bloom_tweak()))
+        return false;
+
+    prefixes_.compile();
+    headers_only_ = headers_only;
+    hash_filters_ = !prefixes_.empty(TRANSACTION) || !bloom_.empty();
+    all_ = prefixes_.empty(ADDRESS) && !hash_filters_;
+    return true;
+}
+
+bool subscription_matcher::match(const tx& transaction) const
+{
+    if (all_)
+        return true;
+
+    if (!prefixes_.empty(ADDRESS))
+    {
+        for (const auto& output: transaction.outputs())
+        {
+            const auto hash = to_payment_hash(output.script());
+            if (hash != nullptr &&
+                prefixes_.match(ADDRESS, { hash, hash + short_hash_size }))
+                return true;
+        }
+    }
+
+    if (!hash_filters_)
+        return false;
+
+    // The hash is computed only when filtered upon.
+    chain::transaction instance;
+    if (!converter{}.from_protocol(&transaction, instance))
+        return false;
+
+    const auto hash = instance.hash();
+    return prefixes_.match(TRANSACTION, hash) ||
+        bloom_.contains(transaction, hash);
+}
+
+bool subscription_matcher::apply(
+    blockchain::subscribe_transaction_handler& event) const
+{
+    return event.error() != 0 || match(event.transaction());
+}
+
+bool subscription_matcher::apply(
+    blockchain::subscribe_reorganize_handler& event) const
+{
+    if (event.error() != 0 || (all_ && !headers_only_))
+        return true;
+
+    for (auto& message: *event.mutable_new_blocks())
+        apply(message);
+
+    for (auto& message: *event.mutable_replaced_blocks())
+        apply(message);
+
+    return true;
+}
+
+void subscription_matcher::apply(
+    blockchain::subscribe_reorganize_handler::block_message& message) const
+{
+    auto& block = *message.mutable_actual();
+
+    if (headers_only_)
+    {
+        block.clear_transactions();
+        block.clear_tree();
+        return;
+    }
+
+    // Matching transactions are moved down in order, without copies.
+    auto& transactions = *block.mutable_transactions();
+    auto kept = 0;
+
+    for (auto index = 0; index < transactions.size(); ++index)
+    {
+        if (!match(transactions.Get(index)))
+            continue;
+
+        if (kept != index)
+            transactions.SwapElements(kept, index);
+
+        ++kept;
+    }
+
+    transactions.DeleteSubrange(kept, transactions.size() - kept);
+}
+
+} // namespace protocol
+} // namespace libbitcoin
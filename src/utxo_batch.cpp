@@ -0,0 +1,207 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/protocol/utxo_batch.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <vector>
+#include <bitcoin/bitcoin.hpp>
+#include <bitcoin/protocol/converter.hpp>
+#include <bitcoin/protocol/database.pb.h>
+
+namespace libbitcoin {
+namespace protocol {
+
+static bool less_point(const chain::output_point& left,
+    const chain::output_point& right)
+{
+    return left.hash() == right.hash() ? left.index() < right.index() :
+        left.hash() < right.hash();
+}
+
+static bool equal_point(const chain::output_point& left,
+    const chain::output_point& right)
+{
+    return left.index() == right.index() && left.hash() == right.hash();
+}
+
+static bool get_bit(const std::string& bitmap, size_t position)
+{
+    return ((bitmap[position / 8] >> (position % 8)) & 1) != 0;
+}
+
+static void set_bit(std::string& bitmap, size_t position)
+{
+    bitmap[position / 8] |= static_cast<char>(1 << (position % 8));
+}
+
+void utxo_batch::to_request(const chain::output_point::list& points,
+    size_t fork_height, bool require_confirmed,
+    database::get_transaction_outputs_request& out)
+{
+    std::string packed;
+    packed.reserve(points.size() * point_size);
+
+    for (const auto& point: points)
+    {
+        const auto index = point.index();
+        packed.append(point.hash().begin(), point.hash().end());
+        packed.push_back(static_cast<char>(index));
+        packed.push_back(static_cast<char>(index >> 8));
+        packed.push_back(static_cast<char>(index >> 16));
+        packed.push_back(static_cast<char>(index >> 24));
+    }
+
+    out.set_points(std::move(packed));
+    out.set_fork_height(fork_height);
+    out.set_require_confirmed(require_confirmed);
+}
+
+bool utxo_batch::to_points(
+    const database::get_transaction_outputs_request& request,
+    chain::output_point::list& out)
+{
+    const auto& packed = request.points();
+    if (packed.size() % point_size != 0)
+        return false;
+
+    out.clear();
+    out.reserve(packed.size() / point_size);
+
+    for (auto it = packed.begin(); it != packed.end(); it += point_size)
+    {
+        hash_digest hash;
+        std::copy(it, it + hash_size, hash.begin());
+
+        const auto bytes = reinterpret_cast<const uint8_t*>(&*it) + hash_size;
+        const uint32_t index = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) |
+            (static_cast<uint32_t>(bytes[3]) << 24);
+
+        out.emplace_back(hash, index);
+    }
+
+    return true;
+}
+
+void utxo_batch::lookup(const database::get_transaction_outputs_request& request,
+    fetch_function fetch, database::get_transaction_outputs_reply& out)
+{
+    out.Clear();
+
+    chain::output_point::list points;
+    if (!to_points(request, points))
+    {
+        out.set_result(false);
+        return;
+    }
+
+    // Visit the points in order so that the store is read sequentially and
+    // repeated points are fetched once.
+    std::vector<size_t> order(points.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::sort(order.begin(), order.end(),
+        [&points](size_t left, size_t right)
+        {
+            return less_point(points[left], points[right]);
+        });
+
+    list results(points.size(), utxo{ false, {}, 0, false });
+    const auto fork_height = static_cast<size_t>(request.fork_height());
+
+    for (size_t position = 0; position < order.size(); ++position)
+    {
+        const auto index = order[position];
+        auto& result = results[index];
+
+        if (position != 0 && equal_point(points[index],
+            points[order[position - 1]]))
+        {
+            result = results[order[position - 1]];
+            continue;
+        }
+
+        result.found = fetch(result.output, result.height, result.coinbase,
+            points[index], fork_height, request.require_confirmed());
+    }
+
+    const auto bitmap_size = (points.size() + 7) / 8;
+    std::string found(bitmap_size, 0);
+    std::string coinbase(bitmap_size, 0);
+    converter converter;
+
+    for (size_t index = 0; index < results.size(); ++index)
+    {
+        const auto& result = results[index];
+        if (!result.found)
+            continue;
+
+        set_bit(found, index);
+
+        if (result.coinbase)
+            set_bit(coinbase, index);
+
+        converter.to_protocol(result.output, *out.add_out_outputs());
+        out.add_out_heights(result.height);
+    }
+
+    out.set_result(true);
+    out.set_found(std::move(found));
+    out.set_out_coinbase(std::move(coinbase));
+}
+
+bool utxo_batch::from_reply(const database::get_transaction_outputs_reply& reply,
+    size_t count, list& out)
+{
+    const auto bitmap_size = (count + 7) / 8;
+    if (!reply.result() || reply.found().size() != bitmap_size ||
+        reply.out_coinbase().size() != bitmap_size ||
+        reply.out_outputs_size() != reply.out_heights_size())
+        return false;
+
+    out.assign(count, utxo{ false, {}, 0, false });
+    converter converter;
+    int found = 0;
+
+    for (size_t index = 0; index < count; ++index)
+    {
+        if (!get_bit(reply.found(), index))
+            continue;
+
+        if (found == reply.out_outputs_size())
+            return false;
+
+        auto& result = out[index];
+        result.found = true;
+        result.coinbase = get_bit(reply.out_coinbase(), index);
+        result.height = static_cast<size_t>(reply.out_heights(found));
+
+        if (!converter.from_protocol(&reply.out_outputs(found), result.output))
+            return false;
+
+        ++found;
+    }
+
+    return found == reply.out_outputs_size();
+}
+
+} // namespace protocol
+} // namespace libbitcoin
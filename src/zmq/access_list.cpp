@@ -0,0 +1,221 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/protocol/zmq/access_list.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/asio/ip/address.hpp>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace protocol {
+namespace zmq {
+
+static constexpr size_t address_bits = 128;
+static constexpr size_t ipv4_offset = 96;
+
+static inline size_t bit(const access_list::address& value, size_t index)
+{
+    return (value[index / 8] >> (7 - index % 8)) & 1;
+}
+
+// Ipv4 mapped addresses are ::ffff:0:0/96.
+static bool is_ipv4_mapped(const access_list::address& value)
+{
+    static const uint8_t mapped[12] =
+    {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff
+    };
+
+    return std::equal(std::begin(mapped), std::end(mapped), value.begin());
+}
+
+bool access_list::parse(const std::string& text, address& out,
+    size_t& prefix_offset)
+{
+    boost::system::error_code ec;
+    const auto ip = boost::asio::ip::address::from_string(text, ec);
+
+    if (ec)
+        return false;
+
+    if (ip.is_v4())
+    {
+        out = boost::asio::ip::address_v6::v4_mapped(ip.to_v4()).to_bytes();
+        prefix_offset = ipv4_offset;
+        return true;
+    }
+
+    out = ip.to_v6().to_bytes();
+    prefix_offset = is_ipv4_mapped(out) ? ipv4_offset : 0;
+    return true;
+}
+
+access_list::access_list()
+  : table_(std::make_shared<const table>(table{ { node{ { 0, 0 },
+        rule::none } }, false }))
+{
+}
+
+bool access_list::allow(const asio::ipv6& ip, size_t prefix_bits)
+{
+    return add({ { ip, prefix_bits, rule::allow } });
+}
+
+bool access_list::deny(const asio::ipv6& ip, size_t prefix_bits)
+{
+    return add({ { ip, prefix_bits, rule::deny } });
+}
+
+bool access_list::add(const range::list& ranges)
+{
+    std::vector<std::pair<address, size_t>> prefixes;
+    prefixes.reserve(ranges.size());
+
+    for (const auto& range: ranges)
+    {
+        address bytes;
+        size_t bits;
+        if (!to_prefix(range.ip, range.prefix_bits, bytes, bits))
+            return false;
+
+        prefixes.emplace_back(bytes, bits);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::lock_guard<std::mutex> lock(write_mutex_);
+
+    // One copy of the table for the whole list.
+    auto rules = std::make_shared<table>(*std::atomic_load(&table_));
+
+    for (size_t index = 0; index < ranges.size(); ++index)
+        insert(*rules, prefixes[index].first, prefixes[index].second,
+            ranges[index].value);
+
+    std::atomic_store(&table_, snapshot(std::move(rules)));
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool access_list::to_prefix(const asio::ipv6& ip, size_t prefix_bits,
+    address& out, size_t& out_bits)
+{
+    out = ip.to_bytes();
+    out_bits = prefix_bits + (is_ipv4_mapped(out) ? ipv4_offset : 0);
+    return out_bits <= address_bits;
+}
+
+void access_list::insert(table& rules, const address& bytes, size_t bits,
+    rule value)
+{
+    auto& nodes = rules.nodes;
+    uint32_t index = 0;
+
+    for (size_t level = 0; level < bits; ++level)
+    {
+        const auto side = bit(bytes, level);
+        auto child = nodes[index].children[side];
+
+        if (child == 0)
+        {
+            child = static_cast<uint32_t>(nodes.size());
+            nodes[index].children[side] = child;
+            nodes.push_back(node{ { 0, 0 }, rule::none });
+        }
+
+        index = child;
+    }
+
+    // Deny takes precedence over allow for the same prefix.
+    nodes[index].value = std::max(nodes[index].value, value);
+    rules.whitelist |= (value == rule::allow);
+}
+
+void access_list::clear()
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::lock_guard<std::mutex> lock(write_mutex_);
+
+    std::atomic_store(&table_, std::make_shared<const table>(table{ {
+        node{ { 0, 0 }, rule::none } }, false }));
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+access_list::rule access_list::match(const table& rules,
+    const address& value)
+{
+    const auto& nodes = rules.nodes;
+    auto result = nodes.front().value;
+    uint32_t index = 0;
+
+    // At most one step per address bit, independent of the rule count.
+    for (size_t level = 0; level < address_bits; ++level)
+    {
+        index = nodes[index].children[bit(value, level)];
+
+        if (index == 0)
+            break;
+
+        if (nodes[index].value != rule::none)
+            result = nodes[index].value;
+    }
+
+    return result;
+}
+
+access_list::rule access_list::match(const address& value) const
+{
+    return match(*std::atomic_load(&table_), value);
+}
+
+bool access_list::allowed(const address& value) const
+{
+    const auto rules = std::atomic_load(&table_);
+
+    switch (match(*rules, value))
+    {
+        case rule::allow:
+            return true;
+        case rule::deny:
+            return false;
+        default:
+            return !rules->whitelist;
+    }
+}
+
+bool access_list::allowed(const std::string& text) const
+{
+    address value;
+    size_t offset;
+
+    if (parse(text, value, offset))
+        return allowed(value);
+
+    return !std::atomic_load(&table_)->whitelist;
+}
+
+} // namespace zmq
+} // namespace protocol
+} // namespace libbitcoin
@@ -18,14 +18,16 @@
  */
 #include <bitcoin/protocol/zmq/authenticator.hpp>
 
+#include <algorithm>
 #include <functional>
 #include <future>
 #include <string>
+#include <thread>
+#include <vector>
 #include <zmq.h>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/protocol/zmq/message.hpp>
 #include <bitcoin/protocol/zmq/context.hpp>
-#include <bitcoin/protocol/zmq/poller.hpp>
 #include <bitcoin/protocol/zmq/socket.hpp>
 #include <bitcoin/protocol/zmq/worker.hpp>
 
@@ -36,11 +38,22 @@ namespace zmq {
 // ZAP endpoint, see: rfc.zeromq.org/spec:27/ZAP
 const config::endpoint authenticator::endpoint("inproc://zeromq.zap.01");
 
+// Workers receive ZAP requests from the router over this endpoint.
+static const config::endpoint workers_endpoint(
+    "inproc://zeromq.zap.01.workers");
+
+// Cached decisions are dropped in bulk when this many accumulate.
+static constexpr size_t decision_cache_limit = 4096;
+
+const size_t authenticator::default_workers = 4;
+
 // There may be only one authenticator per process.
-authenticator::authenticator(threadpool& pool)
+authenticator::authenticator(threadpool& pool, size_t workers)
   : worker(pool),
+    workers_(std::max(workers, size_t(1))),
     context_(false),
-    require_address_(false)
+    require_address_(false),
+    generation_(0)
 {
 }
 
@@ -79,152 +92,226 @@ bool authenticator::stop()
 }
 
 // github.com/zeromq/rfc/blob/master/src/spec_27.c
+// The router relays requests to a pool of workers over an inproc dealer.
 void authenticator::work()
 {
     socket router(context_, zmq::socket::role::router);
+    socket dealer(context_, zmq::socket::role::dealer);
 
-    if (!started(router.bind(endpoint) == error::success))
+    if (!started(router.bind(endpoint) == error::success &&
+        dealer.bind(workers_endpoint) == error::success))
         return;
 
-    poller poller;
-    poller.add(router);
+    std::vector<std::thread> workers;
+    workers.reserve(workers_);
+
+    for (size_t index = 0; index < workers_; ++index)
+        workers.emplace_back(&authenticator::serve, this);
+
+    // Blocks until the context is stopped.
+    relay(router, dealer);
+
+    const auto result = router.stop() && dealer.stop();
+
+    for (auto& worker: workers)
+        worker.join();
+
+    finished(result);
+}
 
-    while (!poller.terminated() && !stopped())
+// Each worker owns a dealer, so the ZAP envelope passes through unchanged.
+void authenticator::serve()
+{
+    socket worker(context_, zmq::socket::role::dealer);
+
+    if (worker.connect(workers_endpoint) != error::success)
+        return;
+
+    message request;
+    message response;
+
+    // Receive fails once the context is stopped.
+    while (request.receive(worker) == error::success)
     {
-        if (!poller.wait().contains(router.id()))
-            continue;
-
-        data_chunk origin;
-        data_chunk delimiter;
-        std::string version;
-        std::string sequence;
-        std::string status_code;
-        std::string status_text;
-        std::string userid;
-        std::string metadata;
-
-        message request;
-        auto ec = router.receive(request);
-
-        if (ec != error::success || request.size() < 8)
-        {
-            status_code = "500";
-            status_text = "Internal error.";
-        }
-        else
+        respond(request, response);
+
+        DEBUG_ONLY(const auto ec =) response.send(worker);
+        BITCOIN_ASSERT_MSG(!ec, "Failed to send ZAP response.");
+    }
+
+    worker.stop();
+}
+
+void authenticator::respond(message& request, message& response)
+{
+    data_chunk origin;
+    data_chunk delimiter;
+    std::string version;
+    std::string sequence;
+    decision result{ "500", "Internal error.", "" };
+
+    if (request.size() >= 8)
+    {
+        origin = request.dequeue_data();
+        delimiter = request.dequeue_data();
+        version = request.dequeue_text();
+        sequence = request.dequeue_text();
+        const auto domain = request.dequeue_text();
+        const auto address = request.dequeue_text();
+        const auto identity = request.dequeue_text();
+        const auto mechanism = request.dequeue_text();
+
+        // ZAP authentication should not occur with an empty domain.
+        if (!origin.empty() && delimiter.empty() && version == "1.0" &&
+            !sequence.empty() && !domain.empty() && identity.empty())
         {
-            origin = request.dequeue_data();
-            delimiter = request.dequeue_data();
-            version = request.dequeue_text();
-            sequence = request.dequeue_text();
-            const auto domain = request.dequeue_text();
-            const auto address = request.dequeue_text();
-            const auto identity = request.dequeue_text();
-            const auto mechanism = request.dequeue_text();
-
-            // ZAP authentication should not occur with an empty domain.
-            if (origin.empty() || !delimiter.empty() || version != "1.0" ||
-                sequence.empty() || domain.empty() || !identity.empty())
-            {
-                status_code = "500";
-                status_text = "Internal error.";
-            }
-            else if (!allowed_address(address))
-            {
-                // Address restrictions are independent of mechanisms.
-                status_code = "400";
-                status_text = "Address not enabled for access.";
-            }
-            else
+            data_stack credentials;
+            while (!request.empty())
+                credentials.push_back(request.dequeue_data());
+
+            // PLAIN credentials are not retained, it is never authorized.
+            const auto cacheable = mechanism == "NULL" ||
+                mechanism == "CURVE";
+
+            std::string key;
+            uint64_t generation = 0;
+
+            if (cacheable)
             {
-                if (mechanism == "NULL")
-                {
-                    if (request.size() != 0)
-                    {
-                        status_code = "400";
-                        status_text = "Incorrect NULL parameterization.";
-                    }
-                    else if (!allowed_weak(domain))
-                    {
-                        status_code = "400";
-                        status_text = "NULL mechanism not authorized.";
-                    }
-                    else
-                    {
-                        // It is more efficient to use an unsecured context or
-                        // to not start the authenticator, but this works too.
-                        status_code = "200";
-                        status_text = "OK";
-                        userid = "anonymous";
-                    }
-                }
-                else if (mechanism == "CURVE")
-                {
-                    if (request.size() != 1)
-                    {
-                        status_code = "400";
-                        status_text = "Incorrect CURVE parameterization.";
-                    }
-                    else
-                    {
-                        hash_digest public_key;
-
-                        if (!request.dequeue(public_key))
-                        {
-                            status_code = "400";
-                            status_text = "Invalid public key.";
-                        }
-                        else if (!allowed_key(public_key))
-                        {
-                            status_code = "400";
-                            status_text = "Public key not authorized.";
-                        }
-                        else
-                        {
-                            status_code = "200";
-                            status_text = "OK";
-                            userid = "unspecified";
-                        }
-                    }
-                }
-                else if (mechanism == "PLAIN")
-                {
-                    if (request.size() != 2)
-                    {
-                        status_code = "400";
-                        status_text = "Incorrect PLAIN parameterization.";
-                    }
-                    else
-                    {
-                        ////userid = request.dequeue_text();
-                        ////const auto password = request.dequeue_text();
-                        status_code = "400";
-                        status_text = "PLAIN mechanism not supported.";
-                    }
-                }
-                else
+                key = address + '\0' + domain + '\0' + mechanism;
+
+                for (const auto& credential: credentials)
                 {
-                    status_code = "400";
-                    status_text = "Security mechanism not supported.";
+                    key += '\0';
+                    key.append(credential.begin(), credential.end());
                 }
             }
+
+            if (!cacheable || !find_decision(key, result, generation))
+            {
+                result = evaluate(domain, address, mechanism, credentials);
+
+                if (cacheable)
+                    store_decision(key, result, generation);
+            }
         }
+    }
 
-        message response;
-        response.enqueue(origin);
-        response.enqueue(delimiter);
-        response.enqueue(version);
-        response.enqueue(sequence);
-        response.enqueue(status_code);
-        response.enqueue(status_text);
-        response.enqueue(userid);
-        response.enqueue(metadata);
-
-        DEBUG_ONLY(ec =) router.send(response);
-        BITCOIN_ASSERT_MSG(!ec, "Failed to send ZAP response.");
+    response.clear();
+    response.enqueue(origin);
+    response.enqueue(delimiter);
+    response.enqueue(version);
+    response.enqueue(sequence);
+    response.enqueue(result.status_code);
+    response.enqueue(result.status_text);
+    response.enqueue(result.userid);
+    response.enqueue();
+}
+
+authenticator::decision authenticator::evaluate(const std::string& domain,
+    const std::string& address, const std::string& mechanism,
+    const data_stack& credentials) const
+{
+    // Address restrictions are independent of mechanisms.
+    if (!allowed_address(address))
+        return { "400", "Address not enabled for access.", "" };
+
+    if (mechanism == "NULL")
+    {
+        if (!credentials.empty())
+            return { "400", "Incorrect NULL parameterization.", "" };
+
+        if (!allowed_weak(domain))
+            return { "400", "NULL mechanism not authorized.", "" };
+
+        // It is more efficient to use an unsecured context or to not start
+        // the authenticator, but this works too.
+        return { "200", "OK", "anonymous" };
+    }
+
+    if (mechanism == "CURVE")
+    {
+        if (credentials.size() != 1)
+            return { "400", "Incorrect CURVE parameterization.", "" };
+
+        const auto& credential = credentials.front();
+
+        if (credential.size() != hash_size)
+            return { "400", "Invalid public key.", "" };
+
+        hash_digest public_key;
+        std::copy(credential.begin(), credential.end(), public_key.begin());
+
+        if (!allowed_key(public_key))
+            return { "400", "Public key not authorized.", "" };
+
+        return { "200", "OK", "unspecified" };
+    }
+
+    if (mechanism == "PLAIN")
+    {
+        if (credentials.size() != 2)
+            return { "400", "Incorrect PLAIN parameterization.", "" };
+
+        return { "400", "PLAIN mechanism not supported.", "" };
     }
 
-    finished(router.stop());
+    return { "400", "Security mechanism not supported.", "" };
+}
+
+// Decision cache.
+//-----------------------------------------------------------------------------
+
+// On a miss returns the generation against which a new decision is stored.
+bool authenticator::find_decision(const std::string& key, decision& out,
+    uint64_t& generation) const
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    shared_lock lock(cache_mutex_);
+
+    const auto it = decisions_.find(key);
+
+    if (it == decisions_.end())
+    {
+        generation = generation_;
+        return false;
+    }
+
+    out = it->second;
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// A decision evaluated across a configuration change is discarded.
+void authenticator::store_decision(const std::string& key,
+    const decision& value, uint64_t generation)
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    unique_lock lock(cache_mutex_);
+
+    if (generation != generation_)
+        return;
+
+    // Bound the cache under address churn, it refills from recent clients.
+    if (decisions_.size() >= decision_cache_limit)
+        decisions_.clear();
+
+    decisions_.emplace(key, value);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// Call after publishing a configuration change.
+void authenticator::invalidate()
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    unique_lock lock(cache_mutex_);
+
+    ++generation_;
+    decisions_.clear();
+    ///////////////////////////////////////////////////////////////////////////
 }
 
 // This must be called on the socket thread.
@@ -237,7 +324,7 @@ bool authenticator::apply(socket& socket, const std::string& domain,
     // Critical Section
     mutex_.lock_shared();
     const auto private_key = private_key_;
-    const auto have_public_keys = !keys_.empty();
+    const auto have_public_keys = keys_.configured();
     const auto require_address = require_address_;
     mutex_.unlock_shared();
     ///////////////////////////////////////////////////////////////////////////
@@ -250,8 +337,17 @@ bool authenticator::apply(socket& socket, const std::string& domain,
     {
         if (require_address)
         {
+            ///////////////////////////////////////////////////////////////////
+            // Critical Section
+            mutex_.lock();
+
             // These persist after a socket closes so don't reuse domain names.
             weak_domains_.emplace(domain);
+            invalidate();
+
+            mutex_.unlock();
+            ///////////////////////////////////////////////////////////////////
+
             return socket.set_authentication_domain(domain);
         }
 
@@ -281,24 +377,17 @@ void authenticator::set_private_key(const config::sodium& private_key)
     ///////////////////////////////////////////////////////////////////////////
 }
 
+// Lock free, rules are matched against an immutable snapshot.
 bool authenticator::allowed_address(const std::string& ip_address) const
 {
-    ///////////////////////////////////////////////////////////////////////////
-    // Critical Section
-    shared_lock lock(mutex_);
-
-    return !require_address_ || adresses_.find(ip_address) != adresses_.end();
-    ///////////////////////////////////////////////////////////////////////////
+    return addresses_.allowed(ip_address);
 }
 
+// Lock free, keys are searched in an immutable snapshot.
+// Once keys are configured an empty store denies all keys.
 bool authenticator::allowed_key(const hash_digest& public_key) const
 {
-    ///////////////////////////////////////////////////////////////////////////
-    // Critical Section
-    shared_lock lock(mutex_);
-
-    return keys_.empty() || keys_.find(public_key) != keys_.end();
-    ///////////////////////////////////////////////////////////////////////////
+    return !keys_.configured() || keys_.contains(public_key);
 }
 
 bool authenticator::allowed_weak(const std::string& domain) const
@@ -311,35 +400,84 @@ bool authenticator::allowed_weak(const std::string& domain) const
     ///////////////////////////////////////////////////////////////////////////
 }
 
+// Key updates do not block ZAP lookups, cached decisions are invalidated
+// after the updated keys are published.
 void authenticator::allow(const hash_digest& public_key)
+{
+    keys_.add(public_key);
+    invalidate();
+}
+
+void authenticator::revoke(const hash_digest& public_key)
+{
+    keys_.revoke(public_key);
+    invalidate();
+}
+
+// A failed load still configures the keys, so invalidate either way.
+bool authenticator::load_keys(const std::string& path)
+{
+    const auto loaded = keys_.load(path);
+    invalidate();
+    return loaded;
+}
+
+void authenticator::allow(const config::authority& address)
+{
+    allow(address, address.ip().is_v4_mapped() ? 32 : 128);
+}
+
+void authenticator::deny(const config::authority& address)
+{
+    deny(address, address.ip().is_v4_mapped() ? 32 : 128);
+}
+
+bool authenticator::allow(const config::authority& address,
+    size_t prefix_bits)
 {
     ///////////////////////////////////////////////////////////////////////////
     // Critical Section
     unique_lock lock(mutex_);
 
-    keys_.emplace(public_key);
+    if (!addresses_.allow(address.ip(), prefix_bits))
+        return false;
+
+    require_address_ = true;
+    invalidate();
+    return true;
     ///////////////////////////////////////////////////////////////////////////
 }
 
-void authenticator::allow(const config::authority& address)
+bool authenticator::deny(const config::authority& address,
+    size_t prefix_bits)
 {
     ///////////////////////////////////////////////////////////////////////////
     // Critical Section
     unique_lock lock(mutex_);
 
+    // Denial is effective independent of whitelisting, so it also requires
+    // that addresses are checked.
+    if (!addresses_.deny(address.ip(), prefix_bits))
+        return false;
+
     require_address_ = true;
-    adresses_.emplace(address.to_hostname(), true);
+    invalidate();
+    return true;
     ///////////////////////////////////////////////////////////////////////////
 }
 
-void authenticator::deny(const config::authority& address)
+bool authenticator::add(const access_list::range::list& ranges)
 {
     ///////////////////////////////////////////////////////////////////////////
     // Critical Section
     unique_lock lock(mutex_);
 
-    // Denial is effective independent of whitelisting.
-    adresses_.emplace(address.to_hostname(), false);
+    if (!addresses_.add(ranges))
+        return false;
+
+    require_address_ |= !ranges.empty();
+    invalidate();
+    return true;
     ///////////////////////////////////////////////////////////////////////////
 }
 
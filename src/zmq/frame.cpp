@@ -21,6 +21,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <utility>
 #include <zmq.h>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/protocol/zmq/socket.hpp>
@@ -35,6 +36,16 @@ namespace zmq {
 static auto constexpr wait_flag = 0;
 static constexpr auto zmq_fail = -1;
 
+// Payloads of at least this size are sent from the caller's buffer, which
+// avoids a copy of large (e.g. block) payloads on the inproc and ipc paths.
+static constexpr size_t zero_copy_threshold = 4096;
+
+// Invoked by zeromq once the payload is no longer referenced.
+static void free_chunk(void*, void* hint)
+{
+    delete static_cast<data_chunk*>(hint);
+}
+
 // Use for receiving.
 frame::frame()
   : more_(false), valid_(initialize(message_, {}))
@@ -47,6 +58,18 @@ frame::frame(const data_chunk& data)
 {
 }
 
+// Use for sending without copying the payload.
+frame::frame(data_chunk&& data)
+  : more_(false), valid_(initialize(message_, std::move(data)))
+{
+}
+
+// Use for sending a buffer released by the caller's function.
+frame::frame(void* buffer, size_t size, release_function release, void* hint)
+  : more_(false), valid_(initialize(message_, buffer, size, release, hint))
+{
+}
+
 frame::~frame()
 {
     destroy();
@@ -67,6 +90,34 @@ bool frame::initialize(zmq_msg& message, const data_chunk& data)
     return true;
 }
 
+// static
+bool frame::initialize(zmq_msg& message, data_chunk&& data)
+{
+    if (data.size() < zero_copy_threshold)
+        return initialize(message, data);
+
+    const auto buffer = reinterpret_cast<zmq_msg_t*>(&message);
+    const auto chunk = new data_chunk(std::move(data));
+
+    if (zmq_msg_init_data(buffer, chunk->data(), chunk->size(), free_chunk,
+        chunk) == zmq_fail)
+    {
+        delete chunk;
+        return false;
+    }
+
+    return true;
+}
+
+// static
+bool frame::initialize(zmq_msg& message, void* buffer, size_t size,
+    release_function release, void* hint)
+{
+    const auto pointer = reinterpret_cast<zmq_msg_t*>(&message);
+    return zmq_msg_init_data(pointer, buffer, size, release, hint) !=
+        zmq_fail;
+}
+
 frame::operator const bool() const
 {
     return valid_;
@@ -99,6 +150,12 @@ data_chunk frame::payload()
     return{ begin, begin + size };
 }
 
+const void* frame::address()
+{
+    const auto buffer = reinterpret_cast<zmq_msg_t*>(&message_);
+    return zmq_msg_data(buffer);
+}
+
 // Must be called on the socket thread.
 code frame::receive(socket& socket)
 {
@@ -112,12 +169,13 @@ code frame::receive(socket& socket)
 }
 
 // Must be called on the socket thread.
-code frame::send(socket& socket, bool last)
+code frame::send(socket& socket, bool last, bool wait)
 {
     if (!valid_)
         return error::operation_failed;
 
-    const int flags = (last ? 0 : ZMQ_SNDMORE) | wait_flag;
+    const int flags = (last ? 0 : ZMQ_SNDMORE) |
+        (wait ? wait_flag : ZMQ_DONTWAIT);
     const auto buffer = reinterpret_cast<zmq_msg_t*>(&message_);
     const auto result = zmq_sendmsg(socket.self(), buffer, flags) != zmq_fail;
     return result ? error::success : get_last_error();
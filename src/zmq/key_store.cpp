@@ -0,0 +1,301 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <bitcoin/protocol/zmq/key_store.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <bitcoin/bitcoin.hpp>
+
+namespace libbitcoin {
+namespace protocol {
+namespace zmq {
+
+using namespace boost::interprocess;
+
+// Deltas are merged into the base once they exceed this many keys.
+static constexpr size_t compaction_threshold = 4096;
+
+struct mapping
+{
+    file_mapping file;
+    mapped_region region;
+};
+
+// Keys compare as byte strings, matching the file order.
+static bool search(const hash_list& keys, const hash_digest& key)
+{
+    return std::binary_search(keys.begin(), keys.end(), key);
+}
+
+static void insert(hash_list& keys, const hash_digest& key)
+{
+    keys.insert(std::lower_bound(keys.begin(), keys.end(), key), key);
+}
+
+static void erase(hash_list& keys, const hash_digest& key)
+{
+    const auto it = std::lower_bound(keys.begin(), keys.end(), key);
+    if (it != keys.end() && *it == key)
+        keys.erase(it);
+}
+
+key_store::key_store()
+  : table_(std::make_shared<const table>(table{ nullptr, 0, nullptr, {}, {},
+        0, false }))
+{
+}
+
+// A failed load leaves the store configured, so an unreadable key file
+// denies all keys rather than allowing all of them.
+bool key_store::load(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        configure();
+        return false;
+    }
+
+    // An empty file cannot be mapped, it configures an empty store.
+    if (file.tellg() == 0)
+    {
+        ///////////////////////////////////////////////////////////////////////
+        // Critical Section
+        std::lock_guard<std::mutex> lock(write_mutex_);
+
+        publish(std::make_shared<table>(table{ nullptr, 0, nullptr, {}, {},
+            0, true }));
+        return true;
+        ///////////////////////////////////////////////////////////////////////
+    }
+
+    file.close();
+    std::shared_ptr<mapping> mapped;
+
+    try
+    {
+        mapped = std::make_shared<mapping>();
+        mapped->file = file_mapping(path.c_str(), read_only);
+        mapped->region = mapped_region(mapped->file, read_only);
+    }
+    catch (const interprocess_exception&)
+    {
+        configure();
+        return false;
+    }
+
+    const auto bytes = mapped->region.get_size();
+    if (bytes % hash_size != 0)
+    {
+        configure();
+        return false;
+    }
+
+    const auto keys = static_cast<const hash_digest*>(
+        mapped->region.get_address());
+    const auto count = bytes / hash_size;
+
+    // Strictly ascending order is required for search and for size.
+    for (size_t index = 1; index < count; ++index)
+    {
+        if (!(keys[index - 1] < keys[index]))
+        {
+            configure();
+            return false;
+        }
+    }
+
+    mapped->region.advise(mapped_region::advice_willneed);
+
+    auto loaded = std::make_shared<table>(table{ keys, count, mapped, {}, {},
+        count, true });
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::lock_guard<std::mutex> lock(write_mutex_);
+
+    publish(loaded);
+    return true;
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+bool key_store::save(const std::string& path, hash_list keys)
+{
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        return false;
+
+    file.write(reinterpret_cast<const char*>(keys.data()),
+        keys.size() * hash_size);
+
+    return static_cast<bool>(file.flush());
+}
+
+void key_store::add(const hash_digest& key)
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::lock_guard<std::mutex> lock(write_mutex_);
+
+    const auto current = std::atomic_load(&table_);
+    if (current->configured && contains(*current, key))
+        return;
+
+    auto keys = std::make_shared<table>(*current);
+    keys->configured = true;
+
+    if (contains(*current, key))
+    {
+        publish(keys);
+        return;
+    }
+
+    if (search(keys->revoked, key))
+        erase(keys->revoked, key);
+    else
+        insert(keys->added, key);
+
+    ++keys->size;
+    publish(keys);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void key_store::revoke(const hash_digest& key)
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::lock_guard<std::mutex> lock(write_mutex_);
+
+    const auto current = std::atomic_load(&table_);
+    if (!contains(*current, key))
+        return;
+
+    auto keys = std::make_shared<table>(*current);
+
+    if (search(keys->added, key))
+        erase(keys->added, key);
+    else
+        insert(keys->revoked, key);
+
+    --keys->size;
+    publish(keys);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void key_store::clear()
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::lock_guard<std::mutex> lock(write_mutex_);
+
+    publish(std::make_shared<table>(table{ nullptr, 0, nullptr, {}, {}, 0,
+        false }));
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+void key_store::configure()
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Critical Section
+    std::lock_guard<std::mutex> lock(write_mutex_);
+
+    const auto current = std::atomic_load(&table_);
+    if (current->configured)
+        return;
+
+    auto keys = std::make_shared<table>(*current);
+    keys->configured = true;
+    publish(keys);
+    ///////////////////////////////////////////////////////////////////////////
+}
+
+// Call while holding the write mutex.
+void key_store::publish(std::shared_ptr<table> keys)
+{
+    if (keys->added.size() + keys->revoked.size() > compaction_threshold)
+        compact(*keys);
+
+    std::atomic_store(&table_, snapshot(std::move(keys)));
+}
+
+// Merge the deltas into a new owned base.
+void key_store::compact(table& keys)
+{
+    auto merged = std::make_shared<hash_list>();
+    merged->reserve(keys.size);
+
+    const auto begin = keys.base;
+    const auto end = keys.base + keys.base_size;
+    std::set_union(begin, end, keys.added.begin(), keys.added.end(),
+        std::back_inserter(*merged));
+
+    merged->erase(std::remove_if(merged->begin(), merged->end(),
+        [&keys](const hash_digest& key)
+        {
+            return search(keys.revoked, key);
+        }), merged->end());
+
+    keys.base = merged->data();
+    keys.base_size = merged->size();
+    keys.owner = merged;
+    keys.added.clear();
+    keys.revoked.clear();
+}
+
+bool key_store::contains(const table& keys, const hash_digest& key)
+{
+    if (search(keys.revoked, key))
+        return false;
+
+    return search(keys.added, key) ||
+        std::binary_search(keys.base, keys.base + keys.base_size, key);
+}
+
+bool key_store::contains(const hash_digest& key) const
+{
+    return contains(*std::atomic_load(&table_), key);
+}
+
+size_t key_store::size() const
+{
+    return std::atomic_load(&table_)->size;
+}
+
+bool key_store::empty() const
+{
+    return size() == 0;
+}
+
+bool key_store::configured() const
+{
+    return std::atomic_load(&table_)->configured;
+}
+
+} // namespace zmq
+} // namespace protocol
+} // namespace libbitcoin
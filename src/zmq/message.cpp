@@ -18,8 +18,12 @@
  */
 #include <bitcoin/protocol/zmq/message.hpp>
 
+#include <atomic>
+#include <cstring>
+#include <memory>
 #include <string>
 #include <utility>
+#include <google/protobuf/message.h>
 #include <google/protobuf/message_lite.h>
 #include <bitcoin/bitcoin.hpp>
 #include <bitcoin/protocol/zmq/frame.hpp>
@@ -28,6 +32,119 @@ namespace libbitcoin {
 namespace protocol {
 namespace zmq {
 
+// A serialized protobuf message never starts with a zero byte (field number
+// zero is invalid), so a leading zero marks a process-local message part.
+// The part is the marker, the kind, the message address and, for an owned
+// message once sent, the address of its handoff.
+static constexpr uint8_t local_marker = 0x00;
+static constexpr uint8_t local_reference = 0x00;
+static constexpr uint8_t local_ownership = 0x01;
+static constexpr size_t value_offset = 2;
+static constexpr size_t handoff_offset = value_offset + sizeof(uintptr_t);
+static constexpr size_t local_size = handoff_offset + sizeof(uintptr_t);
+
+static bool is_local_part(const data_chunk& part)
+{
+    return part.size() == local_size && part[0] == local_marker;
+}
+
+static bool is_ownership_part(const data_chunk& part)
+{
+    return is_local_part(part) && part[1] == local_ownership;
+}
+
+static uintptr_t read_address(const data_chunk& part, size_t offset)
+{
+    uintptr_t address;
+    std::memcpy(&address, part.data() + offset, sizeof(address));
+    return address;
+}
+
+static void write_address(uint8_t* part, size_t offset, const void* value)
+{
+    const auto address = reinterpret_cast<uintptr_t>(value);
+    std::memcpy(part + offset, &address, sizeof(address));
+}
+
+static data_chunk to_local_part(const google::protobuf::MessageLite* value,
+    uint8_t kind)
+{
+    data_chunk part(local_size, 0);
+    part[0] = local_marker;
+    part[1] = kind;
+    write_address(part.data(), value_offset, value);
+    return part;
+}
+
+// An owned message is sent from a handoff, the buffer of which zeromq
+// references until the part is discarded. The receiver claims the message
+// before that, otherwise it is deleted with the handoff (e.g. when the peer
+// is gone or the socket closed), so it is never leaked.
+struct local_handoff
+{
+    // The part is first, so that its address is that of the handoff.
+    uint8_t part[local_size];
+    google::protobuf::MessageLite* value;
+    std::atomic<bool> release;
+};
+
+static void release_handoff(void*, void* hint)
+{
+    const auto handoff = static_cast<local_handoff*>(hint);
+
+    if (handoff->release)
+        delete handoff->value;
+
+    delete handoff;
+}
+
+static code send_part(socket& socket, data_chunk&& part, bool last,
+    bool wait)
+{
+    if (!is_ownership_part(part))
+    {
+        frame frame(std::move(part));
+        return frame.send(socket, last, wait);
+    }
+
+    const auto handoff = new local_handoff;
+    std::memcpy(handoff->part, part.data(), local_size);
+    write_address(handoff->part, handoff_offset, handoff);
+    handoff->value = reinterpret_cast<google::protobuf::MessageLite*>(
+        read_address(part, value_offset));
+    handoff->release = false;
+
+    frame frame(handoff->part, local_size, release_handoff, handoff);
+    if (!frame)
+    {
+        delete handoff;
+        return error::operation_failed;
+    }
+
+    // If the send fails the message remains with the sender.
+    handoff->release = true;
+    const auto ec = frame.send(socket, last, wait);
+    if (ec)
+        handoff->release = false;
+
+    return ec;
+}
+
+// The handoff address is trusted only if zeromq delivered the handoff's own
+// buffer, as it does over inproc, so a remote peer cannot forge it.
+static void claim_part(frame& frame, const data_chunk& part)
+{
+    if (!is_ownership_part(part))
+        return;
+
+    const auto address = read_address(part, handoff_offset);
+    if (address == 0 || reinterpret_cast<uintptr_t>(frame.address()) !=
+        address)
+        return;
+
+    reinterpret_cast<local_handoff*>(address)->release = false;
+}
+
 void message::enqueue()
 {
     queue_.emplace(data_chunk{});
@@ -43,6 +160,37 @@ bool message::enqueue_protobuf_message(const google::protobuf::MessageLite& valu
     return true;
 }
 
+void message::enqueue_protobuf_reference(
+    const google::protobuf::MessageLite& value)
+{
+    queue_.emplace(to_local_part(&value, local_reference));
+}
+
+void message::enqueue_protobuf_ownership(
+    std::unique_ptr<google::protobuf::MessageLite> value)
+{
+    queue_.emplace(to_local_part(value.release(), local_ownership));
+}
+
+// static
+std::shared_ptr<const google::protobuf::MessageLite>
+    message::to_protobuf_reference(const data_chunk& part)
+{
+    typedef google::protobuf::MessageLite protobuf;
+
+    if (!is_local_part(part))
+        return{};
+
+    const auto value = reinterpret_cast<const protobuf*>(
+        read_address(part, value_offset));
+
+    if (part[1] == local_ownership)
+        return std::shared_ptr<const protobuf>(value);
+
+    // A reference is borrowed from the sender, so it is not deleted here.
+    return std::shared_ptr<const protobuf>(value, [](const protobuf*) {});
+}
+
 bool message::dequeue()
 {
     if (queue_.empty())
@@ -123,6 +271,38 @@ bool message::dequeue(google::protobuf::MessageLite& value)
     return true;
 }
 
+bool message::dequeue_local(google::protobuf::MessageLite& value)
+{
+    if (queue_.empty())
+        return false;
+
+    const auto local = to_protobuf_reference(queue_.front());
+
+    if (!local)
+        return dequeue(value);
+
+    const auto owned = is_ownership_part(queue_.front());
+    queue_.pop();
+
+    if (local->GetTypeName() != value.GetTypeName())
+        return false;
+
+    // An owned message is swapped in, a borrowed one must be copied.
+    const auto target = dynamic_cast<google::protobuf::Message*>(&value);
+    const auto source = dynamic_cast<google::protobuf::Message*>(
+        const_cast<google::protobuf::MessageLite*>(local.get()));
+
+    if (owned && target != nullptr && source != nullptr)
+    {
+        target->GetReflection()->Swap(target, source);
+        return true;
+    }
+
+    value.Clear();
+    value.CheckTypeAndMergeFrom(*local);
+    return true;
+}
+
 data_chunk message::dequeue_data()
 {
     if (queue_.empty())
@@ -144,6 +324,12 @@ std::string message::dequeue_text()
     return text;
 }
 
+const data_chunk& message::peek() const
+{
+    static const data_chunk empty_part;
+    return queue_.empty() ? empty_part : queue_.front();
+}
+
 void message::clear()
 {
     while (!queue_.empty())
@@ -167,9 +353,10 @@ code message::send(socket& socket)
 
     while (!queue_.empty())
     {
-        frame frame(queue_.front());
+        auto part = std::move(queue_.front());
         queue_.pop();
-        const auto ec = frame.send(socket, --count == 0);
+        const auto ec = send_part(socket, std::move(part), --count == 0,
+            true);
 
         if (ec)
             return ec;
@@ -178,6 +365,25 @@ code message::send(socket& socket)
     return error::success;
 }
 
+// Must be called on the socket thread.
+code message::try_send(socket& socket)
+{
+    if (queue_.empty())
+        return error::success;
+
+    // Once the first part is accepted zeromq accepts the others, so only the
+    // first is copied in order to be retained if the send would block.
+    auto count = queue_.size();
+    auto ec = send_part(socket, data_chunk(queue_.front()), --count == 0,
+        false);
+
+    if (ec)
+        return ec;
+
+    queue_.pop();
+    return send(socket);
+}
+
 // Must be called on the socket thread.
 code message::receive(socket& socket)
 {
@@ -193,6 +399,7 @@ code message::receive(socket& socket)
             return ec;
 
         queue_.emplace(frame.payload());
+        claim_part(frame, queue_.back());
         done = !frame.more();
     }
 
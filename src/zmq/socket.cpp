@@ -150,6 +150,16 @@ code socket::bind(const config::endpoint& address)
 // Bind for bitprim-mining
 code socket::bind_ephemeral(const std::string& address)
 {
+    // Ipc (wildcard) and inproc names are bound as given, no port applies.
+    if (address.compare(0, 6, "ipc://") == 0 ||
+        address.compare(0, 9, "inproc://") == 0)
+    {
+        if (zmq_bind(self_, address.c_str()) == zmq_fail)
+            return get_last_error();
+
+        return error::success;
+    }
+
     config::endpoint endpoint (address);
     std::string addr = endpoint.to_string();
     if (endpoint.port() == 0)
@@ -168,6 +178,15 @@ code socket::connect(const config::endpoint& address)
     return error::success;
 }
 
+// This must be called on the socket thread.
+code socket::connect_address(const std::string& address)
+{
+    if (zmq_connect(self_, address.c_str()) == zmq_fail)
+        return get_last_error();
+
+    return error::success;
+}
+
 /// This must be called on the socket thread.
 bool socket::get_last_endpoint(std::string& endpoint) const
 {
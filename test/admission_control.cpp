@@ -0,0 +1,173 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <chrono>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/protocol.hpp>
+
+using namespace bc;
+using namespace bc::protocol;
+
+typedef std::chrono::milliseconds ms;
+
+static const auto start =
+    admission_control::clock::time_point() + std::chrono::hours(1);
+
+BOOST_AUTO_TEST_SUITE(admission_control_tests)
+
+BOOST_AUTO_TEST_CASE(admission_control__to_class__blockchain_request__request_type)
+{
+    blockchain::request request;
+    request.mutable_fetch_block()->set_height(42);
+    BOOST_REQUIRE_EQUAL(admission_control::to_class(request),
+        blockchain::request::kFetchBlock);
+
+    protocol::request other;
+    BOOST_REQUIRE_EQUAL(admission_control::to_class(other), 0);
+}
+
+BOOST_AUTO_TEST_CASE(admission_control__sent_time__queued__wait_included)
+{
+    const auto wall = std::chrono::system_clock::now();
+    blockchain::request request;
+    request.set_sent(admission_control::to_sent(wall - ms(40)));
+
+    const auto sent = admission_control::sent_time(request, start, wall);
+    BOOST_REQUIRE(sent == start - ms(40));
+}
+
+BOOST_AUTO_TEST_CASE(admission_control__sent_time__unknown_or_ahead__now)
+{
+    const auto wall = std::chrono::system_clock::now();
+    blockchain::request request;
+    BOOST_REQUIRE(admission_control::sent_time(request, start, wall) == start);
+
+    request.set_sent(admission_control::to_sent(wall + ms(40)));
+    BOOST_REQUIRE(admission_control::sent_time(request, start, wall) == start);
+
+    protocol::request other;
+    BOOST_REQUIRE(admission_control::sent_time(other, start, wall) == start);
+}
+
+BOOST_AUTO_TEST_CASE(admission_control__sent_time__lagging_clock__bounded)
+{
+    const auto wall = std::chrono::system_clock::now();
+    blockchain::request request;
+    request.set_sent(admission_control::to_sent(wall - std::chrono::hours(1)));
+
+    const auto sent = admission_control::sent_time(request, start, wall);
+    BOOST_REQUIRE(sent ==
+        start - ms(admission_control::maximum_wait_milliseconds));
+}
+
+BOOST_AUTO_TEST_CASE(admission_control__is_status_reply__throttled__true)
+{
+    protocol::response status;
+    status.set_status(error::peer_throttling);
+
+    zmq::message reply;
+    reply.enqueue(admission_control::status_frame());
+    BOOST_REQUIRE(reply.enqueue_protobuf_message(status));
+    BOOST_REQUIRE(admission_control::is_status_reply(reply));
+
+    protocol::response result;
+    BOOST_REQUIRE(reply.dequeue());
+    BOOST_REQUIRE(reply.dequeue(result));
+    BOOST_REQUIRE_EQUAL(result.status(), error::peer_throttling);
+}
+
+BOOST_AUTO_TEST_CASE(admission_control__is_status_reply__two_part_reply__false)
+{
+    // A default reply serializes empty, as the first part of a status reply
+    // once did.
+    protocol::response empty;
+    zmq::message reply;
+    BOOST_REQUIRE(reply.enqueue_protobuf_message(empty));
+    reply.enqueue(std::string("second"));
+    BOOST_REQUIRE(!admission_control::is_status_reply(reply));
+
+    protocol::response served;
+    served.set_id(42);
+    zmq::message other;
+    BOOST_REQUIRE(other.enqueue_protobuf_message(served));
+    other.enqueue(std::string("second"));
+    BOOST_REQUIRE(!admission_control::is_status_reply(other));
+
+    zmq::message local;
+    local.enqueue_protobuf_reference(served);
+    local.enqueue(std::string("second"));
+    BOOST_REQUIRE(!admission_control::is_status_reply(local));
+}
+
+BOOST_AUTO_TEST_CASE(admission_control__admit__below_target__admitted)
+{
+    admission_control admission(5, 100);
+
+    for (auto step = 0; step < 100; ++step)
+    {
+        const auto now = start + ms(10 * step);
+        admission.record(1, ms(4), now);
+        BOOST_REQUIRE(admission.admit(1, now));
+    }
+
+    const auto stats = admission.stats(1);
+    BOOST_REQUIRE_EQUAL(stats.admitted, 100u);
+    BOOST_REQUIRE_EQUAL(stats.shed, 0u);
+    BOOST_REQUIRE(!stats.shedding);
+}
+
+BOOST_AUTO_TEST_CASE(admission_control__admit__above_target_for_interval__shed)
+{
+    admission_control admission(5, 100);
+
+    // Above target for less than the interval.
+    admission.record(1, ms(50), start);
+    admission.record(1, ms(50), start + ms(99));
+    BOOST_REQUIRE(admission.admit(1, start + ms(99)));
+
+    admission.record(1, ms(50), start + ms(100));
+    BOOST_REQUIRE(admission.stats(1).shedding);
+    BOOST_REQUIRE(!admission.admit(1, start + ms(100)));
+
+    // The next is shed an interval later, the one after sooner.
+    BOOST_REQUIRE(admission.admit(1, start + ms(199)));
+    BOOST_REQUIRE(!admission.admit(1, start + ms(200)));
+    BOOST_REQUIRE(admission.admit(1, start + ms(270)));
+    BOOST_REQUIRE(!admission.admit(1, start + ms(271)));
+
+    // Other classes are unaffected.
+    BOOST_REQUIRE(admission.admit(2, start + ms(300)));
+    BOOST_REQUIRE_EQUAL(admission.stats(1).shed, 3u);
+}
+
+BOOST_AUTO_TEST_CASE(admission_control__record__below_target__stops_shedding)
+{
+    admission_control admission(5, 100);
+    admission.record(1, ms(50), start);
+    admission.record(1, ms(50), start + ms(100));
+    BOOST_REQUIRE(!admission.admit(1, start + ms(100)));
+
+    admission.record(1, ms(1), start + ms(150));
+    BOOST_REQUIRE(!admission.stats(1).shedding);
+
+    for (auto step = 0; step < 10; ++step)
+        BOOST_REQUIRE(admission.admit(1, start + ms(200 + 100 * step)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
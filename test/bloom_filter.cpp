@@ -0,0 +1,125 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <string>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/protocol.hpp>
+
+using namespace bc;
+using namespace bc::protocol;
+
+static uint32_t murmur3(uint32_t seed, const std::string& data)
+{
+    const auto bytes = reinterpret_cast<const uint8_t*>(data.data());
+    return bloom_filter::murmur3(seed, { bytes, bytes + data.size() });
+}
+
+// A filter of the elements, which then contains all of them.
+static bloom_filter make_filter(const std::string& element)
+{
+    bloom_filter filter;
+    std::string data(64, 0);
+    BOOST_REQUIRE(filter.set(data, 5, 7));
+
+    const auto bytes = reinterpret_cast<const uint8_t*>(element.data());
+    for (uint32_t function = 0; function < 5; ++function)
+    {
+        const auto bit = bloom_filter::murmur3(function * 0xfba4c795 + 7,
+            { bytes, bytes + element.size() }) % (data.size() * 8);
+        data[bit / 8] |= static_cast<char>(1 << (bit % 8));
+    }
+
+    BOOST_REQUIRE(filter.set(data, 5, 7));
+    return filter;
+}
+
+BOOST_AUTO_TEST_SUITE(bloom_filter_tests)
+
+BOOST_AUTO_TEST_CASE(bloom_filter__murmur3__reference_vectors__expected)
+{
+    BOOST_REQUIRE_EQUAL(murmur3(0x00000000, ""), 0x00000000u);
+    BOOST_REQUIRE_EQUAL(murmur3(0xfba4c795, ""), 0x6a396f08u);
+    BOOST_REQUIRE_EQUAL(murmur3(0xffffffff, ""), 0x81f16f39u);
+    BOOST_REQUIRE_EQUAL(murmur3(0x00000000, std::string(1, 0)), 0x514e28b7u);
+    BOOST_REQUIRE_EQUAL(murmur3(0xfba4c795, std::string(1, 0)), 0xea3f0b17u);
+    BOOST_REQUIRE_EQUAL(murmur3(0x00000000, "\xff"), 0xfd6cf10du);
+    BOOST_REQUIRE_EQUAL(murmur3(0x00000000, std::string("\x00\x11", 2)),
+        0x16c6b7abu);
+    BOOST_REQUIRE_EQUAL(murmur3(0x00000000, std::string("\x00\x11\x22", 3)),
+        0x8eb51c3du);
+    BOOST_REQUIRE_EQUAL(murmur3(0x00000000,
+        std::string("\x00\x11\x22\x33", 4)), 0xb4471bf8u);
+    BOOST_REQUIRE_EQUAL(murmur3(0x00000000,
+        std::string("\x00\x11\x22\x33\x44", 5)), 0xe2301fa8u);
+}
+
+BOOST_AUTO_TEST_CASE(bloom_filter__set__over_limits__false)
+{
+    bloom_filter filter;
+    BOOST_REQUIRE(filter.empty());
+    BOOST_REQUIRE(!filter.set(std::string(bloom_filter::max_size + 1, 0), 1,
+        0));
+    BOOST_REQUIRE(!filter.set("\x01",
+        bloom_filter::max_hash_functions + 1, 0));
+    BOOST_REQUIRE(filter.empty());
+}
+
+BOOST_AUTO_TEST_CASE(bloom_filter__contains__output_script_push__true)
+{
+    const std::string key(33, 0x02);
+    const auto filter = make_filter(key);
+
+    // A push of the key, then a checksig.
+    tx transaction;
+    transaction.add_outputs()->set_script(std::string(1, 33) + key + "\xac");
+    BOOST_REQUIRE(filter.contains(transaction, null_hash));
+
+    tx other;
+    other.add_outputs()->set_script(std::string(1, 33) + std::string(33, 3));
+    BOOST_REQUIRE(!filter.contains(other, null_hash));
+
+    // Truncated pushes are not matched.
+    other.add_outputs()->set_script(std::string(1, 34) + key);
+    BOOST_REQUIRE(!filter.contains(other, null_hash));
+}
+
+BOOST_AUTO_TEST_CASE(bloom_filter__contains__outpoint_or_hash__true)
+{
+    const std::string outpoint(std::string(32, 0x11) +
+        std::string("\x05\x00\x00\x00", 4));
+    const auto filter = make_filter(outpoint);
+
+    tx transaction;
+    auto& point = *transaction.add_inputs()->mutable_previous_output();
+    point.set_hash(std::string(32, 0x11));
+    point.set_index(5);
+    BOOST_REQUIRE(filter.contains(transaction, null_hash));
+
+    point.set_index(6);
+    BOOST_REQUIRE(!filter.contains(transaction, null_hash));
+
+    hash_digest hash;
+    std::copy(outpoint.begin(), outpoint.begin() + hash_size, hash.begin());
+    BOOST_REQUIRE(!filter.contains(transaction, hash));
+    BOOST_REQUIRE(make_filter(std::string(32, 0x11)).contains(transaction,
+        hash));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
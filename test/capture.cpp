@@ -0,0 +1,110 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/protocol.hpp>
+
+using namespace bc;
+using namespace bc::protocol;
+
+BOOST_AUTO_TEST_SUITE(capture_tests)
+
+static const std::string capture_path = "capture_tests.bpcap";
+
+BOOST_AUTO_TEST_CASE(capture__load__written_records__round_trip)
+{
+    point value;
+    value.set_hash(std::string(32, 'a'));
+    value.set_index(42);
+
+    {
+        capture instance(capture_path);
+        BOOST_REQUIRE(instance);
+        instance.write(capture::direction::request, value);
+        instance.write(capture::direction::handler, "inproc://x/1", value);
+        instance.write(capture::direction::reply, { {}, { 1, 2, 3 } });
+        BOOST_REQUIRE(instance);
+    }
+
+    capture::record::list records;
+    BOOST_REQUIRE(capture::load(capture_path, records));
+    std::remove(capture_path.c_str());
+
+    BOOST_REQUIRE_EQUAL(records.size(), 3u);
+    BOOST_REQUIRE(records[0].way == capture::direction::request);
+    BOOST_REQUIRE_EQUAL(records[0].parts.size(), 1u);
+
+    point result;
+    const auto& part = records[0].parts[0];
+    BOOST_REQUIRE(result.ParseFromArray(part.data(), part.size()));
+    BOOST_REQUIRE_EQUAL(result.index(), 42u);
+
+    BOOST_REQUIRE(records[1].way == capture::direction::handler);
+    BOOST_REQUIRE_EQUAL(records[1].parts.size(), 2u);
+    BOOST_REQUIRE_EQUAL(records[1].parts[0].size(), 12u);
+
+    BOOST_REQUIRE(records[2].way == capture::direction::reply);
+    BOOST_REQUIRE_EQUAL(records[2].parts.size(), 2u);
+    BOOST_REQUIRE(records[2].parts[0].empty());
+    BOOST_REQUIRE_EQUAL(records[2].parts[1].size(), 3u);
+    BOOST_REQUIRE(records[1].timestamp <= records[2].timestamp);
+}
+
+BOOST_AUTO_TEST_CASE(capture__load__missing_file__false)
+{
+    capture::record::list records;
+    BOOST_REQUIRE(!capture::load("capture_tests.missing", records));
+}
+
+BOOST_AUTO_TEST_CASE(capture__load__truncated_tail__complete_records)
+{
+    {
+        capture instance(capture_path);
+        BOOST_REQUIRE(instance);
+        instance.write(capture::direction::request, { { 1 } });
+        instance.write(capture::direction::reply, { { 2 }, { 3, 4, 5 } });
+    }
+
+    std::string content;
+    {
+        std::ifstream file(capture_path, std::ios::binary);
+        content.assign(std::istreambuf_iterator<char>(file),
+            std::istreambuf_iterator<char>());
+    }
+
+    // Cut the final record short, as a crash while writing would.
+    content.resize(content.size() - 2);
+    std::ofstream(capture_path, std::ios::binary | std::ios::trunc) << content;
+
+    bool truncated;
+    capture::record::list records;
+    BOOST_REQUIRE(capture::load(capture_path, records, truncated));
+    std::remove(capture_path.c_str());
+
+    BOOST_REQUIRE(truncated);
+    BOOST_REQUIRE_EQUAL(records.size(), 1u);
+    BOOST_REQUIRE(records[0].way == capture::direction::request);
+    BOOST_REQUIRE_EQUAL(records[0].parts.size(), 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
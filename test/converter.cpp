@@ -18,6 +18,7 @@
  */
 #include <memory>
 #include <string>
+#include <vector>
 #include <boost/test/test_tools.hpp>
 #include <boost/test/unit_test_suite.hpp>
 #include <bitcoin/protocol.hpp>
@@ -174,4 +175,105 @@ BOOST_AUTO_TEST_CASE(roundtrip_block_valid)
     BOOST_REQUIRE(initial == result);
 }
 
+static chain::block compact_test_block(size_t count)
+{
+    chain::script script_instance;
+    const data_chunk data(encoded_script.begin(), encoded_script.end());
+    BOOST_REQUIRE(script_instance.from_data(data, false));
+
+    chain::transaction::list transactions;
+    for (size_t index = 0; index < count; ++index)
+    {
+        const chain::input::list tx_inputs
+        {
+            {
+                { hash_literal(BCP_GENESIS_BLOCK_HASH), 154 },
+                script_instance,
+                64724
+            }
+        };
+        const chain::output::list tx_outputs{ chain::output{ 6548621547, script_instance } };
+        transactions.push_back({ 1, static_cast<uint32_t>(index), tx_inputs, tx_outputs });
+    }
+
+    const chain::header header
+    {
+        6535,
+        hash_literal(BCP_GENESIS_BLOCK_HASH),
+        hash_literal(BCP_SATOSHIS_WORDS_TX_HASH),
+        856345324,
+        21324121,
+        576859232
+    };
+
+    chain::block block{ header, transactions };
+    block.header().set_merkle(block.generate_merkle_root());
+    return block;
+}
+
+BOOST_AUTO_TEST_CASE(roundtrip_compact_block_from_mempool_valid)
+{
+    const auto initial = compact_test_block(5);
+
+    converter converter;
+    converter::compact_block intermediate;
+    BOOST_REQUIRE(converter.to_protocol(initial, 42, { 3 }, intermediate));
+    BOOST_REQUIRE_EQUAL(intermediate.transactions_size(), 2);
+    BOOST_REQUIRE_EQUAL(intermediate.transactions(0).index(), 0);
+    BOOST_REQUIRE_EQUAL(intermediate.transactions(1).index(), 2);
+    BOOST_REQUIRE_EQUAL(intermediate.short_ids_size(), 3);
+    BOOST_REQUIRE_EQUAL(intermediate.short_ids(0).size(), 6u);
+
+    const auto& transactions = initial.transactions();
+    const chain::transaction::list mempool
+    {
+        transactions[4], transactions[2], transactions[1]
+    };
+
+    chain::block result;
+    std::vector<size_t> missing;
+    BOOST_REQUIRE(converter.from_protocol(&intermediate, mempool, result, missing));
+    BOOST_REQUIRE(missing.empty());
+    BOOST_REQUIRE(initial == result);
+}
+
+BOOST_AUTO_TEST_CASE(roundtrip_compact_block_incomplete_mempool_missing)
+{
+    const auto initial = compact_test_block(4);
+
+    converter converter;
+    converter::compact_block intermediate;
+    BOOST_REQUIRE(converter.to_protocol(initial, 7, {}, intermediate));
+
+    const auto& transactions = initial.transactions();
+    chain::transaction::list mempool{ transactions[1] };
+
+    chain::block result;
+    std::vector<size_t> missing;
+    BOOST_REQUIRE(converter.from_protocol(&intermediate, mempool, result, missing));
+    BOOST_REQUIRE_EQUAL(missing.size(), 2u);
+    BOOST_REQUIRE_EQUAL(missing[0], 2u);
+    BOOST_REQUIRE_EQUAL(missing[1], 3u);
+
+    mempool.push_back(transactions[2]);
+    mempool.push_back(transactions[3]);
+    BOOST_REQUIRE(converter.from_protocol(&intermediate, mempool, result, missing));
+    BOOST_REQUIRE(missing.empty());
+    BOOST_REQUIRE(initial == result);
+}
+
+BOOST_AUTO_TEST_CASE(compact_block_duplicate_short_ids_invalid)
+{
+    const auto initial = compact_test_block(3);
+
+    converter converter;
+    converter::compact_block intermediate;
+    BOOST_REQUIRE(converter.to_protocol(initial, 7, {}, intermediate));
+    intermediate.set_short_ids(1, intermediate.short_ids(0));
+
+    chain::block result;
+    std::vector<size_t> missing;
+    BOOST_REQUIRE(!converter.from_protocol(&intermediate, {}, result, missing));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,152 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/protocol.hpp>
+
+using namespace bc;
+using namespace bc::protocol;
+
+static filter make_filter(filters type, uint32_t bits,
+    const std::string& prefix)
+{
+    filter value;
+    value.set_filter_type(type);
+    value.set_bits(bits);
+    value.set_prefix(prefix);
+    return value;
+}
+
+static short_hash make_address(uint8_t first, uint8_t second)
+{
+    short_hash hash{};
+    hash[0] = first;
+    hash[1] = second;
+    return hash;
+}
+
+BOOST_AUTO_TEST_SUITE(filter_engine_tests)
+
+BOOST_AUTO_TEST_CASE(filter_engine__add__prefix_shorter_than_bits__false)
+{
+    filter_engine engine;
+    BOOST_REQUIRE(!engine.add(make_filter(ADDRESS, 9, "\xab")));
+    BOOST_REQUIRE(!engine.add(make_filter(_FILTERS_NONE, 0, "")));
+
+    protocol::binary prefix;
+    prefix.set_blocks("\xab");
+    prefix.set_final_block_excess(8);
+    BOOST_REQUIRE(!engine.add(ADDRESS, prefix));
+    BOOST_REQUIRE(engine.empty(ADDRESS));
+}
+
+BOOST_AUTO_TEST_CASE(filter_engine__match__bit_prefixes__expected)
+{
+    filter_engine engine;
+
+    // 1010 1011 01, and 0001 nesting 0001 1111.
+    BOOST_REQUIRE(engine.add(make_filter(ADDRESS, 10, "\xab\x40")));
+    BOOST_REQUIRE(engine.add(make_filter(ADDRESS, 4, "\x10")));
+    BOOST_REQUIRE(engine.add(make_filter(ADDRESS, 8, "\x1f")));
+    engine.compile();
+
+    BOOST_REQUIRE(engine.match(ADDRESS, make_address(0xab, 0x40)));
+    BOOST_REQUIRE(engine.match(ADDRESS, make_address(0xab, 0x7f)));
+    BOOST_REQUIRE(!engine.match(ADDRESS, make_address(0xab, 0x80)));
+    BOOST_REQUIRE(!engine.match(ADDRESS, make_address(0xaa, 0x40)));
+    BOOST_REQUIRE(engine.match(ADDRESS, make_address(0x10, 0x00)));
+    BOOST_REQUIRE(engine.match(ADDRESS, make_address(0x1f, 0xff)));
+    BOOST_REQUIRE(!engine.match(ADDRESS, make_address(0x20, 0x00)));
+    BOOST_REQUIRE(!engine.match(TRANSACTION, make_address(0x10, 0x00)));
+    BOOST_REQUIRE(engine.empty(STEALTH));
+}
+
+BOOST_AUTO_TEST_CASE(filter_engine__match__zero_bits__matches_all)
+{
+    filter_engine engine;
+    BOOST_REQUIRE(engine.add(make_filter(TRANSACTION, 0, "")));
+    engine.compile();
+
+    BOOST_REQUIRE(engine.match(TRANSACTION, null_hash));
+    hash_digest hash;
+    hash.fill(0xff);
+    BOOST_REQUIRE(engine.match(TRANSACTION, hash));
+}
+
+BOOST_AUTO_TEST_CASE(filter_engine__match__long_prefix__compares_all_bits)
+{
+    filter_engine engine;
+    const std::string prefix("\x01\x02\x03\x04\x05\x06\x07\x08\xf0", 9);
+    BOOST_REQUIRE(engine.add(make_filter(TRANSACTION, 68, prefix)));
+    engine.compile();
+
+    hash_digest hash = null_hash;
+    std::copy(prefix.begin(), prefix.end(), hash.begin());
+    BOOST_REQUIRE(engine.match(TRANSACTION, hash));
+
+    hash[8] = 0xf7;
+    BOOST_REQUIRE(engine.match(TRANSACTION, hash));
+
+    hash[8] = 0xe0;
+    BOOST_REQUIRE(!engine.match(TRANSACTION, hash));
+}
+
+BOOST_AUTO_TEST_CASE(filter_engine__match__binary_batch__by_position)
+{
+    // 1100 0 as a binary of one block with three excess bits.
+    protocol::binary prefix;
+    prefix.set_blocks("\xc0");
+    prefix.set_final_block_excess(3);
+
+    filter_engine engine;
+    BOOST_REQUIRE(engine.add(STEALTH, prefix));
+    engine.compile();
+
+    const std::vector<short_hash> candidates
+    {
+        make_address(0xc0, 0), make_address(0xc7, 0), make_address(0xc8, 0),
+        make_address(0x40, 0)
+    };
+
+    std::vector<bool> matches;
+    engine.match(STEALTH, candidates, matches);
+    BOOST_REQUIRE(matches == std::vector<bool>({ true, true, false, false }));
+}
+
+BOOST_AUTO_TEST_CASE(filter_engine__add__request__all_filters)
+{
+    transactions_request request;
+    *request.add_query() = make_filter(ADDRESS, 8, "\x01");
+    *request.add_query() = make_filter(TRANSACTION, 8, "\x02");
+
+    filter_engine engine;
+    BOOST_REQUIRE(engine.add(request));
+    engine.compile();
+    BOOST_REQUIRE(engine.match(ADDRESS, make_address(0x01, 0)));
+    BOOST_REQUIRE(!engine.match(ADDRESS, make_address(0x02, 0)));
+
+    hash_digest hash = null_hash;
+    hash[0] = 0x02;
+    BOOST_REQUIRE(engine.match(TRANSACTION, hash));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
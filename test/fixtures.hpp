@@ -0,0 +1,48 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBBITCOIN_PROTOCOL_TEST_FIXTURES_HPP
+#define LIBBITCOIN_PROTOCOL_TEST_FIXTURES_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <bitcoin/protocol.hpp>
+
+// Fixtures shared by test suites.
+
+// A hash distinct for each value below 2^16.
+inline bc::hash_digest make_hash(size_t value)
+{
+    bc::hash_digest hash{};
+    hash[0] = static_cast<uint8_t>(value);
+    hash[31] = static_cast<uint8_t>(value >> 8);
+    return hash;
+}
+
+// A mempool transaction paying the fee.
+inline bc::protocol::mempool_journal::transaction_ptr make_transaction(
+    uint64_t fee)
+{
+    auto transaction = std::make_shared<bc::protocol::tx_mempool>();
+    transaction->set_fee(fee);
+    transaction->mutable_transaction()->set_version(1);
+    return transaction;
+}
+
+#endif
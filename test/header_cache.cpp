@@ -0,0 +1,142 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/protocol.hpp>
+#include "fixtures.hpp"
+
+using namespace bc;
+using namespace bc::protocol;
+
+#define BCP_GENESIS_BLOCK_HASH \
+"000000000019d6689c085ae165831e934ff763ae46a2a6c172b3f1b60a8ce26f"
+
+#define BCP_GENESIS_MERKLE_ROOT \
+"4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b"
+
+static block_header genesis_header()
+{
+    const auto merkle = hash_literal(BCP_GENESIS_MERKLE_ROOT);
+    block_header header;
+    header.set_version(1);
+    header.set_previous_block_hash(std::string(hash_size, 0));
+    header.set_merkle_root(std::string(merkle.begin(), merkle.end()));
+    header.set_timestamp(1231006505);
+    header.set_bits(0x1d00ffff);
+    header.set_nonce(2083236893);
+    return header;
+}
+
+BOOST_AUTO_TEST_SUITE(header_cache_tests)
+
+BOOST_AUTO_TEST_CASE(header_cache__store__genesis__hash_and_height)
+{
+    header_cache instance(0);
+    instance.set_top(10000);
+    BOOST_REQUIRE(instance.store(0, genesis_header()));
+
+    hash_digest hash;
+    BOOST_REQUIRE(instance.hash(0, hash));
+    BOOST_REQUIRE(hash == hash_literal(BCP_GENESIS_BLOCK_HASH));
+
+    size_t height;
+    BOOST_REQUIRE(instance.height(hash, height));
+    BOOST_REQUIRE_EQUAL(height, 0u);
+
+    block_header header;
+    BOOST_REQUIRE(instance.header(0, header));
+    BOOST_REQUIRE_EQUAL(header.nonce(), 2083236893u);
+    BOOST_REQUIRE(header.merkle_root() == genesis_header().merkle_root());
+}
+
+BOOST_AUTO_TEST_CASE(header_cache__store__invalid_header__false)
+{
+    header_cache instance(0);
+    instance.set_top(10000);
+    block_header header;
+    BOOST_REQUIRE(!instance.store(0, header));
+    BOOST_REQUIRE_EQUAL(instance.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(header_cache__header__hash_only__false)
+{
+    header_cache instance(0);
+    instance.set_top(500000);
+    instance.store(500000, make_hash(1));
+
+    block_header header;
+    hash_digest hash;
+    BOOST_REQUIRE(!instance.header(500000, header));
+    BOOST_REQUIRE(instance.hash(500000, hash));
+    BOOST_REQUIRE(!instance.hash(499999, hash));
+}
+
+BOOST_AUTO_TEST_CASE(header_cache__store__different_hash__replaces_height)
+{
+    header_cache instance(0);
+    instance.set_top(10000);
+    instance.store(10, make_hash(1));
+    instance.store(10, make_hash(2));
+
+    size_t height;
+    BOOST_REQUIRE(!instance.height(make_hash(1), height));
+    BOOST_REQUIRE(instance.height(make_hash(2), height));
+    BOOST_REQUIRE_EQUAL(instance.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(header_cache__reorganize__fork_point__drops_above)
+{
+    header_cache instance(0);
+    instance.set_top(10000);
+    instance.store(100, make_hash(1));
+    instance.store(101, make_hash(2));
+    instance.store(5000, make_hash(3));
+    instance.reorganize(100);
+
+    hash_digest hash;
+    size_t height;
+    BOOST_REQUIRE(instance.hash(100, hash));
+    BOOST_REQUIRE(!instance.hash(101, hash));
+    BOOST_REQUIRE(!instance.hash(5000, hash));
+    BOOST_REQUIRE(!instance.height(make_hash(3), height));
+    BOOST_REQUIRE_EQUAL(instance.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(header_cache__store__shallow__false)
+{
+    header_cache instance(6);
+    instance.set_top(100);
+    BOOST_REQUIRE(instance.store(94, make_hash(1)));
+    BOOST_REQUIRE(!instance.store(95, make_hash(2)));
+    BOOST_REQUIRE(!instance.store(101, make_hash(3)));
+    BOOST_REQUIRE(!instance.store(95, genesis_header()));
+    BOOST_REQUIRE_EQUAL(instance.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(header_cache__reorganize__fork_point__lowers_top)
+{
+    header_cache instance(0);
+    instance.set_top(200);
+    instance.reorganize(100);
+    BOOST_REQUIRE(instance.store(100, make_hash(1)));
+    BOOST_REQUIRE(!instance.store(101, make_hash(2)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,143 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/protocol.hpp>
+
+using namespace bc;
+using namespace bc::protocol;
+
+static std::string make_address(uint8_t value)
+{
+    return std::string(short_hash_size, static_cast<char>(value));
+}
+
+// The history of an address has as many rows as its first byte.
+static bool fetch(const short_hash& address_hash, uint64_t from_height,
+    history_batch::row_list& out)
+{
+    for (uint8_t row = 0; row < address_hash[0]; ++row)
+        out.Add()->set_height(from_height + row);
+
+    return true;
+}
+
+BOOST_AUTO_TEST_SUITE(history_batch_tests)
+
+BOOST_AUTO_TEST_CASE(history_batch__addresses__distinct_in_hash_order)
+{
+    blockchain::fetch_history_batch_request request;
+    request.set_address_hashes(make_address(3) + make_address(1) +
+        make_address(3));
+
+    history_batch batch(request);
+    std::vector<short_hash> addresses;
+    BOOST_REQUIRE(batch.addresses(addresses));
+    BOOST_REQUIRE_EQUAL(addresses.size(), 2u);
+    BOOST_REQUIRE_EQUAL(addresses[0][0], 1u);
+    BOOST_REQUIRE_EQUAL(addresses[1][0], 3u);
+}
+
+BOOST_AUTO_TEST_CASE(history_batch__next__grouped_by_address_in_request_order)
+{
+    blockchain::fetch_history_batch_request request;
+    request.set_address_hashes(make_address(3) + make_address(0) +
+        make_address(2));
+    request.set_chunk_rows(5);
+
+    history_batch batch(request);
+    BOOST_REQUIRE(batch.scan(fetch));
+
+    blockchain::fetch_history_batch_handler chunk;
+    BOOST_REQUIRE(batch.next(chunk));
+    BOOST_REQUIRE_EQUAL(chunk.addresses_size(), 3);
+    BOOST_REQUIRE_EQUAL(chunk.addresses(0).address_index(), 0u);
+    BOOST_REQUIRE_EQUAL(chunk.addresses(0).history_size(), 3);
+    BOOST_REQUIRE(chunk.addresses(0).complete());
+    BOOST_REQUIRE_EQUAL(chunk.addresses(1).address_index(), 1u);
+    BOOST_REQUIRE_EQUAL(chunk.addresses(1).history_size(), 0);
+    BOOST_REQUIRE(chunk.addresses(1).complete());
+    BOOST_REQUIRE_EQUAL(chunk.addresses(2).address_index(), 2u);
+    BOOST_REQUIRE_EQUAL(chunk.addresses(2).history_size(), 1);
+    BOOST_REQUIRE(!chunk.addresses(2).complete());
+
+    BOOST_REQUIRE(!batch.next(chunk));
+    BOOST_REQUIRE(chunk.last());
+    BOOST_REQUIRE_EQUAL(chunk.addresses_size(), 1);
+    BOOST_REQUIRE_EQUAL(chunk.addresses(0).address_index(), 2u);
+    BOOST_REQUIRE_EQUAL(chunk.addresses(0).history_size(), 1);
+    BOOST_REQUIRE(chunk.addresses(0).complete());
+}
+
+BOOST_AUTO_TEST_CASE(history_batch__next__addresses_without_history__bounded)
+{
+    // Distinct addresses without history.
+    std::string hashes;
+    for (uint8_t value = 1; value <= 5; ++value)
+        hashes += std::string(1, '\0') + make_address(value).substr(1);
+
+    blockchain::fetch_history_batch_request request;
+    request.set_address_hashes(hashes);
+    request.set_chunk_rows(2);
+
+    history_batch batch(request);
+    BOOST_REQUIRE(batch.scan(fetch));
+
+    blockchain::fetch_history_batch_handler chunk;
+    BOOST_REQUIRE(batch.next(chunk));
+    BOOST_REQUIRE_EQUAL(chunk.addresses_size(), 2);
+    BOOST_REQUIRE(batch.next(chunk));
+    BOOST_REQUIRE_EQUAL(chunk.addresses_size(), 2);
+    BOOST_REQUIRE(!batch.next(chunk));
+    BOOST_REQUIRE_EQUAL(chunk.addresses_size(), 1);
+    BOOST_REQUIRE_EQUAL(chunk.addresses(0).address_index(), 4u);
+    BOOST_REQUIRE(chunk.addresses(0).complete());
+}
+
+BOOST_AUTO_TEST_CASE(history_batch__next__malformed_hashes__bad_stream)
+{
+    blockchain::fetch_history_batch_request request;
+    request.set_address_hashes("short");
+
+    history_batch batch(request);
+    BOOST_REQUIRE(!batch.scan(fetch));
+
+    blockchain::fetch_history_batch_handler chunk;
+    BOOST_REQUIRE(!batch.next(chunk));
+    BOOST_REQUIRE_EQUAL(chunk.error(), error::bad_stream);
+}
+
+BOOST_AUTO_TEST_CASE(history_batch__scan__failed_fetch__bad_stream)
+{
+    blockchain::fetch_history_batch_request request;
+    request.set_address_hashes(make_address(1));
+
+    history_batch batch(request);
+    BOOST_REQUIRE(!batch.scan([](const short_hash&, uint64_t,
+        history_batch::row_list&) { return false; }));
+
+    blockchain::fetch_history_batch_handler chunk;
+    BOOST_REQUIRE(!batch.next(chunk));
+    BOOST_REQUIRE_EQUAL(chunk.error(), error::bad_stream);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,147 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/protocol.hpp>
+
+using namespace bc;
+using namespace bc::protocol;
+
+static history_stream::row_list make_history(size_t count)
+{
+    history_stream::row_list history;
+
+    // Added in descending order, streamed in ascending order.
+    for (size_t index = count; index > 0; --index)
+    {
+        auto& row = *history.Add();
+        row.set_height(100 + index);
+        row.set_kind(0);
+        row.mutable_point()->set_hash(std::string(hash_size,
+            static_cast<char>(index)));
+        row.mutable_point()->set_index(0);
+        row.set_value(index);
+    }
+
+    return history;
+}
+
+BOOST_AUTO_TEST_SUITE(history_stream_tests)
+
+BOOST_AUTO_TEST_CASE(history_stream__next__bounded_chunks__ordered_and_last)
+{
+    blockchain::fetch_history_stream_request request;
+    request.set_chunk_rows(4);
+    history_stream stream(request, make_history(10));
+
+    blockchain::fetch_history_stream_handler chunk;
+    BOOST_REQUIRE(stream.next(chunk));
+    BOOST_REQUIRE_EQUAL(chunk.sequence(), 0u);
+    BOOST_REQUIRE_EQUAL(chunk.history_size(), 4);
+    BOOST_REQUIRE_EQUAL(chunk.history(0).height(), 101u);
+    BOOST_REQUIRE_EQUAL(chunk.history(3).height(), 104u);
+    BOOST_REQUIRE(!chunk.last());
+
+    BOOST_REQUIRE(stream.next(chunk));
+    BOOST_REQUIRE_EQUAL(chunk.history_size(), 4);
+
+    BOOST_REQUIRE(!stream.next(chunk));
+    BOOST_REQUIRE_EQUAL(chunk.sequence(), 2u);
+    BOOST_REQUIRE_EQUAL(chunk.history_size(), 2);
+    BOOST_REQUIRE_EQUAL(chunk.history(1).height(), 110u);
+    BOOST_REQUIRE(chunk.last());
+}
+
+BOOST_AUTO_TEST_CASE(history_stream__next__copy_of_destroyed__ordered)
+{
+    blockchain::fetch_history_stream_request request;
+    std::unique_ptr<history_stream> original(
+        new history_stream(request, make_history(3)));
+    history_stream copy(*original);
+    original.reset();
+
+    blockchain::fetch_history_stream_handler chunk;
+    BOOST_REQUIRE(!copy.next(chunk));
+    BOOST_REQUIRE_EQUAL(chunk.history_size(), 3);
+    BOOST_REQUIRE_EQUAL(chunk.history(0).height(), 101u);
+    BOOST_REQUIRE_EQUAL(chunk.history(2).height(), 103u);
+}
+
+BOOST_AUTO_TEST_CASE(history_stream__next__from_cursor__only_newer_rows)
+{
+    blockchain::fetch_history_stream_request request;
+    history_stream first(request, make_history(5));
+
+    blockchain::fetch_history_stream_handler chunk;
+    BOOST_REQUIRE(!first.next(chunk));
+    BOOST_REQUIRE_EQUAL(chunk.history_size(), 5);
+
+    // The history has grown by two rows since.
+    request.set_cursor(chunk.cursor());
+    history_stream update(request, make_history(7));
+    BOOST_REQUIRE(!update.next(chunk));
+    BOOST_REQUIRE_EQUAL(chunk.history_size(), 2);
+    BOOST_REQUIRE_EQUAL(chunk.history(0).height(), 106u);
+    BOOST_REQUIRE_EQUAL(chunk.history(1).height(), 107u);
+}
+
+BOOST_AUTO_TEST_CASE(history_stream__next__nothing_new__same_cursor)
+{
+    blockchain::fetch_history_stream_request request;
+    history_stream first(request, make_history(3));
+
+    blockchain::fetch_history_stream_handler chunk;
+    BOOST_REQUIRE(!first.next(chunk));
+    const auto cursor = chunk.cursor();
+
+    request.set_cursor(cursor);
+    history_stream update(request, make_history(3));
+    BOOST_REQUIRE(!update.next(chunk));
+    BOOST_REQUIRE_EQUAL(chunk.history_size(), 0);
+    BOOST_REQUIRE(chunk.last());
+    BOOST_REQUIRE(chunk.cursor() == cursor);
+}
+
+BOOST_AUTO_TEST_CASE(history_stream__next__from_height__filtered)
+{
+    blockchain::fetch_history_stream_request request;
+    request.set_from_height(108);
+    history_stream stream(request, make_history(10));
+
+    blockchain::fetch_history_stream_handler chunk;
+    BOOST_REQUIRE(!stream.next(chunk));
+    BOOST_REQUIRE_EQUAL(chunk.history_size(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(history_stream__next__malformed_cursor__bad_stream)
+{
+    blockchain::fetch_history_stream_request request;
+    request.set_cursor("short");
+    history_stream stream(request, make_history(3));
+
+    blockchain::fetch_history_stream_handler chunk;
+    BOOST_REQUIRE(!stream.next(chunk));
+    BOOST_REQUIRE_EQUAL(chunk.error(), error::bad_stream);
+    BOOST_REQUIRE(chunk.last());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/protocol.hpp>
+
+using namespace bc;
+using namespace bc::protocol;
+
+// Serves frames on its own thread until destroyed.
+class server_fixture
+{
+public:
+    server_fixture(zmq::context& context, const config::endpoint& address,
+        ingest_server::insert_handler handler)
+      : server_(context, handler), stopped_(false)
+    {
+        BOOST_REQUIRE(!server_.bind(address));
+        thread_ = std::thread([this]()
+        {
+            while (!stopped_)
+                server_.process(10);
+        });
+    }
+
+    ~server_fixture()
+    {
+        stopped_ = true;
+        thread_.join();
+        server_.stop();
+    }
+
+private:
+    ingest_server server_;
+    std::atomic<bool> stopped_;
+    std::thread thread_;
+};
+
+BOOST_AUTO_TEST_SUITE(ingest_tests)
+
+BOOST_AUTO_TEST_CASE(ingest__flush__small_frames__all_inserted_in_order)
+{
+    zmq::context context;
+    const config::endpoint address("inproc://ingest_in_order");
+    std::vector<uint64_t> heights;
+    server_fixture server(context, address,
+        [&heights](const database::insert_block_request& block)
+        {
+            heights.push_back(block.height());
+            return error::success;
+        });
+
+    // A tiny window keeps no more than one frame in flight.
+    ingest_client client(context, 1, 1);
+    BOOST_REQUIRE(!client.connect(address));
+
+    for (uint64_t height = 0; height < 10; ++height)
+        BOOST_REQUIRE(!client.insert(chain::block{}, height));
+
+    BOOST_REQUIRE(!client.flush());
+    BOOST_REQUIRE_EQUAL(client.sequence(), 10u);
+    BOOST_REQUIRE_EQUAL(client.acknowledged(), 10u);
+    BOOST_REQUIRE_EQUAL(client.in_flight(), 0u);
+    BOOST_REQUIRE_EQUAL(heights.size(), 10u);
+
+    for (uint64_t height = 0; height < 10; ++height)
+        BOOST_REQUIRE_EQUAL(heights[height], height);
+}
+
+BOOST_AUTO_TEST_CASE(ingest__flush__insert_fails__failure_after_stored)
+{
+    zmq::context context;
+    const config::endpoint address("inproc://ingest_failure");
+    server_fixture server(context, address,
+        [](const database::insert_block_request& block)
+        {
+            return block.height() == 3 ? error::operation_failed :
+                error::success;
+        });
+
+    ingest_client client(context);
+    BOOST_REQUIRE(!client.connect(address));
+
+    for (uint64_t height = 0; height < 6; ++height)
+        BOOST_REQUIRE(!client.insert(chain::block{}, height));
+
+    BOOST_REQUIRE_EQUAL(client.flush(), error::operation_failed);
+    BOOST_REQUIRE_EQUAL(client.acknowledged(), 3u);
+    BOOST_REQUIRE_EQUAL(client.insert(chain::block{}, 6),
+        error::operation_failed);
+}
+
+BOOST_AUTO_TEST_CASE(ingest_client__flush__no_server__channel_timeout)
+{
+    zmq::context context;
+    ingest_client client(context, ingest_client::default_window_bytes,
+        ingest_client::default_frame_bytes, 10);
+    BOOST_REQUIRE(!client.connect({ "inproc://ingest_no_server" }));
+    BOOST_REQUIRE(!client.insert(chain::block{}, 0));
+    BOOST_REQUIRE_EQUAL(client.flush(), error::channel_timeout);
+    BOOST_REQUIRE_EQUAL(client.acknowledged(), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
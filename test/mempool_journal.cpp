@@ -0,0 +1,127 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <memory>
+#include <string>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/protocol.hpp>
+#include "fixtures.hpp"
+
+using namespace bc;
+using namespace bc::protocol;
+
+static blockchain::fetch_mempool_delta_reply delta(
+    const mempool_journal& journal, uint64_t since, uint64_t max_bytes = 0)
+{
+    blockchain::fetch_mempool_delta_request request;
+    request.set_since_sequence(since);
+    request.set_max_bytes(max_bytes);
+
+    blockchain::fetch_mempool_delta_reply reply;
+    journal.delta(request, reply);
+    return reply;
+}
+
+BOOST_AUTO_TEST_SUITE(mempool_journal_tests)
+
+BOOST_AUTO_TEST_CASE(mempool_journal__delta__zero__snapshot)
+{
+    mempool_journal journal(100);
+    journal.add(make_hash(1), make_transaction(10));
+    journal.add(make_hash(2), make_transaction(20));
+    journal.remove(make_hash(1));
+
+    const auto reply = delta(journal, 0);
+    BOOST_REQUIRE(reply.snapshot());
+    BOOST_REQUIRE_EQUAL(reply.sequence(), 3u);
+    BOOST_REQUIRE_EQUAL(reply.added_size(), 1);
+    BOOST_REQUIRE_EQUAL(reply.added(0).fee(), 20u);
+    BOOST_REQUIRE_EQUAL(reply.added_hashes(0)[0], 2);
+}
+
+BOOST_AUTO_TEST_CASE(mempool_journal__delta__since__net_changes_only)
+{
+    mempool_journal journal(100);
+    journal.add(make_hash(1), make_transaction(10));
+    journal.add(make_hash(2), make_transaction(20));
+
+    // Added and removed within the delta, so not sent at all.
+    journal.add(make_hash(3), make_transaction(30));
+    journal.remove(make_hash(3));
+    journal.remove(make_hash(1));
+    journal.add(make_hash(4), make_transaction(40));
+
+    const auto reply = delta(journal, 2);
+    BOOST_REQUIRE(!reply.snapshot());
+    BOOST_REQUIRE(!reply.truncated());
+    BOOST_REQUIRE_EQUAL(reply.since_sequence(), 2u);
+    BOOST_REQUIRE_EQUAL(reply.sequence(), 6u);
+    BOOST_REQUIRE_EQUAL(reply.removed_size(), 1);
+    BOOST_REQUIRE_EQUAL(reply.removed(0)[0], 1);
+    BOOST_REQUIRE_EQUAL(reply.added_size(), 1);
+    BOOST_REQUIRE_EQUAL(reply.added(0).fee(), 40u);
+}
+
+BOOST_AUTO_TEST_CASE(mempool_journal__delta__current__empty)
+{
+    mempool_journal journal(100);
+    journal.add(make_hash(1), make_transaction(10));
+
+    const auto reply = delta(journal, 1);
+    BOOST_REQUIRE(!reply.snapshot());
+    BOOST_REQUIRE_EQUAL(reply.sequence(), 1u);
+    BOOST_REQUIRE_EQUAL(reply.added_size(), 0);
+    BOOST_REQUIRE_EQUAL(reply.removed_size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(mempool_journal__delta__beyond_history__snapshot)
+{
+    mempool_journal journal(2);
+    journal.add(make_hash(1), make_transaction(10));
+    journal.add(make_hash(2), make_transaction(20));
+    journal.add(make_hash(3), make_transaction(30));
+    journal.add(make_hash(4), make_transaction(40));
+
+    BOOST_REQUIRE(delta(journal, 1).snapshot());
+    BOOST_REQUIRE(!delta(journal, 2).snapshot());
+    BOOST_REQUIRE_EQUAL(delta(journal, 2).added_size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(mempool_journal__delta__max_bytes__truncated)
+{
+    mempool_journal journal(100);
+    for (uint8_t value = 1; value <= 10; ++value)
+        journal.add(make_hash(value), make_transaction(value));
+
+    journal.remove(make_hash(1));
+    journal.remove(make_hash(2));
+    journal.remove(make_hash(3));
+
+    const auto reply = delta(journal, 10, 2 * hash_size);
+    BOOST_REQUIRE(reply.truncated());
+    BOOST_REQUIRE_EQUAL(reply.sequence(), 12u);
+    BOOST_REQUIRE_EQUAL(reply.removed_size(), 2);
+
+    const auto rest = delta(journal, reply.sequence(), 2 * hash_size);
+    BOOST_REQUIRE(!rest.truncated());
+    BOOST_REQUIRE_EQUAL(rest.sequence(), 13u);
+    BOOST_REQUIRE_EQUAL(rest.removed_size(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <memory>
+#include <string>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/protocol.hpp>
+#include "fixtures.hpp"
+
+using namespace bc;
+using namespace bc::protocol;
+
+static bool sync(mempool_mirror& mirror, const mempool_journal& journal)
+{
+    blockchain::fetch_mempool_delta_request request;
+    request.set_since_sequence(mirror.sequence());
+
+    blockchain::fetch_mempool_delta_reply reply;
+    journal.delta(request, reply);
+    return mirror.apply(reply);
+}
+
+BOOST_AUTO_TEST_SUITE(mempool_mirror_tests)
+
+BOOST_AUTO_TEST_CASE(mempool_mirror__apply__snapshot_then_deltas__in_sync)
+{
+    mempool_journal journal(100);
+    journal.add(make_hash(1), make_transaction(10));
+    journal.add(make_hash(2), make_transaction(20));
+
+    mempool_mirror mirror;
+    BOOST_REQUIRE(sync(mirror, journal));
+    BOOST_REQUIRE_EQUAL(mirror.size(), 2u);
+    BOOST_REQUIRE_EQUAL(mirror.sequence(), journal.sequence());
+
+    journal.remove(make_hash(1));
+    journal.add(make_hash(3), make_transaction(30));
+    BOOST_REQUIRE(sync(mirror, journal));
+    BOOST_REQUIRE_EQUAL(mirror.size(), 2u);
+    BOOST_REQUIRE(!mirror.contains(make_hash(1)));
+
+    tx_mempool out;
+    BOOST_REQUIRE(mirror.find(make_hash(3), out));
+    BOOST_REQUIRE_EQUAL(out.fee(), 30u);
+}
+
+BOOST_AUTO_TEST_CASE(mempool_mirror__apply__gap__rejected)
+{
+    blockchain::fetch_mempool_delta_reply reply;
+    reply.set_since_sequence(5);
+    reply.set_sequence(6);
+
+    mempool_mirror mirror;
+    BOOST_REQUIRE(!mirror.apply(reply));
+    BOOST_REQUIRE_EQUAL(mirror.sequence(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(mempool_mirror__apply__missing_hashes__rejected)
+{
+    blockchain::fetch_mempool_delta_reply reply;
+    reply.set_snapshot(true);
+    reply.set_sequence(1);
+    reply.add_added()->set_fee(1);
+
+    mempool_mirror mirror;
+    BOOST_REQUIRE(!mirror.apply(reply));
+    BOOST_REQUIRE_EQUAL(mirror.size(), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
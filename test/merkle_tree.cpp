@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstddef>
+#include <vector>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/protocol.hpp>
+#include "fixtures.hpp"
+
+using namespace bc;
+using namespace bc::protocol;
+
+static hash_list make_leaves(size_t count)
+{
+    hash_list leaves;
+    for (size_t index = 0; index < count; ++index)
+        leaves.push_back(make_hash(index + 1));
+
+    return leaves;
+}
+
+static hash_digest hash_pair(const hash_digest& left, const hash_digest& right)
+{
+    data_chunk pair(left.begin(), left.end());
+    pair.insert(pair.end(), right.begin(), right.end());
+    return bitcoin_hash(pair);
+}
+
+static hash_digest naive_root(hash_list level)
+{
+    while (level.size() > 1)
+    {
+        if (level.size() % 2 != 0)
+            level.push_back(level.back());
+
+        hash_list above;
+        for (size_t index = 0; index < level.size(); index += 2)
+            above.push_back(hash_pair(level[index], level[index + 1]));
+
+        level = above;
+    }
+
+    return level.front();
+}
+
+BOOST_AUTO_TEST_SUITE(merkle_tree_tests)
+
+BOOST_AUTO_TEST_CASE(merkle_tree__hash_pairs__partial_lanes__matches_bitcoin_hash)
+{
+    for (size_t count = 1; count <= 9; ++count)
+    {
+        data_chunk pairs(count * 64);
+        for (size_t byte = 0; byte < pairs.size(); ++byte)
+            pairs[byte] = static_cast<uint8_t>(byte * 7 + count);
+
+        hash_list out(count);
+        merkle_tree::hash_pairs(pairs.data(), out.front().data(), count);
+
+        for (size_t index = 0; index < count; ++index)
+        {
+            const data_chunk pair(pairs.begin() + index * 64,
+                pairs.begin() + (index + 1) * 64);
+            BOOST_REQUIRE(out[index] == bitcoin_hash(pair));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(merkle_tree__root__odd_and_even__matches_naive)
+{
+    for (const size_t count: { 1, 2, 3, 5, 8, 13, 100 })
+    {
+        const auto leaves = make_leaves(count);
+        const merkle_tree tree(leaves);
+        BOOST_REQUIRE_EQUAL(tree.size(), count);
+        BOOST_REQUIRE(tree.root() == naive_root(leaves));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(merkle_tree__branch__every_leaf__folds_to_root)
+{
+    const auto leaves = make_leaves(11);
+    const merkle_tree tree(leaves);
+
+    for (size_t index = 0; index < leaves.size(); ++index)
+    {
+        hash_list branch;
+        BOOST_REQUIRE(tree.branch(index, branch));
+
+        auto hash = leaves[index];
+        auto position = index;
+        for (const auto& sibling: branch)
+        {
+            hash = position % 2 == 0 ? hash_pair(hash, sibling) :
+                hash_pair(sibling, hash);
+            position /= 2;
+        }
+
+        BOOST_REQUIRE(hash == tree.root());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(merkle_tree__partial__single_match__expected_flags_and_hashes)
+{
+    const auto leaves = make_leaves(3);
+    const merkle_tree tree(leaves);
+
+    hash_list hashes;
+    data_chunk flags;
+    tree.partial({ false, true, false }, hashes, flags);
+
+    // Root, left node and the matched leaf are flagged: bits 1,1,0,1,0.
+    BOOST_REQUIRE_EQUAL(flags.size(), 1u);
+    BOOST_REQUIRE_EQUAL(flags[0], 0x0b);
+    BOOST_REQUIRE_EQUAL(hashes.size(), 3u);
+    BOOST_REQUIRE(hashes[0] == leaves[0]);
+    BOOST_REQUIRE(hashes[1] == leaves[1]);
+    BOOST_REQUIRE(hashes[2] == hash_pair(leaves[2], leaves[2]));
+}
+
+BOOST_AUTO_TEST_CASE(merkle_tree__empty__null_root_and_no_branch)
+{
+    const merkle_tree tree({});
+    BOOST_REQUIRE(tree.root() == null_hash);
+
+    hash_list branch;
+    BOOST_REQUIRE(!tree.branch(0, branch));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,172 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string>
+#include <vector>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/protocol.hpp>
+
+using namespace bc;
+using namespace bc::protocol;
+
+// A subscriber that accepts messages until blocked, recording their ids.
+struct subscriber
+{
+    bool blocked = false;
+    std::vector<std::string> received;
+
+    publish_queue::send_function sender()
+    {
+        return [this](zmq::message& message) -> code
+        {
+            if (blocked)
+                return error::channel_timeout;
+
+            received.push_back(message.dequeue_text());
+            return error::success;
+        };
+    }
+};
+
+static zmq::message make_message(const std::string& id)
+{
+    zmq::message message;
+    message.enqueue(id);
+    message.enqueue(std::string("payload"));
+    return message;
+}
+
+static void push(publish_queue& queue, const std::string& id,
+    bool conflatable=false)
+{
+    queue.push(id, make_message(id), nullptr, conflatable);
+}
+
+BOOST_AUTO_TEST_SUITE(publish_queue_tests)
+
+BOOST_AUTO_TEST_CASE(publish_queue__flush__blocked_then_ready__all_sent_in_order)
+{
+    subscriber peer;
+    publish_queue queue(peer.sender());
+
+    peer.blocked = true;
+    push(queue, "1");
+    push(queue, "2");
+    BOOST_REQUIRE(!queue.flush());
+    BOOST_REQUIRE_EQUAL(queue.stats().depth, 2u);
+    BOOST_REQUIRE(peer.received.empty());
+
+    peer.blocked = false;
+    push(queue, "3");
+    BOOST_REQUIRE(queue.flush());
+    BOOST_REQUIRE(peer.received == std::vector<std::string>({ "1", "2", "3" }));
+
+    const auto stats = queue.stats();
+    BOOST_REQUIRE_EQUAL(stats.depth, 0u);
+    BOOST_REQUIRE_EQUAL(stats.sent, 3u);
+    BOOST_REQUIRE_EQUAL(stats.dropped, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(publish_queue__push__full_drop_oldest__newest_kept)
+{
+    subscriber peer;
+    peer.blocked = true;
+    publish_queue queue(peer.sender(), publish_queue::policy::drop_oldest, 2);
+
+    push(queue, "1");
+    push(queue, "2");
+    push(queue, "3");
+    BOOST_REQUIRE_EQUAL(queue.stats().dropped, 1u);
+
+    peer.blocked = false;
+    BOOST_REQUIRE(queue.flush());
+    BOOST_REQUIRE(peer.received == std::vector<std::string>({ "2", "3" }));
+}
+
+BOOST_AUTO_TEST_CASE(publish_queue__push__conflate__latest_per_handler)
+{
+    subscriber peer;
+    peer.blocked = true;
+    publish_queue queue(peer.sender(), publish_queue::policy::conflate, 2);
+
+    push(queue, "a", true);
+    push(queue, "b", true);
+    queue.push("a", make_message("a2"), nullptr, true);
+    BOOST_REQUIRE_EQUAL(queue.stats().depth, 2u);
+    BOOST_REQUIRE_EQUAL(queue.stats().dropped, 1u);
+
+    // A third handler overflows, dropping the oldest.
+    push(queue, "c", true);
+
+    peer.blocked = false;
+    BOOST_REQUIRE(queue.flush());
+    BOOST_REQUIRE(peer.received == std::vector<std::string>({ "b", "c" }));
+
+    push(queue, "a", true);
+    BOOST_REQUIRE(queue.flush());
+    BOOST_REQUIRE_EQUAL(peer.received.back(), "a");
+}
+
+BOOST_AUTO_TEST_CASE(publish_queue__push__conflate_stream_chunks__all_sent)
+{
+    subscriber peer;
+    peer.blocked = true;
+    publish_queue queue(peer.sender(), publish_queue::policy::conflate, 10);
+
+    // The chunks of a stream share the handler id but are not conflatable.
+    for (auto chunk = 0; chunk < 4; ++chunk)
+        queue.push("s", make_message("s" + std::to_string(chunk)));
+
+    // A conflatable reply to the same handler does not pass them.
+    push(queue, "s", true);
+    push(queue, "s", true);
+    BOOST_REQUIRE_EQUAL(queue.stats().depth, 5u);
+    BOOST_REQUIRE_EQUAL(queue.stats().dropped, 1u);
+
+    peer.blocked = false;
+    BOOST_REQUIRE(queue.flush());
+    BOOST_REQUIRE(peer.received ==
+        std::vector<std::string>({ "s0", "s1", "s2", "s3", "s" }));
+}
+
+BOOST_AUTO_TEST_CASE(publish_queue__push__full_disconnect__all_dropped)
+{
+    subscriber peer;
+    peer.blocked = true;
+    publish_queue queue(peer.sender(), publish_queue::policy::disconnect, 2);
+
+    push(queue, "1");
+    push(queue, "2");
+    BOOST_REQUIRE(!queue.disconnected());
+
+    queue.push("3", make_message("3"), new blockchain::fetch_block_handler);
+    BOOST_REQUIRE(queue.disconnected());
+
+    peer.blocked = false;
+    push(queue, "4");
+    BOOST_REQUIRE(queue.flush());
+    BOOST_REQUIRE(peer.received.empty());
+
+    const auto stats = queue.stats();
+    BOOST_REQUIRE(stats.disconnected);
+    BOOST_REQUIRE_EQUAL(stats.depth, 0u);
+    BOOST_REQUIRE_EQUAL(stats.dropped, 4u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,187 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/protocol.hpp>
+
+using namespace bc;
+using namespace bc::protocol;
+
+// Handles are valid until the store is written at sequence 10.
+static bool is_read_valid(uint64_t handle)
+{
+    return handle >= 10;
+}
+
+// Serves the requests of reads of the top, each a begin_read and a top, on
+// its own thread, with handles numbered from one.
+static std::thread serve(replier& server, size_t reads)
+{
+    return std::thread([&server, reads]()
+    {
+        uint64_t handle = 0;
+
+        for (size_t request = 0; request < 2 * reads; ++request)
+        {
+            database::request query;
+            if (server.receive(query))
+                return;
+
+            if (query.has_begin_read())
+            {
+                std::unique_ptr<database::begin_read_reply> reply(
+                    new database::begin_read_reply);
+                reply->set_result(++handle);
+                server.send(std::move(reply));
+                continue;
+            }
+
+            std::unique_ptr<database::top_reply> reply(
+                new database::top_reply);
+            reply->set_result(true);
+            reply->set_out_height(42);
+            read_snapshot::validate(query, [](uint64_t value)
+            {
+                // The store is written until the third snapshot.
+                return value >= 3;
+            }, *reply);
+            server.send(std::move(reply));
+        }
+    });
+}
+
+static code read_top(read_snapshot& snapshot, uint64_t& out_height)
+{
+    database::request request;
+    request.mutable_top();
+
+    database::top_reply reply;
+    const auto ec = snapshot.send(request, reply);
+    out_height = reply.out_height();
+    return ec;
+}
+
+BOOST_AUTO_TEST_SUITE(read_snapshot_tests)
+
+BOOST_AUTO_TEST_CASE(read_snapshot__read__invalidated__retried)
+{
+    zmq::context context;
+    const config::endpoint endpoint("inproc://read_snapshot_retried");
+
+    replier server(context);
+    BOOST_REQUIRE(!server.bind(endpoint));
+
+    requester client(context);
+    BOOST_REQUIRE(!client.connect(endpoint));
+
+    auto server_thread = serve(server, 3);
+    size_t attempts = 0;
+    uint64_t height = 0;
+
+    const auto ec = read_snapshot::read(client,
+        [&attempts, &height](read_snapshot& snapshot)
+        {
+            ++attempts;
+            return read_top(snapshot, height);
+        });
+
+    server_thread.join();
+    BOOST_REQUIRE_EQUAL(ec, error::success);
+    BOOST_REQUIRE_EQUAL(attempts, 3u);
+    BOOST_REQUIRE_EQUAL(height, 42u);
+    client.disconnect();
+}
+
+BOOST_AUTO_TEST_CASE(read_snapshot__read__attempts_exhausted__operation_failed)
+{
+    zmq::context context;
+    const config::endpoint endpoint("inproc://read_snapshot_exhausted");
+
+    replier server(context);
+    BOOST_REQUIRE(!server.bind(endpoint));
+
+    requester client(context);
+    BOOST_REQUIRE(!client.connect(endpoint));
+
+    auto server_thread = serve(server, 2);
+    size_t attempts = 0;
+
+    const auto ec = read_snapshot::read(client,
+        [&attempts](read_snapshot& snapshot)
+        {
+            ++attempts;
+            uint64_t height;
+            const auto result = read_top(snapshot, height);
+
+            // The snapshot is invalidated by the reply, and stays so.
+            BOOST_REQUIRE(!snapshot);
+            BOOST_REQUIRE_EQUAL(read_top(snapshot, height),
+                error::operation_failed);
+            return result;
+        }, 2);
+
+    server_thread.join();
+    BOOST_REQUIRE_EQUAL(ec, error::operation_failed);
+    BOOST_REQUIRE_EQUAL(attempts, 2u);
+    client.disconnect();
+}
+
+BOOST_AUTO_TEST_CASE(read_snapshot__validate__no_snapshot__valid)
+{
+    database::request request;
+    request.mutable_top();
+
+    database::top_reply reply;
+    read_snapshot::validate(request,
+        [](uint64_t)
+        {
+            BOOST_FAIL("unexpected validation");
+            return false;
+        }, reply);
+
+    BOOST_REQUIRE(reply.read_valid());
+}
+
+BOOST_AUTO_TEST_CASE(read_snapshot__validate__current_handle__valid)
+{
+    database::request request;
+    request.mutable_snapshot()->set_handle(10);
+    request.mutable_gaps();
+
+    database::gaps_reply reply;
+    read_snapshot::validate(request, is_read_valid, reply);
+    BOOST_REQUIRE(reply.read_valid());
+}
+
+BOOST_AUTO_TEST_CASE(read_snapshot__validate__written_handle__invalid)
+{
+    database::request request;
+    request.mutable_snapshot()->set_handle(8);
+    request.mutable_get_transaction();
+
+    database::get_transaction_reply reply;
+    reply.set_read_valid(true);
+    read_snapshot::validate(request, is_read_valid, reply);
+    BOOST_REQUIRE(!reply.read_valid());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
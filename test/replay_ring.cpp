@@ -0,0 +1,146 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/protocol.hpp>
+
+using namespace bc;
+using namespace bc::protocol;
+
+// Records the replies sent by the ring, by height for identification.
+struct recorder
+{
+    struct sent
+    {
+        std::string handler_id;
+        uint64_t sequence;
+        uint64_t height;
+    };
+
+    std::vector<sent> replies;
+
+    replay_ring::send_handler handler()
+    {
+        return [this](const std::string& handler_id, uint64_t sequence,
+            const replay_ring::reply& value)
+        {
+            const auto& reply = static_cast<
+                const blockchain::subscribe_reorganize_handler&>(*value);
+            replies.push_back({ handler_id, sequence, reply.fork_point() });
+        };
+    }
+};
+
+static replay_ring::reply make_reply(uint64_t height)
+{
+    auto reply = std::make_shared<blockchain::subscribe_reorganize_handler>();
+    reply->set_fork_point(height);
+    return reply;
+}
+
+static void push(replay_ring& ring, recorder& sent, uint64_t from,
+    uint64_t to)
+{
+    for (auto height = from; height <= to; ++height)
+        ring.push(make_reply(height), sent.handler());
+}
+
+BOOST_AUTO_TEST_SUITE(replay_ring_tests)
+
+BOOST_AUTO_TEST_CASE(replay_ring__push__always__sequenced_from_one)
+{
+    recorder sent;
+    replay_ring ring("old/type/1", 4);
+    BOOST_REQUIRE_EQUAL(ring.sequence(), 0u);
+
+    push(ring, sent, 100, 102);
+    BOOST_REQUIRE_EQUAL(ring.sequence(), 3u);
+    BOOST_REQUIRE_EQUAL(sent.replies.size(), 3u);
+
+    for (size_t index = 0; index < sent.replies.size(); ++index)
+    {
+        BOOST_REQUIRE_EQUAL(sent.replies[index].handler_id, "old/type/1");
+        BOOST_REQUIRE_EQUAL(sent.replies[index].sequence, index + 1);
+        BOOST_REQUIRE_EQUAL(sent.replies[index].height, 100 + index);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(replay_ring__resume__retained__missed_replies_only)
+{
+    recorder sent;
+    replay_ring ring("old/type/1", 4);
+    push(ring, sent, 100, 104);
+
+    recorder resumed;
+    BOOST_REQUIRE(ring.resume("new/type/1", 3, resumed.handler()));
+    BOOST_REQUIRE_EQUAL(ring.handler_id(), "new/type/1");
+    BOOST_REQUIRE_EQUAL(resumed.replies.size(), 2u);
+    BOOST_REQUIRE_EQUAL(resumed.replies[0].sequence, 4u);
+    BOOST_REQUIRE_EQUAL(resumed.replies[0].height, 103u);
+    BOOST_REQUIRE_EQUAL(resumed.replies[1].sequence, 5u);
+    BOOST_REQUIRE_EQUAL(resumed.replies[1].height, 104u);
+
+    // Later replies go to the new handler id.
+    push(ring, resumed, 105, 105);
+    BOOST_REQUIRE_EQUAL(resumed.replies.back().handler_id, "new/type/1");
+    BOOST_REQUIRE_EQUAL(resumed.replies.back().sequence, 6u);
+}
+
+BOOST_AUTO_TEST_CASE(replay_ring__resume__overwritten__gap_and_retained_sent)
+{
+    recorder sent;
+    replay_ring ring("old/type/1", 2);
+    push(ring, sent, 100, 104);
+
+    recorder resumed;
+    BOOST_REQUIRE(!ring.resume("new/type/1", 1, resumed.handler()));
+    BOOST_REQUIRE_EQUAL(resumed.replies.size(), 2u);
+    BOOST_REQUIRE_EQUAL(resumed.replies[0].sequence, 4u);
+    BOOST_REQUIRE_EQUAL(resumed.replies[1].sequence, 5u);
+}
+
+BOOST_AUTO_TEST_CASE(replay_ring__resume__ahead__gap_and_retained_sent)
+{
+    recorder sent;
+    replay_ring ring("old/type/1", 4);
+    push(ring, sent, 100, 101);
+
+    // The subscriber received more than this ring has numbered.
+    recorder resumed;
+    BOOST_REQUIRE(!ring.resume("new/type/1", 7, resumed.handler()));
+    BOOST_REQUIRE_EQUAL(resumed.replies.size(), 2u);
+    BOOST_REQUIRE_EQUAL(resumed.replies[0].sequence, 1u);
+    BOOST_REQUIRE_EQUAL(resumed.replies[1].sequence, 2u);
+}
+
+BOOST_AUTO_TEST_CASE(replay_ring__resume__up_to_date__none_sent)
+{
+    recorder sent;
+    replay_ring ring("old/type/1", 2);
+    push(ring, sent, 100, 102);
+
+    recorder resumed;
+    BOOST_REQUIRE(ring.resume("new/type/1", 3, resumed.handler()));
+    BOOST_REQUIRE(resumed.replies.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
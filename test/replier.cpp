@@ -0,0 +1,57 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/protocol.hpp>
+
+using namespace bc;
+using namespace bc::protocol;
+
+BOOST_AUTO_TEST_SUITE(replier_tests)
+
+BOOST_AUTO_TEST_CASE(replier__is_valid_handler__well_formed__true)
+{
+    BOOST_REQUIRE(replier::is_valid_handler("127.0.0.1:5000/type/1"));
+    BOOST_REQUIRE(replier::is_valid_handler(
+        "inproc://host.subscriber.0x1/type/1", true));
+}
+
+BOOST_AUTO_TEST_CASE(replier__is_valid_handler__other_transport__false)
+{
+    BOOST_REQUIRE(!replier::is_valid_handler(
+        "inproc://host.subscriber.0x1/type/1"));
+    BOOST_REQUIRE(!replier::is_valid_handler("ipc:///tmp/socket/type/1"));
+    BOOST_REQUIRE(!replier::is_valid_handler("ipc:///tmp/socket/type/1",
+        true));
+    BOOST_REQUIRE(!replier::is_valid_handler("tcp://127.0.0.1:5000/type/1"));
+    BOOST_REQUIRE(!replier::is_valid_handler("localhost/type/1"));
+}
+
+BOOST_AUTO_TEST_CASE(replier__is_valid_handler__malformed__false)
+{
+    BOOST_REQUIRE(!replier::is_valid_handler(""));
+    BOOST_REQUIRE(!replier::is_valid_handler("/"));
+    BOOST_REQUIRE(!replier::is_valid_handler("type"));
+    BOOST_REQUIRE(!replier::is_valid_handler("type/1"));
+    BOOST_REQUIRE(!replier::is_valid_handler("/type/1"));
+    BOOST_REQUIRE(!replier::is_valid_handler("127.0.0.1:5000//1"));
+    BOOST_REQUIRE(!replier::is_valid_handler("127.0.0.1:5000/type/"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,148 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/protocol.hpp>
+#include <bitcoin/protocol/blockchain.pb.h>
+
+using namespace bc;
+using namespace bc::protocol;
+
+typedef blockchain::fetch_last_height_handler last_height;
+
+// The errors with which the client handler is invoked.
+struct invocations
+{
+    typedef std::shared_ptr<invocations> ptr;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<int32_t> errors;
+};
+
+static void record(invocations::ptr state, const last_height& reply)
+{
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->errors.push_back(reply.error());
+    state->changed.notify_all();
+}
+
+static bool wait_invoked(invocations::ptr state)
+{
+    std::unique_lock<std::mutex> lock(state->mutex);
+    return state->changed.wait_for(lock, std::chrono::seconds(5),
+        [&state]() { return !state->errors.empty(); });
+}
+
+static size_t wait_dropped(const requester& client)
+{
+    for (auto wait = 0; wait < 500 && client.dropped_replies() == 0; ++wait)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    return client.dropped_replies();
+}
+
+// The server replies to the handler, which the client no longer has.
+static void reply_late(replier& server, const std::string& handler_id)
+{
+    auto handler = server.make_subscription<last_height>(handler_id,
+        [](last_height& reply)
+        {
+            reply.set_height(42);
+        });
+
+    handler();
+}
+
+BOOST_AUTO_TEST_SUITE(requester_tests)
+
+BOOST_AUTO_TEST_CASE(requester__handler_reply__after_expiry__dropped)
+{
+    zmq::context context;
+    const config::endpoint endpoint("inproc://requester_tests_expiry");
+
+    replier server(context);
+    BOOST_REQUIRE(!server.bind(endpoint));
+
+    requester client(context);
+    client.set_timeout(10);
+    BOOST_REQUIRE(!client.connect(endpoint));
+
+    const auto state = std::make_shared<invocations>();
+    const auto id = client.make_handler<last_height>(state, record);
+
+    // The io loop expires the handler, invoking it with the timeout.
+    BOOST_REQUIRE(wait_invoked(state));
+
+    reply_late(server, id);
+    BOOST_REQUIRE_EQUAL(wait_dropped(client), 1u);
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    BOOST_REQUIRE_EQUAL(state->errors.size(), 1u);
+    BOOST_REQUIRE_EQUAL(state->errors.front(),
+        static_cast<int32_t>(error::channel_timeout));
+    client.disconnect();
+}
+
+BOOST_AUTO_TEST_CASE(requester__handler_reply__after_cancel__dropped)
+{
+    zmq::context context;
+    const config::endpoint endpoint("inproc://requester_tests_cancel");
+
+    replier server(context);
+    BOOST_REQUIRE(!server.bind(endpoint));
+
+    requester client(context);
+    BOOST_REQUIRE(!client.connect(endpoint));
+
+    const auto state = std::make_shared<invocations>();
+    const auto id = client.make_handler<last_height>(state, record);
+
+    std::thread serve([&server]()
+    {
+        blockchain::request request;
+        if (server.receive(request))
+            return;
+
+        server.cancel(request.cancel().handler());
+        std::unique_ptr<blockchain::cancel_reply> reply(
+            new blockchain::cancel_reply);
+        reply->set_result(true);
+        server.send(std::move(reply));
+    });
+
+    BOOST_REQUIRE(!client.cancel(id));
+    serve.join();
+
+    reply_late(server, id);
+    BOOST_REQUIRE_EQUAL(wait_dropped(client), 1u);
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    BOOST_REQUIRE(state->errors.empty());
+    client.disconnect();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,156 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/protocol.hpp>
+#include <bitcoin/protocol/blockchain.pb.h>
+
+using namespace bc;
+using namespace bc::protocol;
+
+static response_cache::payload make_payload(size_t size, uint8_t fill)
+{
+    return std::make_shared<const data_chunk>(size, fill);
+}
+
+static blockchain::request fetch_block_at(uint64_t height)
+{
+    blockchain::request request;
+    request.mutable_fetch_block()->set_height(height);
+    request.mutable_fetch_block()->set_handler("tcp://host:1/fetch_block/1");
+    return request;
+}
+
+BOOST_AUTO_TEST_SUITE(response_cache_tests)
+
+BOOST_AUTO_TEST_CASE(response_cache__to_key__handler__ignored)
+{
+    auto first = fetch_block_at(42);
+    auto second = fetch_block_at(42);
+    second.mutable_fetch_block()->set_handler("tcp://other:2/fetch_block/9");
+
+    std::string first_key;
+    std::string second_key;
+    BOOST_REQUIRE(response_cache::to_key(first, first_key));
+    BOOST_REQUIRE(response_cache::to_key(second, second_key));
+    BOOST_REQUIRE_EQUAL(first_key, second_key);
+
+    blockchain::request header;
+    header.mutable_fetch_block_header()->set_height(42);
+    std::string header_key;
+    BOOST_REQUIRE(response_cache::to_key(header, header_key));
+    BOOST_REQUIRE(header_key != first_key);
+}
+
+BOOST_AUTO_TEST_CASE(response_cache__to_key__mutable_query__false)
+{
+    blockchain::request request;
+    request.mutable_get_height();
+
+    std::string key;
+    BOOST_REQUIRE(!response_cache::to_key(request, key));
+}
+
+BOOST_AUTO_TEST_CASE(response_cache__to_key__unconfirmed_transaction__false)
+{
+    blockchain::request request;
+    request.mutable_fetch_transaction()->set_hash(std::string(hash_size, 1));
+
+    std::string key;
+    BOOST_REQUIRE(!response_cache::to_key(request, key));
+
+    request.mutable_fetch_transaction()->set_require_confirmed(true);
+    BOOST_REQUIRE(response_cache::to_key(request, key));
+}
+
+BOOST_AUTO_TEST_CASE(response_cache__store__shallow__not_cached)
+{
+    response_cache instance(1024 * 1024, 6);
+    instance.set_top(100);
+
+    BOOST_REQUIRE(!instance.store("shallow", 95, make_payload(10, 1)));
+    BOOST_REQUIRE(instance.store("deep", 94, make_payload(10, 2)));
+    BOOST_REQUIRE(!instance.find("shallow"));
+
+    const auto hit = instance.find("deep");
+    BOOST_REQUIRE(hit);
+    BOOST_REQUIRE_EQUAL(hit->front(), 2u);
+    BOOST_REQUIRE_EQUAL(instance.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(response_cache__store__over_budget__evicts_unreferenced)
+{
+    response_cache instance(1024, 0);
+    instance.set_top(10);
+
+    BOOST_REQUIRE(instance.store("a", 1, make_payload(300, 1)));
+    BOOST_REQUIRE(instance.store("b", 2, make_payload(300, 2)));
+    BOOST_REQUIRE(instance.find("a"));
+
+    // The referenced entry survives the first pass of the clock hand.
+    BOOST_REQUIRE(instance.store("c", 3, make_payload(300, 3)));
+    BOOST_REQUIRE(instance.find("a"));
+    BOOST_REQUIRE(!instance.find("b"));
+    BOOST_REQUIRE(instance.find("c"));
+    BOOST_REQUIRE(instance.bytes() <= 1024u);
+}
+
+BOOST_AUTO_TEST_CASE(response_cache__store__larger_than_budget__not_cached)
+{
+    response_cache instance(1024, 0);
+    instance.set_top(10);
+
+    BOOST_REQUIRE(instance.store("a", 1, make_payload(100, 1)));
+    BOOST_REQUIRE(!instance.store("b", 2, make_payload(2048, 2)));
+    BOOST_REQUIRE(instance.find("a"));
+}
+
+BOOST_AUTO_TEST_CASE(response_cache__reorganize__above_fork_point__purged)
+{
+    response_cache instance(1024 * 1024, 0);
+    instance.set_top(20);
+
+    BOOST_REQUIRE(instance.store("kept", 10, make_payload(10, 1)));
+    BOOST_REQUIRE(instance.store("purged", 15, make_payload(10, 2)));
+
+    instance.reorganize(12);
+    BOOST_REQUIRE(instance.find("kept"));
+    BOOST_REQUIRE(!instance.find("purged"));
+    BOOST_REQUIRE_EQUAL(instance.size(), 1u);
+
+    // Heights above the fork point are shallow until the top is set again.
+    BOOST_REQUIRE(!instance.store("purged", 15, make_payload(10, 3)));
+}
+
+BOOST_AUTO_TEST_CASE(response_cache__cacheable__error__false)
+{
+    blockchain::fetch_block_handler reply;
+    reply.mutable_block();
+    reply.set_height(7);
+
+    size_t height;
+    BOOST_REQUIRE(response_cache::cacheable(reply, height));
+    BOOST_REQUIRE_EQUAL(height, 7u);
+
+    reply.set_error(3);
+    BOOST_REQUIRE(!response_cache::cacheable(reply, height));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
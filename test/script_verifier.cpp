@@ -0,0 +1,131 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/protocol.hpp>
+
+using namespace bc;
+using namespace bc::protocol;
+
+// The first transaction byte plus the script size, amount, input index and
+// flags.
+static uint32_t fake_verify(const uint8_t* transaction, size_t,
+    const uint8_t*, size_t prevout_script_size, uint64_t prevout_amount,
+    uint32_t tx_input_index, uint32_t flags)
+{
+    return transaction[0] + static_cast<uint32_t>(prevout_script_size) +
+        static_cast<uint32_t>(prevout_amount) + tx_input_index + flags;
+}
+
+static script_verifier::request_ptr make_request(size_t inputs)
+{
+    auto request = std::make_shared<consensus::verify_scripts_request>();
+    request->add_transactions(std::string(1, 10));
+    request->add_transactions(std::string(1, 20));
+    request->set_flags(1000);
+
+    for (size_t index = 0; index < inputs; ++index)
+    {
+        auto& input = *request->add_inputs();
+        input.set_transaction(index % 2);
+        input.set_prevout_script(std::string(index % 5, 'x'));
+        input.set_prevout_amount(index * 3);
+        input.set_tx_input_index(static_cast<uint32_t>(index));
+    }
+
+    return request;
+}
+
+struct result
+{
+    code ec;
+    consensus::verify_scripts_reply reply;
+};
+
+static result verify(script_verifier& verifier,
+    script_verifier::request_ptr request)
+{
+    std::promise<result> promise;
+    verifier.verify(request,
+        [&promise](const code& ec, const consensus::verify_scripts_reply& reply)
+        {
+            promise.set_value({ ec, reply });
+        });
+
+    return promise.get_future().get();
+}
+
+BOOST_AUTO_TEST_SUITE(script_verifier_tests)
+
+BOOST_AUTO_TEST_CASE(script_verifier__verify__many_inputs__results_in_order)
+{
+    threadpool pool(3);
+    script_verifier verifier(pool, fake_verify);
+
+    const auto request = make_request(101);
+    const auto out = verify(verifier, request);
+    BOOST_REQUIRE(!out.ec);
+    BOOST_REQUIRE_EQUAL(out.reply.results_size(), 101);
+
+    for (int index = 0; index < 101; ++index)
+    {
+        const uint32_t expected = (index % 2 == 0 ? 10 : 20) + index % 5 +
+            index * 3 + index + 1000;
+        BOOST_REQUIRE_EQUAL(out.reply.results(index), expected);
+    }
+
+    pool.shutdown();
+    pool.join();
+}
+
+BOOST_AUTO_TEST_CASE(script_verifier__verify__no_inputs__empty_success)
+{
+    threadpool pool(1);
+    script_verifier verifier(pool, fake_verify);
+
+    const auto out = verify(verifier, make_request(0));
+    BOOST_REQUIRE(!out.ec);
+    BOOST_REQUIRE_EQUAL(out.reply.results_size(), 0);
+
+    pool.shutdown();
+    pool.join();
+}
+
+BOOST_AUTO_TEST_CASE(script_verifier__verify__missing_transaction__bad_stream)
+{
+    threadpool pool(1);
+    script_verifier verifier(pool, fake_verify);
+
+    auto request = std::make_shared<consensus::verify_scripts_request>();
+    request->add_transactions(std::string(1, 10));
+    request->add_inputs()->set_transaction(1);
+
+    const auto out = verify(verifier, request);
+    BOOST_REQUIRE_EQUAL(out.ec, error::bad_stream);
+
+    pool.shutdown();
+    pool.join();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
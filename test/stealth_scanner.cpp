@@ -0,0 +1,197 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/protocol.hpp>
+
+using namespace bc;
+using namespace bc::protocol;
+
+typedef stealth_scanner::rows rows;
+
+// One row per height, with the height as prefix and hash bytes.
+static bool fake_fetch(uint64_t from_height, uint64_t to_height, rows& out)
+{
+    for (auto height = from_height; height < to_height; ++height)
+    {
+        const auto byte = static_cast<uint8_t>(height);
+        out.prefixes.push_back(static_cast<uint32_t>(height));
+        out.heights.push_back(height);
+        out.ephemeral_public_key_hashes.resize(
+            out.ephemeral_public_key_hashes.size() + hash_size, byte);
+        out.public_key_hashes.resize(
+            out.public_key_hashes.size() + short_hash_size, byte);
+        out.transaction_hashes.resize(
+            out.transaction_hashes.size() + hash_size, byte);
+    }
+
+    return true;
+}
+
+struct result
+{
+    code ec;
+    rows found;
+};
+
+static result scan(stealth_scanner& scanner,
+    const stealth_scanner::filter& filter, uint64_t from_height,
+    uint64_t to_height)
+{
+    std::promise<result> promise;
+    scanner.scan(filter, from_height, to_height,
+        [&promise](const code& ec, const rows& found)
+        {
+            promise.set_value({ ec, found });
+        });
+
+    return promise.get_future().get();
+}
+
+BOOST_AUTO_TEST_SUITE(stealth_scanner_tests)
+
+BOOST_AUTO_TEST_CASE(stealth_scanner__to_filter__blocks_size_mismatch__false)
+{
+    stealth_scanner::filter filter;
+    BOOST_REQUIRE(!stealth_scanner::to_filter(9, "\x01", filter));
+    BOOST_REQUIRE(!stealth_scanner::to_filter(0, "\x01", filter));
+    BOOST_REQUIRE(stealth_scanner::to_filter(0, "", filter));
+}
+
+BOOST_AUTO_TEST_CASE(stealth_scanner__match__little_endian_prefix__expected)
+{
+    // 0000 0011 01 of the little endian bytes 03 40 .. ..
+    stealth_scanner::filter filter;
+    BOOST_REQUIRE(stealth_scanner::to_filter(10, std::string("\x03\x40", 2),
+        filter));
+
+    const std::vector<uint32_t> prefixes
+    {
+        0x00004003, 0xffff7f03, 0x00008003, 0x00004002, 0x03400000
+    };
+
+    std::vector<size_t> positions;
+    stealth_scanner::match(filter, prefixes, positions);
+    BOOST_REQUIRE(positions == std::vector<size_t>({ 0, 1 }));
+}
+
+BOOST_AUTO_TEST_CASE(stealth_scanner__match__longer_than_prefix__none)
+{
+    stealth_scanner::filter filter;
+    BOOST_REQUIRE(stealth_scanner::to_filter(33, std::string(5, 0), filter));
+
+    std::vector<size_t> positions;
+    stealth_scanner::match(filter, { 0, 1, 2 }, positions);
+    BOOST_REQUIRE(positions.empty());
+}
+
+BOOST_AUTO_TEST_CASE(stealth_scanner__scan__many_ranges__height_order)
+{
+    threadpool pool(3);
+    stealth_scanner scanner(pool, fake_fetch, 100);
+
+    stealth_scanner::filter filter;
+    BOOST_REQUIRE(stealth_scanner::to_filter(8, "\x03", filter));
+
+    const auto out = scan(scanner, filter, 2, 1000);
+    BOOST_REQUIRE(!out.ec);
+    BOOST_REQUIRE_EQUAL(out.found.size(), 4u);
+    BOOST_REQUIRE(out.found.heights ==
+        std::vector<uint64_t>({ 3, 259, 515, 771 }));
+    BOOST_REQUIRE_EQUAL(out.found.public_key_hashes.size(),
+        4u * short_hash_size);
+    BOOST_REQUIRE_EQUAL(out.found.transaction_hashes[hash_size], 3u);
+
+    pool.shutdown();
+    pool.join();
+}
+
+BOOST_AUTO_TEST_CASE(stealth_scanner__scan__fetch_fails__operation_failed)
+{
+    threadpool pool(2);
+    stealth_scanner scanner(pool,
+        [](uint64_t from_height, uint64_t to_height, rows& out)
+        {
+            return from_height != 20 && fake_fetch(from_height, to_height,
+                out);
+        }, 10);
+
+    stealth_scanner::filter filter;
+    BOOST_REQUIRE(stealth_scanner::to_filter(0, "", filter));
+
+    BOOST_REQUIRE_EQUAL(scan(scanner, filter, 0, 50).ec,
+        error::operation_failed);
+    BOOST_REQUIRE(!scan(scanner, filter, 0, 20).ec);
+    BOOST_REQUIRE(!scan(scanner, filter, 7, 7).ec);
+
+    pool.shutdown();
+    pool.join();
+}
+
+BOOST_AUTO_TEST_CASE(stealth_scanner__from_columns__round_trip__hashes)
+{
+    rows found;
+    BOOST_REQUIRE(fake_fetch(5, 8, found));
+
+    stealth_compact_columns columns;
+    stealth_scanner::to_columns(found, columns);
+    BOOST_REQUIRE_EQUAL(columns.transaction_hashes().size(), 3u * hash_size);
+
+    rows decoded;
+    BOOST_REQUIRE(stealth_scanner::from_columns(columns, decoded));
+    BOOST_REQUIRE_EQUAL(decoded.size(), 3u);
+    BOOST_REQUIRE(decoded.ephemeral_public_key_hashes ==
+        found.ephemeral_public_key_hashes);
+    BOOST_REQUIRE(decoded.public_key_hashes == found.public_key_hashes);
+    BOOST_REQUIRE(decoded.transaction_hashes == found.transaction_hashes);
+
+    columns.mutable_public_key_hashes()->push_back(0);
+    BOOST_REQUIRE(!stealth_scanner::from_columns(columns, decoded));
+}
+
+BOOST_AUTO_TEST_CASE(stealth_scanner__scan__empty_range__pool_thread)
+{
+    threadpool pool(1);
+    stealth_scanner scanner(pool, fake_fetch);
+
+    stealth_scanner::filter filter;
+    BOOST_REQUIRE(stealth_scanner::to_filter(0, "", filter));
+
+    std::promise<std::thread::id> invoked;
+    scanner.scan(filter, 7, 7,
+        [&invoked](const code& ec, const rows& found)
+        {
+            BOOST_REQUIRE(!ec);
+            BOOST_REQUIRE_EQUAL(found.size(), 0u);
+            invoked.set_value(std::this_thread::get_id());
+        });
+
+    BOOST_REQUIRE(invoked.get_future().get() != std::this_thread::get_id());
+
+    pool.shutdown();
+    pool.join();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
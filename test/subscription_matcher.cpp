@@ -0,0 +1,135 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/protocol.hpp>
+
+using namespace bc;
+using namespace bc::protocol;
+
+static std::string pay_key_hash_script(char hash)
+{
+    return "\x76\xa9\x14" + std::string(20, hash) + "\x88\xac";
+}
+
+static std::string pay_script_hash_script(char hash)
+{
+    return "\xa9\x14" + std::string(20, hash) + "\x87";
+}
+
+static tx make_transaction(const std::string& script)
+{
+    tx transaction;
+    transaction.add_outputs()->set_script(script);
+    return transaction;
+}
+
+static subscription_matcher make_matcher(char prefix, bool headers_only)
+{
+    blockchain::subscription_filter filter;
+    auto& query = *filter.add_query();
+    query.set_filter_type(ADDRESS);
+    query.set_bits(8);
+    query.set_prefix(std::string(1, prefix));
+
+    subscription_matcher matcher;
+    BOOST_REQUIRE(matcher.compile(filter, headers_only));
+    return matcher;
+}
+
+BOOST_AUTO_TEST_SUITE(subscription_matcher_tests)
+
+BOOST_AUTO_TEST_CASE(subscription_matcher__match__no_filter__all)
+{
+    subscription_matcher matcher;
+    BOOST_REQUIRE(matcher.compile({}));
+    BOOST_REQUIRE(matcher.match(make_transaction("")));
+}
+
+BOOST_AUTO_TEST_CASE(subscription_matcher__compile__malformed__false)
+{
+    blockchain::subscription_filter filter;
+    filter.add_query()->set_bits(8);
+
+    subscription_matcher matcher;
+    BOOST_REQUIRE(!matcher.compile(filter));
+
+    filter.clear_query();
+    filter.set_bloom(std::string(bloom_filter::max_size + 1, 0));
+    BOOST_REQUIRE(!matcher.compile(filter));
+}
+
+BOOST_AUTO_TEST_CASE(subscription_matcher__apply__address_prefix__matching_sent)
+{
+    const auto matcher = make_matcher(0x42, false);
+
+    blockchain::subscribe_transaction_handler event;
+    *event.mutable_transaction() = make_transaction(pay_key_hash_script(0x42));
+    BOOST_REQUIRE(matcher.apply(event));
+
+    *event.mutable_transaction() = make_transaction(
+        pay_script_hash_script(0x42));
+    BOOST_REQUIRE(matcher.apply(event));
+
+    *event.mutable_transaction() = make_transaction(pay_key_hash_script(0x43));
+    BOOST_REQUIRE(!matcher.apply(event));
+
+    event.set_error(error::service_stopped);
+    BOOST_REQUIRE(matcher.apply(event));
+}
+
+BOOST_AUTO_TEST_CASE(subscription_matcher__apply__reorganize__matching_kept)
+{
+    const auto matcher = make_matcher(0x42, false);
+
+    blockchain::subscribe_reorganize_handler event;
+    auto& block = *event.add_new_blocks()->mutable_actual();
+    *block.add_transactions() = make_transaction(pay_key_hash_script(0x01));
+    *block.add_transactions() = make_transaction(pay_key_hash_script(0x42));
+    *block.add_transactions() = make_transaction(pay_key_hash_script(0x02));
+    *block.add_transactions() = make_transaction(
+        pay_script_hash_script(0x42));
+
+    BOOST_REQUIRE(matcher.apply(event));
+    BOOST_REQUIRE_EQUAL(block.transactions_size(), 2);
+    BOOST_REQUIRE_EQUAL(block.transactions(0).outputs(0).script(),
+        pay_key_hash_script(0x42));
+    BOOST_REQUIRE_EQUAL(block.transactions(1).outputs(0).script(),
+        pay_script_hash_script(0x42));
+}
+
+BOOST_AUTO_TEST_CASE(subscription_matcher__apply__headers_only__no_transactions)
+{
+    subscription_matcher matcher;
+    BOOST_REQUIRE(matcher.compile({}, true));
+
+    blockchain::subscribe_reorganize_handler event;
+    auto& block = *event.add_replaced_blocks()->mutable_actual();
+    block.mutable_header()->set_nonce(42);
+    *block.add_transactions() = make_transaction("");
+    block.add_tree("x");
+
+    BOOST_REQUIRE(matcher.apply(event));
+    BOOST_REQUIRE_EQUAL(block.transactions_size(), 0);
+    BOOST_REQUIRE_EQUAL(block.tree_size(), 0);
+    BOOST_REQUIRE_EQUAL(block.header().nonce(), 42u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
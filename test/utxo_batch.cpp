@@ -0,0 +1,146 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/protocol.hpp>
+
+using namespace bc;
+using namespace bc::protocol;
+
+static chain::output_point make_point(uint8_t hash, uint32_t index)
+{
+    hash_digest digest = null_hash;
+    digest[0] = hash;
+    return { digest, index };
+}
+
+BOOST_AUTO_TEST_SUITE(utxo_batch_tests)
+
+BOOST_AUTO_TEST_CASE(utxo_batch__to_points__round_trip__expected)
+{
+    const chain::output_point::list points
+    {
+        make_point(3, 0x01020304), make_point(1, 0), make_point(2, 0xffffffff)
+    };
+
+    database::get_transaction_outputs_request request;
+    utxo_batch::to_request(points, 42, true, request);
+    BOOST_REQUIRE_EQUAL(request.points().size(), 3 * utxo_batch::point_size);
+    BOOST_REQUIRE_EQUAL(request.fork_height(), 42u);
+    BOOST_REQUIRE(request.require_confirmed());
+
+    chain::output_point::list decoded;
+    BOOST_REQUIRE(utxo_batch::to_points(request, decoded));
+    BOOST_REQUIRE(decoded == points);
+}
+
+BOOST_AUTO_TEST_CASE(utxo_batch__to_points__truncated__false)
+{
+    database::get_transaction_outputs_request request;
+    request.set_points(std::string(utxo_batch::point_size + 1, 0));
+
+    chain::output_point::list points;
+    BOOST_REQUIRE(!utxo_batch::to_points(request, points));
+
+    database::get_transaction_outputs_reply reply;
+    utxo_batch::lookup(request, nullptr, reply);
+    BOOST_REQUIRE(!reply.result());
+}
+
+BOOST_AUTO_TEST_CASE(utxo_batch__lookup__points__sorted_fetches_aligned_reply)
+{
+    const chain::output_point::list points
+    {
+        make_point(3, 1), make_point(1, 2), make_point(2, 0),
+        make_point(1, 2), make_point(1, 1)
+    };
+
+    database::get_transaction_outputs_request request;
+    utxo_batch::to_request(points, 100, false, request);
+
+    // Points with odd indexes are unspent, those of hash 1 are coinbase.
+    chain::output_point::list fetched;
+    const auto fetch = [&fetched](chain::output& out_output,
+        size_t& out_height, bool& out_coinbase,
+        const chain::output_point& point, size_t fork_height,
+        bool require_confirmed)
+    {
+        BOOST_REQUIRE_EQUAL(fork_height, 100u);
+        BOOST_REQUIRE(!require_confirmed);
+        fetched.push_back(point);
+
+        if (point.index() % 2 == 0)
+            return false;
+
+        out_output.set_value(point.hash()[0] * 1000 + point.index());
+        out_height = point.hash()[0];
+        out_coinbase = point.hash()[0] == 1;
+        return true;
+    };
+
+    database::get_transaction_outputs_reply reply;
+    utxo_batch::lookup(request, fetch, reply);
+    BOOST_REQUIRE(reply.result());
+    BOOST_REQUIRE_EQUAL(reply.out_outputs_size(), 2);
+
+    const chain::output_point::list expected_fetched
+    {
+        make_point(1, 1), make_point(1, 2), make_point(2, 0), make_point(3, 1)
+    };
+    BOOST_REQUIRE(fetched == expected_fetched);
+
+    utxo_batch::list utxos;
+    BOOST_REQUIRE(utxo_batch::from_reply(reply, points.size(), utxos));
+    BOOST_REQUIRE_EQUAL(utxos.size(), 5u);
+    BOOST_REQUIRE(utxos[0].found);
+    BOOST_REQUIRE_EQUAL(utxos[0].output.value(), 3001u);
+    BOOST_REQUIRE_EQUAL(utxos[0].height, 3u);
+    BOOST_REQUIRE(!utxos[0].coinbase);
+    BOOST_REQUIRE(!utxos[1].found);
+    BOOST_REQUIRE(!utxos[2].found);
+    BOOST_REQUIRE(!utxos[3].found);
+    BOOST_REQUIRE(utxos[4].found);
+    BOOST_REQUIRE_EQUAL(utxos[4].output.value(), 1001u);
+    BOOST_REQUIRE(utxos[4].coinbase);
+}
+
+BOOST_AUTO_TEST_CASE(utxo_batch__from_reply__count_mismatch__false)
+{
+    database::get_transaction_outputs_request request;
+    utxo_batch::to_request({ make_point(1, 1) }, 0, false, request);
+
+    database::get_transaction_outputs_reply reply;
+    utxo_batch::lookup(request,
+        [](chain::output&, size_t&, bool&, const chain::output_point&,
+            size_t, bool)
+        {
+            return true;
+        }, reply);
+
+    utxo_batch::list utxos;
+    BOOST_REQUIRE(utxo_batch::from_reply(reply, 1, utxos));
+    BOOST_REQUIRE(!utxo_batch::from_reply(reply, 9, utxos));
+    reply.add_out_heights(0);
+    BOOST_REQUIRE(!utxo_batch::from_reply(reply, 1, utxos));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,140 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/protocol.hpp>
+
+using namespace bc;
+using namespace bc::protocol::zmq;
+
+static asio::ipv6 to_ip(const std::string& text)
+{
+    access_list::address bytes;
+    size_t offset;
+    BOOST_REQUIRE(access_list::parse(text, bytes, offset));
+    return asio::ipv6(bytes);
+}
+
+BOOST_AUTO_TEST_SUITE(access_list_tests)
+
+BOOST_AUTO_TEST_CASE(access_list__allowed__empty__true)
+{
+    access_list instance;
+    BOOST_REQUIRE(instance.allowed("10.0.0.1"));
+    BOOST_REQUIRE(instance.allowed("::1"));
+}
+
+BOOST_AUTO_TEST_CASE(access_list__allowed__ipv4_range__matches_prefix_only)
+{
+    access_list instance;
+    BOOST_REQUIRE(instance.allow(to_ip("10.1.0.0"), 16));
+    BOOST_REQUIRE(instance.allowed("10.1.255.7"));
+    BOOST_REQUIRE(instance.allowed("::ffff:10.1.0.1"));
+    BOOST_REQUIRE(!instance.allowed("10.2.0.1"));
+    BOOST_REQUIRE(!instance.allowed("fe80::1"));
+    BOOST_REQUIRE(!instance.allowed("not an address"));
+}
+
+BOOST_AUTO_TEST_CASE(access_list__match__longer_prefix__wins)
+{
+    access_list instance;
+    BOOST_REQUIRE(instance.allow(to_ip("10.0.0.0"), 8));
+    BOOST_REQUIRE(instance.deny(to_ip("10.9.0.0"), 16));
+    BOOST_REQUIRE(instance.allow(to_ip("10.9.9.9"), 32));
+
+    access_list::address value;
+    size_t offset;
+    BOOST_REQUIRE(access_list::parse("10.9.1.1", value, offset));
+    BOOST_REQUIRE(instance.match(value) == access_list::rule::deny);
+    BOOST_REQUIRE(instance.allowed("10.9.9.9"));
+    BOOST_REQUIRE(instance.allowed("10.8.0.1"));
+}
+
+BOOST_AUTO_TEST_CASE(access_list__allowed__equal_prefix__deny_wins)
+{
+    access_list instance;
+    BOOST_REQUIRE(instance.allow(to_ip("2001:db8::"), 32));
+    BOOST_REQUIRE(instance.deny(to_ip("2001:db8::"), 32));
+    BOOST_REQUIRE(!instance.allowed("2001:db8::1"));
+}
+
+BOOST_AUTO_TEST_CASE(access_list__deny__only__unmatched_allowed)
+{
+    access_list instance;
+    BOOST_REQUIRE(instance.deny(to_ip("192.168.1.5"), 32));
+    BOOST_REQUIRE(!instance.allowed("192.168.1.5"));
+    BOOST_REQUIRE(instance.allowed("192.168.1.6"));
+}
+
+BOOST_AUTO_TEST_CASE(access_list__allowed__allow_and_deny__denied_rejected)
+{
+    access_list instance;
+    BOOST_REQUIRE(instance.allow(to_ip("10.0.0.1"), 32));
+    BOOST_REQUIRE(instance.deny(to_ip("10.0.0.2"), 32));
+    BOOST_REQUIRE(instance.allowed("10.0.0.1"));
+    BOOST_REQUIRE(!instance.allowed("10.0.0.2"));
+    BOOST_REQUIRE(!instance.allowed("10.0.0.3"));
+}
+
+BOOST_AUTO_TEST_CASE(access_list__add__ranges__all_applied)
+{
+    access_list instance;
+    BOOST_REQUIRE(instance.add(
+    {
+        { to_ip("10.0.0.0"), 8, access_list::rule::allow },
+        { to_ip("10.9.0.0"), 16, access_list::rule::deny },
+        { to_ip("2001:db8::"), 32, access_list::rule::allow }
+    }));
+
+    BOOST_REQUIRE(instance.allowed("10.8.0.1"));
+    BOOST_REQUIRE(!instance.allowed("10.9.0.1"));
+    BOOST_REQUIRE(instance.allowed("2001:db8::1"));
+    BOOST_REQUIRE(!instance.allowed("11.0.0.1"));
+}
+
+BOOST_AUTO_TEST_CASE(access_list__add__prefix_out_of_range__none_added)
+{
+    access_list instance;
+    BOOST_REQUIRE(!instance.add(
+    {
+        { to_ip("10.0.0.0"), 8, access_list::rule::deny },
+        { to_ip("10.0.0.0"), 33, access_list::rule::allow }
+    }));
+
+    BOOST_REQUIRE(instance.allowed("10.0.0.1"));
+}
+
+BOOST_AUTO_TEST_CASE(access_list__allow__prefix_out_of_range__false)
+{
+    access_list instance;
+    BOOST_REQUIRE(!instance.allow(to_ip("10.0.0.0"), 33));
+    BOOST_REQUIRE(!instance.allow(to_ip("2001:db8::"), 129));
+    BOOST_REQUIRE(instance.allowed("10.0.0.1"));
+}
+
+BOOST_AUTO_TEST_CASE(access_list__clear__rules__all_allowed)
+{
+    access_list instance;
+    BOOST_REQUIRE(instance.allow(to_ip("10.0.0.0"), 8));
+    instance.clear();
+    BOOST_REQUIRE(instance.allowed("11.0.0.1"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
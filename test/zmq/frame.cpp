@@ -26,4 +26,21 @@ BOOST_AUTO_TEST_CASE(frame_test)
 {
 }
 
+BOOST_AUTO_TEST_CASE(frame__construct__moved_large_payload__payload_preserved)
+{
+    const bc::data_chunk expected(8192, 0x2a);
+    bc::data_chunk moved(expected);
+    bc::protocol::zmq::frame instance(std::move(moved));
+    BOOST_REQUIRE(instance);
+    BOOST_REQUIRE(instance.payload() == expected);
+}
+
+BOOST_AUTO_TEST_CASE(frame__construct__moved_small_payload__payload_preserved)
+{
+    const bc::data_chunk expected{ 0x01, 0x02, 0x03 };
+    bc::protocol::zmq::frame instance{ bc::data_chunk(expected) };
+    BOOST_REQUIRE(instance);
+    BOOST_REQUIRE(instance.payload() == expected);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
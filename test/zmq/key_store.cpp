@@ -0,0 +1,175 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdio>
+#include <string>
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test_suite.hpp>
+#include <bitcoin/protocol.hpp>
+
+using namespace bc;
+using namespace bc::protocol::zmq;
+
+static const std::string key_file = "key_store_tests.keys";
+
+static hash_digest make_key(uint32_t value)
+{
+    hash_digest key{};
+    key[0] = static_cast<uint8_t>(value >> 24);
+    key[1] = static_cast<uint8_t>(value >> 16);
+    key[2] = static_cast<uint8_t>(value >> 8);
+    key[3] = static_cast<uint8_t>(value);
+    return key;
+}
+
+BOOST_AUTO_TEST_SUITE(key_store_tests)
+
+BOOST_AUTO_TEST_CASE(key_store__contains__empty__false)
+{
+    key_store instance;
+    BOOST_REQUIRE(instance.empty());
+    BOOST_REQUIRE(!instance.contains(make_key(1)));
+}
+
+BOOST_AUTO_TEST_CASE(key_store__load__saved_keys__contains)
+{
+    hash_list keys;
+    for (uint32_t value = 1000; value > 0; --value)
+        keys.push_back(make_key(value * 2));
+
+    BOOST_REQUIRE(key_store::save(key_file, keys));
+
+    key_store instance;
+    BOOST_REQUIRE(instance.load(key_file));
+    std::remove(key_file.c_str());
+
+    BOOST_REQUIRE_EQUAL(instance.size(), 1000u);
+    BOOST_REQUIRE(instance.contains(make_key(2)));
+    BOOST_REQUIRE(instance.contains(make_key(2000)));
+    BOOST_REQUIRE(!instance.contains(make_key(3)));
+}
+
+BOOST_AUTO_TEST_CASE(key_store__load__unsorted_file__false)
+{
+    key_store instance;
+    instance.add(make_key(7));
+
+    {
+        const auto first = make_key(2);
+        const auto second = make_key(1);
+        std::FILE* file = std::fopen(key_file.c_str(), "wb");
+        BOOST_REQUIRE(file != nullptr);
+        std::fwrite(first.data(), 1, first.size(), file);
+        std::fwrite(second.data(), 1, second.size(), file);
+        std::fclose(file);
+    }
+
+    BOOST_REQUIRE(!instance.load(key_file));
+    std::remove(key_file.c_str());
+    BOOST_REQUIRE(instance.contains(make_key(7)));
+}
+
+BOOST_AUTO_TEST_CASE(key_store__revoke__loaded_and_added__removed)
+{
+    BOOST_REQUIRE(key_store::save(key_file, { make_key(1), make_key(2) }));
+
+    key_store instance;
+    BOOST_REQUIRE(instance.load(key_file));
+    std::remove(key_file.c_str());
+
+    instance.add(make_key(3));
+    instance.revoke(make_key(1));
+    instance.revoke(make_key(3));
+    instance.revoke(make_key(4));
+    BOOST_REQUIRE_EQUAL(instance.size(), 1u);
+    BOOST_REQUIRE(!instance.contains(make_key(1)));
+    BOOST_REQUIRE(instance.contains(make_key(2)));
+    BOOST_REQUIRE(!instance.contains(make_key(3)));
+
+    instance.add(make_key(1));
+    BOOST_REQUIRE(instance.contains(make_key(1)));
+    BOOST_REQUIRE_EQUAL(instance.size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(key_store__configured__default__false)
+{
+    key_store instance;
+    BOOST_REQUIRE(!instance.configured());
+}
+
+BOOST_AUTO_TEST_CASE(key_store__revoke__last_key__configured_empty)
+{
+    key_store instance;
+    instance.add(make_key(1));
+    instance.revoke(make_key(1));
+    BOOST_REQUIRE(instance.empty());
+    BOOST_REQUIRE(instance.configured());
+    BOOST_REQUIRE(!instance.contains(make_key(1)));
+
+    instance.clear();
+    BOOST_REQUIRE(!instance.configured());
+}
+
+BOOST_AUTO_TEST_CASE(key_store__load__empty_file__configured_empty)
+{
+    BOOST_REQUIRE(key_store::save(key_file, {}));
+
+    key_store instance;
+    instance.add(make_key(1));
+    BOOST_REQUIRE(instance.load(key_file));
+    std::remove(key_file.c_str());
+
+    BOOST_REQUIRE(instance.empty());
+    BOOST_REQUIRE(instance.configured());
+    BOOST_REQUIRE(!instance.contains(make_key(1)));
+}
+
+BOOST_AUTO_TEST_CASE(key_store__load__truncated_file__false_configured)
+{
+    {
+        const auto key = make_key(1);
+        std::FILE* file = std::fopen(key_file.c_str(), "wb");
+        BOOST_REQUIRE(file != nullptr);
+        std::fwrite(key.data(), 1, key.size() - 1, file);
+        std::fclose(file);
+    }
+
+    key_store instance;
+    BOOST_REQUIRE(!instance.load(key_file));
+    std::remove(key_file.c_str());
+
+    BOOST_REQUIRE(instance.empty());
+    BOOST_REQUIRE(instance.configured());
+}
+
+BOOST_AUTO_TEST_CASE(key_store__add__beyond_compaction__contains_all)
+{
+    key_store instance;
+    for (uint32_t value = 0; value < 10000; ++value)
+        instance.add(make_key(value));
+
+    for (uint32_t value = 0; value < 10000; value += 2)
+        instance.revoke(make_key(value));
+
+    BOOST_REQUIRE_EQUAL(instance.size(), 5000u);
+    BOOST_REQUIRE(!instance.contains(make_key(0)));
+    BOOST_REQUIRE(instance.contains(make_key(1)));
+    BOOST_REQUIRE(instance.contains(make_key(9999)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
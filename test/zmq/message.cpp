@@ -16,6 +16,8 @@
  * You should have received a copy of the GNU Affero General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <memory>
+#include <string>
 #include <boost/test/test_tools.hpp>
 #include <boost/test/unit_test_suite.hpp>
 #include <bitcoin/protocol.hpp>
@@ -26,4 +28,79 @@ BOOST_AUTO_TEST_CASE(message_test)
 {
 }
 
+BOOST_AUTO_TEST_CASE(message__dequeue_local__reference__merged)
+{
+    bc::protocol::point expected;
+    expected.set_hash(std::string(32, 'a'));
+    expected.set_index(42);
+
+    bc::protocol::zmq::message instance;
+    instance.enqueue_protobuf_reference(expected);
+
+    bc::protocol::point result;
+    BOOST_REQUIRE(instance.dequeue_local(result));
+    BOOST_REQUIRE(instance.empty());
+    BOOST_REQUIRE_EQUAL(result.hash(), expected.hash());
+    BOOST_REQUIRE_EQUAL(result.index(), expected.index());
+}
+
+BOOST_AUTO_TEST_CASE(message__dequeue_local__ownership__swapped)
+{
+    std::unique_ptr<bc::protocol::point> owned(new bc::protocol::point);
+    owned->set_hash(std::string(32, 'a'));
+    owned->set_index(42);
+
+    bc::protocol::zmq::message instance;
+    instance.enqueue_protobuf_ownership(std::move(owned));
+
+    bc::protocol::point result;
+    result.set_index(7);
+    BOOST_REQUIRE(instance.dequeue_local(result));
+    BOOST_REQUIRE(instance.empty());
+    BOOST_REQUIRE_EQUAL(result.hash(), std::string(32, 'a'));
+    BOOST_REQUIRE_EQUAL(result.index(), 42u);
+}
+
+BOOST_AUTO_TEST_CASE(message__dequeue_local__serialized__parsed)
+{
+    bc::protocol::point expected;
+    expected.set_index(42);
+
+    bc::protocol::zmq::message instance;
+    BOOST_REQUIRE(instance.enqueue_protobuf_message(expected));
+
+    bc::protocol::point result;
+    BOOST_REQUIRE(instance.dequeue_local(result));
+    BOOST_REQUIRE_EQUAL(result.index(), expected.index());
+}
+
+BOOST_AUTO_TEST_CASE(message__dequeue_local__type_mismatch__false)
+{
+    bc::protocol::point value;
+    bc::protocol::zmq::message instance;
+    instance.enqueue_protobuf_reference(value);
+
+    bc::protocol::block_id result;
+    BOOST_REQUIRE(!instance.dequeue_local(result));
+    BOOST_REQUIRE(instance.empty());
+}
+
+BOOST_AUTO_TEST_CASE(message__to_protobuf_reference__serialized_part__null)
+{
+    const bc::data_chunk part{ 0x08, 0x2a };
+    BOOST_REQUIRE(!bc::protocol::zmq::message::to_protobuf_reference(part));
+}
+
+BOOST_AUTO_TEST_CASE(message__peek__parts__top_retained)
+{
+    bc::protocol::zmq::message instance;
+    BOOST_REQUIRE(instance.peek().empty());
+
+    instance.enqueue(std::string("a"));
+    instance.enqueue(std::string("b"));
+    BOOST_REQUIRE(instance.peek() == bc::data_chunk{ 'a' });
+    BOOST_REQUIRE_EQUAL(instance.size(), 2u);
+    BOOST_REQUIRE_EQUAL(instance.dequeue_text(), "a");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,585 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <bitcoin/protocol.hpp>
+#include <bitcoin/protocol/blockchain.pb.h>
+
+using namespace bc;
+using namespace bc::protocol;
+using namespace bc::protocol::blockchain;
+using namespace std::chrono;
+
+// Drives a replier with a synthetic mix of blockchain requests and reports
+// throughput, latency percentiles and process cpu time per request.
+// Handler requests (fetch, subscribe, organize) are timed until the handler
+// reply arrives.
+//
+// usage: bitprim_protocol_load <endpoint> [options]
+//   --mix=get:<w>,fetch:<w>,subscribe:<w>,organize:<w>  (default 40,40,10,10)
+//   --clients=<n>        concurrent requesters (default 4)
+//   --rate=<r>           open loop at r requests/s overall (default closed)
+//   --duration=<s>       run time in seconds (default 10)
+//   --stub               answer on <endpoint> with canned payloads
+//   --block-txs=<n>      transactions in the canned block (default 2000)
+//   --history-rows=<n>   rows in the canned history (default 200)
+
+typedef steady_clock clock_type;
+static constexpr auto handler_timeout = seconds(10);
+
+enum class kind : size_t
+{
+    get = 0,
+    fetch = 1,
+    subscribe = 2,
+    organize = 3
+};
+
+static constexpr size_t kinds = 4;
+static const char* kind_names[kinds] = { "get", "fetch", "subscribe",
+    "organize" };
+
+struct options
+{
+    std::string endpoint;
+    std::array<double, kinds> mix{ { 40, 40, 10, 10 } };
+    size_t clients = 4;
+    double rate = 0;
+    size_t duration = 10;
+    bool stub = false;
+    size_t block_txs = 2000;
+    size_t history_rows = 200;
+};
+
+static bool parse_mix(const std::string& text, options& out)
+{
+    out.mix.fill(0);
+    std::string::size_type start = 0;
+
+    while (start < text.size())
+    {
+        auto end = text.find(',', start);
+        if (end == std::string::npos)
+            end = text.size();
+
+        const auto entry = text.substr(start, end - start);
+        const auto colon = entry.find(':');
+        if (colon == std::string::npos)
+            return false;
+
+        const auto name = entry.substr(0, colon);
+        const auto found = std::find_if(std::begin(kind_names),
+            std::end(kind_names), [&](const char* item)
+            {
+                return name == item;
+            });
+
+        if (found == std::end(kind_names))
+            return false;
+
+        out.mix[found - std::begin(kind_names)] =
+            std::atof(entry.substr(colon + 1).c_str());
+        start = end + 1;
+    }
+
+    for (const auto weight: out.mix)
+        if (weight > 0)
+            return true;
+
+    return false;
+}
+
+static bool parse(int argc, char* argv[], options& out)
+{
+    if (argc < 2)
+        return false;
+
+    out.endpoint = argv[1];
+
+    for (auto index = 2; index < argc; ++index)
+    {
+        const std::string argument(argv[index]);
+        const auto value = [&](size_t prefix)
+        {
+            return argument.substr(prefix);
+        };
+
+        if (argument == "--stub")
+            out.stub = true;
+        else if (argument.compare(0, 6, "--mix=") == 0)
+        {
+            if (!parse_mix(value(6), out))
+                return false;
+        }
+        else if (argument.compare(0, 10, "--clients=") == 0)
+            out.clients = std::atoi(value(10).c_str());
+        else if (argument.compare(0, 7, "--rate=") == 0)
+            out.rate = std::atof(value(7).c_str());
+        else if (argument.compare(0, 11, "--duration=") == 0)
+            out.duration = std::atoi(value(11).c_str());
+        else if (argument.compare(0, 12, "--block-txs=") == 0)
+            out.block_txs = std::atoi(value(12).c_str());
+        else if (argument.compare(0, 15, "--history-rows=") == 0)
+            out.history_rows = std::atoi(value(15).c_str());
+        else
+            return false;
+    }
+
+    return out.clients > 0 && out.duration > 0 && out.rate >= 0;
+}
+
+// Payloads.
+// ----------------------------------------------------------------------------
+
+static std::string filler(size_t size, size_t seed)
+{
+    std::string out(size, 0);
+    for (size_t index = 0; index < size; ++index)
+        out[index] = static_cast<char>((seed * 31 + index * 7) & 0xff);
+
+    return out;
+}
+
+// A two input, two output p2pkh transaction (about 370 bytes on the wire).
+static void make_transaction(tx& out, size_t seed)
+{
+    out.set_version(1);
+    out.set_locktime(0);
+
+    for (uint32_t index = 0; index < 2; ++index)
+    {
+        const auto input = out.add_inputs();
+        input->mutable_previous_output()->set_hash(filler(32, seed + index));
+        input->mutable_previous_output()->set_index(index);
+        input->set_script(filler(107, seed));
+        input->set_sequence(max_uint32);
+
+        const auto output = out.add_outputs();
+        output->set_value(50000 + seed + index);
+        output->set_script(filler(25, seed + index));
+    }
+}
+
+static void make_header(block_header& out, size_t seed)
+{
+    out.set_version(0x20000000);
+    out.set_previous_block_hash(filler(32, seed));
+    out.set_merkle_root(filler(32, seed + 1));
+    out.set_timestamp(1500000000 + static_cast<uint32_t>(seed));
+    out.set_bits(0x18014735);
+    out.set_nonce(static_cast<uint32_t>(seed * 2654435761u));
+}
+
+struct payloads
+{
+    fetch_block_handler block;
+    fetch_history_handler history;
+    subscribe_transaction_handler transaction;
+    get_header_reply header;
+};
+
+static void make_payloads(payloads& out, const options& settings)
+{
+    const auto block = out.block.mutable_block();
+    make_header(*block->mutable_header(), 0);
+    for (size_t index = 0; index < settings.block_txs; ++index)
+        make_transaction(*block->add_transactions(), index);
+
+    out.block.set_height(500000);
+
+    for (size_t index = 0; index < settings.history_rows; ++index)
+    {
+        const auto row = out.history.add_history();
+        row->set_kind(index % 2);
+        row->mutable_point()->set_hash(filler(32, index));
+        row->mutable_point()->set_index(index % 4);
+        row->set_height(400000 + index);
+        row->set_value(100000 * index);
+    }
+
+    make_transaction(*out.transaction.mutable_transaction(), 0);
+    out.transaction.add_indexes(0);
+
+    out.header.set_result(true);
+    make_header(*out.header.mutable_out_header(), 1);
+}
+
+// Stub.
+// ----------------------------------------------------------------------------
+
+// Answers with canned replies of realistic size, so a run measures the
+// protocol layer rather than a blockchain.
+static void stand_in(zmq::context& context, const config::endpoint& endpoint,
+    const payloads& canned, std::promise<code>& bound)
+{
+    replier replier(context);
+    bound.set_value(replier.bind(endpoint));
+
+    blockchain::request request;
+    while (!replier.receive(request))
+    {
+        switch (request.request_type_case())
+        {
+            case blockchain::request::kGetHeader:
+            {
+                std::unique_ptr<get_header_reply> reply(new get_header_reply);
+                *reply = canned.header;
+                replier.send(std::move(reply));
+                continue;
+            }
+            case blockchain::request::kGetBlockHash:
+            {
+                std::unique_ptr<get_block_hash_reply> reply(
+                    new get_block_hash_reply);
+                reply->set_result(true);
+                reply->set_out_hash(canned.header.out_header().merkle_root());
+                replier.send(std::move(reply));
+                continue;
+            }
+            case blockchain::request::kGetLastHeight:
+            {
+                std::unique_ptr<get_last_height_reply> reply(
+                    new get_last_height_reply);
+                reply->set_result(true);
+                reply->set_out_height(canned.block.height());
+                replier.send(std::move(reply));
+                continue;
+            }
+            case blockchain::request::kFetchBlock:
+            {
+                auto handler = replier.make_handler<fetch_block_handler>(
+                    request.fetch_block().handler(),
+                    [&](fetch_block_handler& reply)
+                    {
+                        reply = canned.block;
+                    });
+                handler();
+                break;
+            }
+            case blockchain::request::kFetchHistory:
+            {
+                auto handler = replier.make_handler<fetch_history_handler>(
+                    request.fetch_history().handler(),
+                    [&](fetch_history_handler& reply)
+                    {
+                        reply = canned.history;
+                    });
+                handler();
+                break;
+            }
+            case blockchain::request::kSubscribeTransaction:
+            {
+                auto handler = replier.make_subscription<
+                    subscribe_transaction_handler>(
+                    request.subscribe_transaction().handler(),
+                    [&](subscribe_transaction_handler& reply)
+                    {
+                        reply = canned.transaction;
+                    });
+                handler();
+                break;
+            }
+            case blockchain::request::kOrganizeTransaction:
+            {
+                auto handler = replier.make_handler<
+                    organize_transaction_handler>(
+                    request.organize_transaction().handler(),
+                    [](organize_transaction_handler& reply)
+                    {
+                        reply.set_error(error::success);
+                    });
+                handler();
+                break;
+            }
+            default:
+                break;
+        }
+
+        replier.send(std::unique_ptr<void_reply>(new void_reply));
+    }
+}
+
+// Client.
+// ----------------------------------------------------------------------------
+
+typedef std::shared_ptr<std::promise<void>> completion;
+
+static void complete(completion done)
+{
+    done->set_value();
+}
+
+template <typename Message>
+static std::string make_handler(requester& client, completion done)
+{
+    return client.make_handler<Message>(done,
+        [](completion done, const Message&)
+        {
+            complete(done);
+        });
+}
+
+// Issue one request of the kind, returning false on failure or timeout.
+static bool issue(requester& client, kind type, size_t sequence,
+    const tx& transaction)
+{
+    blockchain::request request;
+    completion done;
+
+    switch (type)
+    {
+        case kind::get:
+            switch (sequence % 3)
+            {
+                case 0:
+                    request.mutable_get_header()->set_height(sequence);
+                    break;
+                case 1:
+                    request.mutable_get_block_hash()->set_height(sequence);
+                    break;
+                default:
+                    request.mutable_get_last_height();
+                    break;
+            }
+            break;
+
+        case kind::fetch:
+            done = std::make_shared<std::promise<void>>();
+            if (sequence % 2 == 0)
+            {
+                const auto fetch = request.mutable_fetch_block();
+                fetch->set_height(sequence);
+                fetch->set_handler(make_handler<fetch_block_handler>(client,
+                    done));
+            }
+            else
+            {
+                const auto fetch = request.mutable_fetch_history();
+                fetch->mutable_address()->set_valid(true);
+                fetch->mutable_address()->set_hash(filler(20, sequence));
+                fetch->set_handler(make_handler<fetch_history_handler>(client,
+                    done));
+            }
+            break;
+
+        // Single shot, so repeated subscriptions do not accumulate handlers.
+        case kind::subscribe:
+            done = std::make_shared<std::promise<void>>();
+            request.mutable_subscribe_transaction()->set_handler(
+                make_handler<subscribe_transaction_handler>(client, done));
+            break;
+
+        case kind::organize:
+            done = std::make_shared<std::promise<void>>();
+            const auto organize = request.mutable_organize_transaction();
+            *organize->mutable_transaction() = transaction;
+            organize->set_handler(make_handler<organize_transaction_handler>(
+                client, done));
+            break;
+    }
+
+    void_reply reply;
+    if (client.send(request, reply))
+        return false;
+
+    return !done || done->get_future().wait_for(handler_timeout) ==
+        std::future_status::ready;
+}
+
+struct results
+{
+    std::mutex mutex;
+    std::array<std::vector<int64_t>, kinds> latencies;
+    size_t failures = 0;
+};
+
+static void run_client(zmq::context& context, const config::endpoint& endpoint,
+    const options& settings, size_t index, clock_type::time_point begin,
+    results& out)
+{
+    requester client(context, endpoint);
+    std::mt19937 random(static_cast<uint32_t>(index));
+    std::discrete_distribution<size_t> choose(settings.mix.begin(),
+        settings.mix.end());
+
+    tx transaction;
+    make_transaction(transaction, index);
+
+    const auto end = begin + seconds(settings.duration);
+    const auto interval = settings.rate > 0 ?
+        duration_cast<clock_type::duration>(duration<double>(
+            settings.clients / settings.rate)) : clock_type::duration::zero();
+
+    std::array<std::vector<int64_t>, kinds> latencies;
+    size_t failures = 0;
+    auto scheduled = begin;
+
+    for (size_t sequence = 0; ; ++sequence)
+    {
+        // Open loop latency is measured from the scheduled send time, so a
+        // slow reply is not hidden by delaying the requests behind it.
+        if (interval != clock_type::duration::zero())
+        {
+            scheduled += interval;
+            std::this_thread::sleep_until(scheduled);
+        }
+        else
+            scheduled = clock_type::now();
+
+        if (scheduled >= end)
+            break;
+
+        const auto type = static_cast<kind>(choose(random));
+        if (!issue(client, type, sequence * settings.clients + index,
+            transaction))
+        {
+            ++failures;
+            continue;
+        }
+
+        latencies[static_cast<size_t>(type)].push_back(
+            duration_cast<microseconds>(clock_type::now() - scheduled).count());
+    }
+
+    std::lock_guard<std::mutex> lock(out.mutex);
+    out.failures += failures;
+    for (size_t type = 0; type < kinds; ++type)
+        out.latencies[type].insert(out.latencies[type].end(),
+            latencies[type].begin(), latencies[type].end());
+}
+
+// Report.
+// ----------------------------------------------------------------------------
+
+static int64_t percentile(const std::vector<int64_t>& sorted, double rank)
+{
+    if (sorted.empty())
+        return 0;
+
+    const auto index = static_cast<size_t>(rank * (sorted.size() - 1));
+    return sorted[index];
+}
+
+static void report(const std::string& name, std::vector<int64_t>& latencies)
+{
+    std::sort(latencies.begin(), latencies.end());
+    std::cout
+        << name << ": count " << latencies.size()
+        << ", p50 " << percentile(latencies, 0.50)
+        << ", p99 " << percentile(latencies, 0.99)
+        << ", p999 " << percentile(latencies, 0.999)
+        << ", max " << percentile(latencies, 1.0) << " us" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    options settings;
+    if (!parse(argc, argv, settings))
+    {
+        std::cerr << "usage: bitprim_protocol_load <endpoint> "
+            "[--mix=get:<w>,fetch:<w>,subscribe:<w>,organize:<w>] "
+            "[--clients=<n>] [--rate=<r>] [--duration=<s>] [--stub] "
+            "[--block-txs=<n>] [--history-rows=<n>]" << std::endl;
+        return -1;
+    }
+
+    const config::endpoint endpoint(settings.endpoint);
+    zmq::context context;
+    std::thread stub_thread;
+    payloads canned;
+
+    if (settings.stub)
+    {
+        make_payloads(canned, settings);
+        std::cout << "canned block: " << canned.block.ByteSize()
+            << " bytes, history: " << canned.history.ByteSize()
+            << " bytes" << std::endl;
+
+        std::promise<code> bound;
+        stub_thread = std::thread(stand_in, std::ref(context),
+            std::cref(endpoint), std::cref(canned), std::ref(bound));
+
+        const auto ec = bound.get_future().get();
+        if (ec)
+        {
+            std::cerr << "Stub bind failed: " << ec.message() << std::endl;
+            context.stop();
+            stub_thread.join();
+            return -1;
+        }
+    }
+
+    results totals;
+    const auto cpu_begin = std::clock();
+    const auto begin = clock_type::now();
+    std::vector<std::thread> clients;
+
+    for (size_t index = 0; index < settings.clients; ++index)
+        clients.emplace_back(run_client, std::ref(context), std::cref(endpoint),
+            std::cref(settings), index, begin, std::ref(totals));
+
+    for (auto& client: clients)
+        client.join();
+
+    const auto elapsed = duration<double>(clock_type::now() - begin).count();
+    const auto cpu = static_cast<double>(std::clock() - cpu_begin) /
+        CLOCKS_PER_SEC;
+
+    if (settings.stub)
+    {
+        context.stop();
+        stub_thread.join();
+    }
+
+    size_t completed = 0;
+    std::vector<int64_t> all;
+    for (size_t type = 0; type < kinds; ++type)
+    {
+        auto& latencies = totals.latencies[type];
+        completed += latencies.size();
+        all.insert(all.end(), latencies.begin(), latencies.end());
+
+        if (!latencies.empty())
+            report(kind_names[type], latencies);
+    }
+
+    report("all", all);
+
+    // Process cpu time, which includes the stub when it runs in process.
+    std::cout
+        << "completed:   " << completed << std::endl
+        << "failures:    " << totals.failures << std::endl
+        << "throughput:  " << completed / elapsed << " req/s" << std::endl
+        << "cpu/request: " << (completed == 0 ? 0.0 :
+            cpu * 1e6 / completed) << " us" << std::endl;
+
+    return totals.failures == 0 ? 0 : -1;
+}
@@ -0,0 +1,439 @@
+/**
+ * Copyright (c) 2011-2017 libbitcoin developers (see AUTHORS)
+ *
+ * This file is part of libbitcoin.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <bitcoin/protocol.hpp>
+#include <bitcoin/protocol/blockchain.pb.h>
+
+using namespace bc;
+using namespace bc::protocol;
+using namespace std::chrono;
+
+// Replays the requests of a capture log against a replier and reports the
+// latency distribution. Handler requests are timed until the handler reply.
+//
+// usage: bitprim_protocol_replay <capture> <endpoint> [options]
+//   --speed=<factor>  scale the captured inter-request gaps (default 1)
+//   --max             issue requests back to back, ignoring timestamps
+//   --clients=<n>     replay over n requesters, round robin (default 1)
+//   --stub            answer on <endpoint> with the captured replies
+
+typedef steady_clock clock_type;
+static constexpr auto handler_timeout = seconds(10);
+
+struct options
+{
+    std::string capture;
+    std::string endpoint;
+    double speed = 1.0;
+    size_t clients = 1;
+    bool stub = false;
+};
+
+static bool parse(int argc, char* argv[], options& out)
+{
+    if (argc < 3)
+        return false;
+
+    out.capture = argv[1];
+    out.endpoint = argv[2];
+
+    for (auto index = 3; index < argc; ++index)
+    {
+        const std::string argument(argv[index]);
+
+        if (argument == "--max")
+            out.speed = 0;
+        else if (argument == "--stub")
+            out.stub = true;
+        else if (argument.compare(0, 8, "--speed=") == 0)
+            out.speed = std::atof(argument.substr(8).c_str());
+        else if (argument.compare(0, 10, "--clients=") == 0)
+            out.clients = std::atoi(argument.substr(10).c_str());
+        else
+            return false;
+    }
+
+    return out.speed >= 0 && out.clients > 0;
+}
+
+// The captured handler id names the original client's subscriber endpoint,
+// so it must be replaced by one registered with the replaying requester.
+static google::protobuf::Message* find_handler_holder(
+    blockchain::request& request,
+    const google::protobuf::FieldDescriptor*& handler)
+{
+    const auto descriptor = request.GetDescriptor();
+    const auto reflection = request.GetReflection();
+    const auto oneof = descriptor->FindOneofByName("request_type");
+    const auto field = reflection->GetOneofFieldDescriptor(request, oneof);
+
+    if (field == nullptr ||
+        field->type() != google::protobuf::FieldDescriptor::TYPE_MESSAGE)
+        return nullptr;
+
+    const auto holder = reflection->MutableMessage(&request, field);
+    handler = holder->GetDescriptor()->FindFieldByName("handler");
+
+    if (handler == nullptr ||
+        handler->type() != google::protobuf::FieldDescriptor::TYPE_STRING)
+        return nullptr;
+
+    return holder;
+}
+
+// The captured reply parts and handler payloads of a request.
+struct answer
+{
+    std::vector<data_chunk> reply;
+    std::vector<data_chunk> handler;
+};
+
+typedef std::unordered_map<std::string, answer> answers;
+
+// Requests are matched on their serialization without the handler id and
+// the envelope, which differ between the capture and the replay.
+static std::string answer_key(blockchain::request request)
+{
+    const google::protobuf::FieldDescriptor* field = nullptr;
+    const auto holder = find_handler_holder(request, field);
+
+    if (holder != nullptr)
+        holder->GetReflection()->ClearField(holder, field);
+
+    request.clear_timeout();
+    request.clear_sent();
+
+    return request.SerializeAsString();
+}
+
+// The requester captures handler replies under its local id, the replier
+// under the full id, so both are matched against the request's handler id.
+static std::string local_handler_id(const std::string& handler_id)
+{
+    const auto id = handler_id.rfind('/');
+    if (id == std::string::npos || id == 0)
+        return handler_id;
+
+    const auto type = handler_id.rfind('/', id - 1);
+    return type == std::string::npos ? handler_id :
+        handler_id.substr(type + 1);
+}
+
+// A reply follows its request in the log, as both ends capture them in
+// lockstep. Handler replies follow in any order and are matched by id.
+static answers collect_answers(const capture::record::list& records)
+{
+    answers out;
+    std::unordered_map<std::string, std::string> handlers;
+    std::string pending;
+    auto awaiting = false;
+
+    for (const auto& record: records)
+    {
+        if (record.parts.empty())
+            continue;
+
+        const auto& payload = record.parts.back();
+
+        switch (record.way)
+        {
+            case capture::direction::request:
+            {
+                blockchain::request request;
+                if (!request.ParseFromArray(payload.data(),
+                    static_cast<int>(payload.size())))
+                {
+                    awaiting = false;
+                    break;
+                }
+
+                pending = answer_key(request);
+                awaiting = out.find(pending) == out.end();
+                out.emplace(pending, answer{});
+
+                const google::protobuf::FieldDescriptor* field = nullptr;
+                const auto holder = find_handler_holder(request, field);
+
+                if (holder != nullptr && awaiting)
+                {
+                    const auto id = holder->GetReflection()->GetString(
+                        *holder, field);
+                    handlers[id] = pending;
+                    handlers[local_handler_id(id)] = pending;
+                }
+
+                break;
+            }
+            case capture::direction::reply:
+            {
+                if (awaiting)
+                    out[pending].reply = record.parts;
+
+                awaiting = false;
+                break;
+            }
+            case capture::direction::handler:
+            {
+                const auto& part = record.parts.front();
+                const std::string id(part.begin(), part.end());
+                const auto handler = handlers.find(id);
+
+                if (record.parts.size() == 2 && handler != handlers.end())
+                    out[handler->second].handler.push_back(payload);
+
+                break;
+            }
+        }
+    }
+
+    return out;
+}
+
+// Answers each request with its captured reply and handler replies, for
+// offline runs without a blockchain. Requests not in the capture are
+// answered with an empty reply.
+static void stand_in(zmq::context& context, const config::endpoint& endpoint,
+    const answers& captured, std::promise<code>& bound)
+{
+    replier replier(context);
+    bound.set_value(replier.bind(endpoint));
+
+    blockchain::request request;
+    while (!replier.receive(request))
+    {
+        const auto found = captured.find(answer_key(request));
+        const google::protobuf::FieldDescriptor* field = nullptr;
+        const auto holder = find_handler_holder(request, field);
+
+        if (holder != nullptr)
+        {
+            const auto id = holder->GetReflection()->GetString(*holder, field);
+
+            // The payload is parsed as unknown fields of an empty message,
+            // which serializes them back unchanged.
+            auto handler = replier.make_handler<void_reply>(id,
+                [](const data_chunk& payload, void_reply& reply)
+                {
+                    reply.ParseFromArray(payload.data(),
+                        static_cast<int>(payload.size()));
+                });
+
+            if (found == captured.end() || found->second.handler.empty())
+                handler(data_chunk{});
+            else
+                for (const auto& payload: found->second.handler)
+                    handler(payload);
+        }
+
+        if (found == captured.end() || found->second.reply.empty())
+        {
+            replier.send(std::unique_ptr<void_reply>(new void_reply));
+            continue;
+        }
+
+        zmq::message reply;
+        for (const auto& part: found->second.reply)
+            reply.enqueue(part);
+
+        replier.send(reply);
+    }
+}
+
+static int64_t replay(requester& client, blockchain::request request)
+{
+    const auto start = clock_type::now();
+    const google::protobuf::FieldDescriptor* field = nullptr;
+    const auto holder = find_handler_holder(request, field);
+    std::shared_ptr<std::promise<void>> handled;
+
+    if (holder != nullptr)
+    {
+        handled = std::make_shared<std::promise<void>>();
+        const auto id = client.make_handler<void_reply>(handled,
+            [](std::shared_ptr<std::promise<void>> done, const void_reply&)
+            {
+                done->set_value();
+            });
+
+        holder->GetReflection()->SetString(holder, field, id);
+    }
+
+    void_reply reply;
+    if (client.send(request, reply))
+        return -1;
+
+    if (handled && handled->get_future().wait_for(handler_timeout) !=
+        std::future_status::ready)
+        return -1;
+
+    return duration_cast<microseconds>(clock_type::now() - start).count();
+}
+
+static int64_t percentile(const std::vector<int64_t>& sorted, double rank)
+{
+    if (sorted.empty())
+        return 0;
+
+    const auto index = static_cast<size_t>(rank * (sorted.size() - 1));
+    return sorted[index];
+}
+
+int main(int argc, char* argv[])
+{
+    options settings;
+    if (!parse(argc, argv, settings))
+    {
+        std::cerr << "usage: bitprim_protocol_replay <capture> <endpoint> "
+            "[--speed=<factor>|--max] [--clients=<n>] [--stub]" << std::endl;
+        return -1;
+    }
+
+    bool truncated;
+    capture::record::list records;
+    if (!capture::load(settings.capture, records, truncated))
+    {
+        std::cerr << "Invalid capture: " << settings.capture << std::endl;
+        return -1;
+    }
+
+    if (truncated)
+        std::cerr << "Capture ends in a truncated record, replaying the "
+            << records.size() << " complete records." << std::endl;
+
+    const auto captured = collect_answers(records);
+
+    records.erase(std::remove_if(records.begin(), records.end(),
+        [](const capture::record& record)
+        {
+            return record.way != capture::direction::request ||
+                record.parts.size() != 1;
+        }), records.end());
+
+    if (records.empty())
+    {
+        std::cerr << "No requests captured." << std::endl;
+        return -1;
+    }
+
+    const config::endpoint endpoint(settings.endpoint);
+    zmq::context stub_context;
+    std::thread stub_thread;
+
+    if (settings.stub)
+    {
+        std::promise<code> bound;
+        stub_thread = std::thread(stand_in, std::ref(stub_context),
+            std::cref(endpoint), std::cref(captured), std::ref(bound));
+
+        const auto ec = bound.get_future().get();
+        if (ec)
+        {
+            std::cerr << "Stand-in bind failed: " << ec.message() << std::endl;
+            stub_context.stop();
+            stub_thread.join();
+            return -1;
+        }
+    }
+
+    std::mutex mutex;
+    std::vector<int64_t> latencies;
+    size_t failures = 0;
+
+    const auto first = records.front().timestamp;
+    const auto begin = clock_type::now();
+    std::vector<std::thread> clients;
+
+    {
+        zmq::context context;
+
+        for (size_t client = 0; client < settings.clients; ++client)
+        {
+            clients.emplace_back([&, client]
+            {
+                requester requester(context, endpoint);
+
+                for (auto index = client; index < records.size();
+                    index += settings.clients)
+                {
+                    const auto& record = records[index];
+
+                    if (settings.speed > 0)
+                    {
+                        const auto offset = (record.timestamp - first) /
+                            settings.speed;
+                        std::this_thread::sleep_until(begin +
+                            microseconds(static_cast<int64_t>(offset)));
+                    }
+
+                    blockchain::request request;
+                    const auto& part = record.parts.front();
+                    const auto parsed = request.ParseFromArray(part.data(),
+                        static_cast<int>(part.size()));
+                    const auto latency = parsed ? replay(requester, request) :
+                        -1;
+
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (latency < 0)
+                        ++failures;
+                    else
+                        latencies.push_back(latency);
+                }
+            });
+        }
+
+        for (auto& client: clients)
+            client.join();
+    }
+
+    const auto elapsed = duration_cast<microseconds>(clock_type::now() -
+        begin).count();
+
+    if (settings.stub)
+    {
+        stub_context.stop();
+        stub_thread.join();
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    const auto seconds = std::max(elapsed, int64_t(1)) / 1e6;
+
+    std::cout
+        << "requests:   " << records.size() << std::endl
+        << "failures:   " << failures << std::endl
+        << "elapsed:    " << seconds << " s" << std::endl
+        << "throughput: " << latencies.size() / seconds << " req/s" << std::endl
+        << "p50:        " << percentile(latencies, 0.50) << " us" << std::endl
+        << "p90:        " << percentile(latencies, 0.90) << " us" << std::endl
+        << "p99:        " << percentile(latencies, 0.99) << " us" << std::endl
+        << "p999:       " << percentile(latencies, 0.999) << " us" << std::endl
+        << "max:        " << percentile(latencies, 1.0) << " us" << std::endl;
+
+    return failures == 0 ? 0 : -1;
+}